@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// full 与 leveled 两种 compact 策略在同一负载下的写放大
+// 引擎的 compact 依赖完整的配置和文件系统, 这里只模拟 key 的分布:
+//   - 每个 sst 只记录有序的 key, 大小为 key 数 * 每条记录的字节数
+//   - 触发条件, 参与 compact 的 sst 的挑选方式, 输出 sst 的切分大小
+//     与 LSMEngine 的 maybe_schedule_compaction, full_compact,
+//     leveled_compact 和 gen_sst_from_iter 相同
+//   - compact 在每次 flush 之后同步执行, 不模拟后台线程的并发
+// 负载为 key 空间内均匀随机的 put, value 大小固定, 不包含删除
+// 写放大与 CompactionStats::write_amplification 相同,
+// 为 (flush 写入量 + compact 写入量) / flush 写入量;
+// max(MiB) 为单次 compact 读取的最大数据量
+// 用法: compaction_wa_bench [num_puts] [num_keys] [value_size]
+//                           [per_mem_kb] [ratio]
+namespace {
+// key 的格式与其他 bench 相同 ("key%012zu"), 加上事务id和长度字段
+constexpr size_t kKeySize = 15;
+constexpr size_t kEntryOverhead = sizeof(uint64_t) + 2 * sizeof(uint16_t);
+
+struct SimSst {
+  size_t sst_id;
+  std::vector<uint32_t> keys;
+
+  uint32_t first_key() const { return keys.front(); }
+  uint32_t last_key() const { return keys.back(); }
+};
+
+enum class Policy { Full, Leveled };
+
+class CompactionSim {
+public:
+  CompactionSim(Policy policy, size_t entry_size, size_t per_mem, size_t ratio)
+      : policy_(policy), entry_size_(entry_size), per_mem_(per_mem),
+        ratio_(ratio) {}
+
+  void put(uint32_t key) {
+    memtable_.insert(key);
+    if (memtable_.size() * entry_size_ >= per_mem_) {
+      flush();
+    }
+  }
+
+  void flush() {
+    if (memtable_.empty()) {
+      return;
+    }
+    auto sst = std::make_shared<SimSst>();
+    sst->sst_id = next_sst_id_++;
+    sst->keys.assign(memtable_.begin(), memtable_.end());
+    std::sort(sst->keys.begin(), sst->keys.end());
+    memtable_.clear();
+    flush_bytes_ += size_of(*sst);
+    // l0 按 sst_id 降序排列, 新的 sst 在最前面
+    levels_[0].insert(levels_[0].begin(), sst);
+    maybe_compact();
+  }
+
+  uint64_t flush_bytes() const { return flush_bytes_; }
+  uint64_t compact_read_bytes() const { return compact_read_bytes_; }
+  uint64_t compact_write_bytes() const { return compact_write_bytes_; }
+  size_t num_compactions() const { return num_compactions_; }
+  uint64_t max_compact_bytes() const { return max_compact_bytes_; }
+
+  double write_amplification() const {
+    if (flush_bytes_ == 0) {
+      return 0.0;
+    }
+    return static_cast<double>(flush_bytes_ + compact_write_bytes_) /
+           flush_bytes_;
+  }
+
+  std::string shape() const {
+    std::string result;
+    for (const auto &[level, ssts] : levels_) {
+      if (ssts.empty()) {
+        continue;
+      }
+      if (!result.empty()) {
+        result += ' ';
+      }
+      result += 'L' + std::to_string(level) + ':' + std::to_string(ssts.size());
+    }
+    return result;
+  }
+
+private:
+  using SstList = std::vector<std::shared_ptr<SimSst>>;
+
+  uint64_t size_of(const SimSst &sst) const {
+    return sst.keys.size() * entry_size_;
+  }
+
+  size_t get_sst_size(size_t level) const {
+    size_t size = per_mem_;
+    for (size_t i = 0; i < level; ++i) {
+      size *= ratio_;
+    }
+    return size;
+  }
+
+  // 与 maybe_schedule_compaction 相同: l0 和 full 模式按 sst 数量,
+  // leveled 模式的其他层按整层的大小判断是否超限
+  bool over_limit(size_t level, const SstList &ssts) const {
+    if (policy_ == Policy::Leveled && level > 0) {
+      uint64_t level_bytes = 0;
+      for (auto &sst : ssts) {
+        level_bytes += size_of(*sst);
+      }
+      return level_bytes >= ratio_ * get_sst_size(level);
+    }
+    return ssts.size() >= ratio_;
+  }
+
+  // 一次 compact 可能使下一层超限, 直到所有层都不超限为止
+  void maybe_compact() {
+    bool compacted = true;
+    while (compacted) {
+      compacted = false;
+      for (auto &[level, ssts] : levels_) {
+        if (over_limit(level, ssts)) {
+          compact(level);
+          compacted = true;
+          break;
+        }
+      }
+    }
+  }
+
+  void compact(size_t src_level) {
+    SstList &lx = levels_[src_level];
+    SstList &ly = levels_[src_level + 1];
+    SstList lx_ssts;
+    SstList ly_ssts;
+    if (policy_ == Policy::Full || src_level == 0) {
+      // full_compact 以及 leveled_compact 中的 l0: 整层参与
+      lx_ssts = lx;
+    } else {
+      // leveled_compact: 从游标之后轮转挑选一个 sst
+      auto &cursor = cursors_[src_level];
+      auto picked = lx.front();
+      for (auto &sst : lx) {
+        if (!cursor.has_value || sst->first_key() > cursor.key) {
+          picked = sst;
+          break;
+        }
+      }
+      lx_ssts.push_back(picked);
+      cursor = {true, picked->last_key()};
+    }
+
+    if (policy_ == Policy::Full) {
+      ly_ssts = ly;
+    } else {
+      uint32_t min_key = lx_ssts.front()->first_key();
+      uint32_t max_key = lx_ssts.front()->last_key();
+      for (auto &sst : lx_ssts) {
+        min_key = std::min(min_key, sst->first_key());
+        max_key = std::max(max_key, sst->last_key());
+      }
+      for (auto &sst : ly) {
+        if (sst->last_key() < min_key || sst->first_key() > max_key) {
+          continue;
+        }
+        ly_ssts.push_back(sst);
+      }
+    }
+
+    // 合并时同一个 key 只保留最新的版本, value 大小相同, 只需对 key 去重
+    std::vector<uint32_t> merged;
+    uint64_t read_bytes = 0;
+    for (const auto *list : {&lx_ssts, &ly_ssts}) {
+      for (auto &sst : *list) {
+        read_bytes += size_of(*sst);
+        merged.insert(merged.end(), sst->keys.begin(), sst->keys.end());
+      }
+    }
+    compact_read_bytes_ += read_bytes;
+    max_compact_bytes_ = std::max(max_compact_bytes_, read_bytes);
+    std::sort(merged.begin(), merged.end());
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+    // 与 full_l0_l1_compact 和 full_common_compact 的目标大小相同,
+    // l0 的输出按 l1 的大小切分
+    size_t target_size =
+        src_level == 0 ? per_mem_ * ratio_ : get_sst_size(src_level + 1);
+    SstList new_ssts;
+    std::shared_ptr<SimSst> builder;
+    for (auto key : merged) {
+      if (builder == nullptr || size_of(*builder) >= target_size) {
+        builder = std::make_shared<SimSst>();
+        builder->sst_id = next_sst_id_++;
+        new_ssts.push_back(builder);
+      }
+      builder->keys.push_back(key);
+    }
+    for (auto &sst : new_ssts) {
+      compact_write_bytes_ += size_of(*sst);
+    }
+
+    // 与 install_compaction 相同, 移除参与的 sst 并按首key排序目标层
+    auto remove = [](SstList &level, const SstList &removed) {
+      level.erase(std::remove_if(level.begin(), level.end(),
+                                 [&](const std::shared_ptr<SimSst> &sst) {
+                                   return std::find(removed.begin(),
+                                                    removed.end(),
+                                                    sst) != removed.end();
+                                 }),
+                  level.end());
+    };
+    remove(lx, lx_ssts);
+    remove(ly, ly_ssts);
+    ly.insert(ly.end(), new_ssts.begin(), new_ssts.end());
+    std::sort(ly.begin(), ly.end(),
+              [](const std::shared_ptr<SimSst> &a,
+                 const std::shared_ptr<SimSst> &b) {
+                return a->first_key() < b->first_key();
+              });
+    num_compactions_++;
+  }
+
+  struct Cursor {
+    bool has_value = false;
+    uint32_t key = 0;
+  };
+
+  Policy policy_;
+  size_t entry_size_;
+  size_t per_mem_;
+  size_t ratio_;
+  size_t next_sst_id_ = 0;
+  std::unordered_set<uint32_t> memtable_;
+  std::map<size_t, SstList> levels_;
+  std::map<size_t, Cursor> cursors_;
+  uint64_t flush_bytes_ = 0;
+  uint64_t compact_read_bytes_ = 0;
+  uint64_t compact_write_bytes_ = 0;
+  uint64_t max_compact_bytes_ = 0;
+  size_t num_compactions_ = 0;
+};
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t num_puts = argc > 1 ? std::stoul(argv[1]) : 2000000;
+  size_t num_keys = argc > 2 ? std::stoul(argv[2]) : 1000000;
+  size_t value_size = argc > 3 ? std::stoul(argv[3]) : 100;
+  size_t per_mem = (argc > 4 ? std::stoul(argv[4]) : 64) * 1024;
+  size_t ratio = argc > 5 ? std::stoul(argv[5]) : 4;
+  size_t entry_size = kKeySize + value_size + kEntryOverhead;
+
+  std::printf("%zu puts over %zu keys, %zu-byte entries, memtable %zu KiB, "
+              "ratio %zu\n",
+              num_puts, num_keys, entry_size, per_mem / 1024, ratio);
+  std::printf("%-8s %11s %11s %11s %9s %9s %7s  %s\n", "policy",
+              "flush(MiB)", "read(MiB)", "write(MiB)", "compacts", "max(MiB)",
+              "WA", "levels");
+
+  struct Case {
+    const char *name;
+    Policy policy;
+  };
+  const Case cases[] = {{"full", Policy::Full}, {"leveled", Policy::Leveled}};
+  for (const auto &c : cases) {
+    // 两种策略使用相同的随机序列
+    std::mt19937_64 gen(42);
+    CompactionSim sim(c.policy, entry_size, per_mem, ratio);
+    for (size_t i = 0; i < num_puts; ++i) {
+      sim.put(static_cast<uint32_t>(gen() % num_keys));
+    }
+    sim.flush();
+    constexpr double kMiB = 1024.0 * 1024.0;
+    std::printf("%-8s %11.1f %11.1f %11.1f %9zu %9.1f %7.2f  %s\n", c.name,
+                sim.flush_bytes() / kMiB, sim.compact_read_bytes() / kMiB,
+                sim.compact_write_bytes() / kMiB, sim.num_compactions(),
+                sim.max_compact_bytes() / kMiB, sim.write_amplification(),
+                sim.shape().c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "utils/crc32c.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+// block 校验和的开销: 旧格式使用的 std::hash, crc32 指令, 查表实现
+// 用法: crc32c_bench [total_mb]
+namespace {
+template <typename F>
+double ns_per_call(F &&func, size_t block_size, size_t total_bytes) {
+  size_t iters = total_bytes / block_size;
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iters; ++i) {
+    // 每次错开起始位置, 避免总是对齐到 8 字节
+    sink = sink + func(i & 7);
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return elapsed / iters;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t total_bytes = (argc > 1 ? std::stoul(argv[1]) : 512) << 20;
+  bool has_hardware = crc32c_hardware_supported();
+
+  std::vector<uint8_t> data(64 * 1024);
+  std::mt19937 gen(42);
+  for (auto &byte : data) {
+    byte = static_cast<uint8_t>(gen());
+  }
+
+  // 两种实现的结果必须一致
+  if (has_hardware &&
+      crc32c_extend_hardware(0, data.data(), data.size()) !=
+          crc32c_extend_software(0, data.data(), data.size())) {
+    std::printf("crc32c mismatch between hardware and software\n");
+    return 1;
+  }
+
+  std::printf("%8s %16s %16s %16s\n", "block", "std::hash", "crc32c hw",
+              "crc32c sw");
+  for (size_t block_size : {4096, 32768}) {
+    const auto *base = data.data();
+    double legacy = ns_per_call(
+        [&](size_t offset) {
+          return static_cast<uint32_t>(std::hash<std::string_view>{}(
+              std::string_view(reinterpret_cast<const char *>(base + offset),
+                               block_size)));
+        },
+        block_size, total_bytes);
+    double hardware = 0;
+    if (has_hardware) {
+      hardware = ns_per_call(
+          [&](size_t offset) {
+            return crc32c_extend_hardware(0, base + offset, block_size);
+          },
+          block_size, total_bytes);
+    }
+    double software = ns_per_call(
+        [&](size_t offset) {
+          return crc32c_extend_software(0, base + offset, block_size);
+        },
+        block_size, total_bytes);
+
+    auto print = [block_size](double ns) {
+      if (ns == 0) {
+        std::printf(" %16s", "n/a");
+      } else {
+        std::printf(" %7.0f ns %4.1fGB/s", ns, block_size / ns);
+      }
+    };
+    std::printf("%6zu B", block_size);
+    print(legacy);
+    print(hardware);
+    print(software);
+    std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "utils/filter.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+// 各种过滤器的空间, 假阳性率和探测耗时
+// 布隆过滤器按每个 key 10 位构建, binary fuse filter 的大小由指纹位数决定
+// 用法: filter_bench [num_keys]
+namespace {
+std::vector<uint64_t> make_hashes(size_t begin, size_t end) {
+  std::vector<uint64_t> hashes;
+  hashes.reserve(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    hashes.push_back(Filter::hash_key("key" + std::to_string(i)));
+  }
+  return hashes;
+}
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  constexpr double kBitsPerKey = 10;
+
+  // 存在的 key 和不存在的 key 各一组, 预先计算哈希值, 只测量探测本身
+  auto present = make_hashes(0, num_keys);
+  auto absent = make_hashes(num_keys, num_keys * 2);
+
+  struct Case {
+    const char *name;
+    FilterType type;
+  };
+  const Case cases[] = {{"bloom", FilterType::Bloom},
+                        {"blocked", FilterType::BlockedBloom},
+                        {"fuse8", FilterType::BinaryFuse8},
+                        {"fuse16", FilterType::BinaryFuse16}};
+
+  std::printf("%zu keys\n", num_keys);
+  std::printf("%-8s %10s %10s %12s %12s %12s\n", "filter", "bits/key",
+              "fpr(%)", "build(ms)", "hit(ns)", "miss(ns)");
+  for (const auto &c : cases) {
+    auto start = std::chrono::steady_clock::now();
+    auto filter = Filter::create_from_hashes(c.type, present, kBitsPerKey);
+    double build_ms = elapsed_ns(start) / 1e6;
+    double bits_per_key =
+        filter->encode().size() * 8.0 / static_cast<double>(num_keys);
+
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto hash : present) {
+      hits += filter->possibly_contains_hash(hash);
+    }
+    double hit_ns = elapsed_ns(start) / num_keys;
+
+    size_t false_positives = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto hash : absent) {
+      false_positives += filter->possibly_contains_hash(hash);
+    }
+    double miss_ns = elapsed_ns(start) / num_keys;
+
+    if (hits != num_keys) {
+      std::printf("%s: %zu false negatives\n", c.name, num_keys - hits);
+      return 1;
+    }
+    std::printf("%-8s %10.2f %10.3f %12.1f %12.1f %12.1f\n", c.name,
+                bits_per_key, 100.0 * false_positives / num_keys, build_ms,
+                hit_ns, miss_ns);
+  }
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include "skiplist/skiplist.h"
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+// 多线程写入 skiplist 的吞吐量, 线程数从 1 增加到 32
+// 用法: skiplist_bench [total_puts]
+int main(int argc, char **argv) {
+  const int total_puts = argc > 1 ? std::stoi(argv[1]) : 200000;
+  std::vector<std::string> keys(total_puts);
+  std::mt19937 gen(42);
+  for (auto &key : keys) {
+    key = "key" + std::to_string(gen());
+  }
+
+  for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+    Skiplist skiplist;
+    int per_thread = total_puts / num_threads;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&skiplist, &keys, t, per_thread]() {
+        for (int i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+          skiplist.put(keys[i], "value", 10);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    // 遍历计数, 确认没有丢失写入
+    int count = 0;
+    for (auto it = skiplist.begin(); !it.is_end(); ++it) {
+      count++;
+    }
+    std::cout << "threads=" << std::setw(2) << num_threads << "  "
+              << static_cast<size_t>(per_thread * num_threads / elapsed)
+              << " puts/s";
+    if (count != per_thread * num_threads) {
+      std::cout << "  (lost " << per_thread * num_threads - count
+                << " entries)";
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include "block/block_cache.h"
+#include "lsm/manifest.h"
+#include "sst/sst.h"
+#include "sst/sst_iterator.h"
+#include "utils/files.h"
+#include "utils/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+// 引擎启动到第一次点查返回的耗时, 分别按三种方式打开 sst:
+//   serial:   逐个 SST::open, 即并行打开之前的启动流程
+//   parallel: 与 load_from_directory 相同, 16 个线程分段打开
+//   manifest: 与 load_from_manifest 相同, 回放 manifest 后 open_lazy,
+//             第一次点查时才打开对应的 sst
+// 目录中的文件由第一次运行生成, 之后复用. read_mode 为 direct 时绕过
+// page cache, 近似冷启动; 默认的 pread 测量的是文件已在 page cache 中的情况
+// 用法: startup_bench <dir> [num_ssts] [keys_per_sst] [read_mode]
+namespace {
+constexpr size_t kLevel = 1;
+constexpr size_t kOpenThreads = 16;
+
+std::string sst_path(const std::string &dir, size_t sst_id) {
+  return dir + "/sst_" + std::to_string(sst_id) + "." + std::to_string(kLevel);
+}
+
+std::string make_key(size_t i) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "key%012zu", i);
+  return buf;
+}
+
+void prepare(const std::string &dir, size_t num_ssts, size_t keys_per_sst) {
+  std::filesystem::create_directories(dir);
+  if (Manifest::exists(dir)) {
+    Manifest manifest(dir);
+    if (manifest.live_ssts().size() == num_ssts) {
+      return;
+    }
+  }
+  std::printf("creating %zu ssts with %zu keys each in %s\n", num_ssts,
+              keys_per_sst, dir.c_str());
+  // sst 文件只在本程序中被读取, 不需要缓存
+  auto cache = std::make_shared<BlockCache>(1 << 20, 2);
+  std::filesystem::remove(dir + "/MANIFEST");
+  Manifest manifest(dir);
+  VersionEdit edit;
+  for (size_t sst_id = 0; sst_id < num_ssts; ++sst_id) {
+    SSTBuilder builder(4096, true);
+    for (size_t i = 0; i < keys_per_sst; ++i) {
+      builder.add(make_key(sst_id * keys_per_sst + i), "value", 1);
+    }
+    auto sst = builder.build(sst_id, sst_path(dir, sst_id), cache, kLevel);
+    edit.added_ssts.push_back(sst->get_meta());
+  }
+  edit.next_sst_id = num_ssts;
+  manifest.log_and_apply(edit);
+}
+
+// 打开全部 sst 后查询位于中间的 sst 中的一个 key, 返回总耗时
+double time_to_first_get(
+    const std::function<std::vector<std::shared_ptr<SST>>()> &open_all,
+    size_t num_ssts, size_t keys_per_sst) {
+  auto start = std::chrono::steady_clock::now();
+  auto ssts = open_all();
+  size_t target = num_ssts / 2;
+  auto key = make_key(target * keys_per_sst + keys_per_sst / 2);
+  auto it = ssts[target]->get(key, 0);
+  if (!it.is_valid() || it.key() != key) {
+    std::printf("key %s not found\n", key.c_str());
+    std::exit(1);
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::printf("usage: %s <dir> [num_ssts] [keys_per_sst] [read_mode]\n",
+                argv[0]);
+    return 1;
+  }
+  std::string dir = argv[1];
+  size_t num_ssts = argc > 2 ? std::stoul(argv[2]) : 5000;
+  size_t keys_per_sst = argc > 3 ? std::stoul(argv[3]) : 1000;
+  prepare(dir, num_ssts, keys_per_sst);
+
+  auto read_mode = file_read_mode_from_string(argc > 4 ? argv[4] : "pread");
+  auto cache = std::make_shared<BlockCache>(64 << 20, 2);
+
+  auto serial = [&]() {
+    std::vector<std::shared_ptr<SST>> ssts(num_ssts);
+    for (size_t i = 0; i < num_ssts; ++i) {
+      ssts[i] = SST::open(
+          i, FileObj::open_read_only(sst_path(dir, i), read_mode), cache,
+          kLevel);
+    }
+    return ssts;
+  };
+
+  auto parallel = [&]() {
+    std::vector<std::shared_ptr<SST>> ssts(num_ssts);
+    size_t num_threads = std::min(num_ssts, kOpenThreads);
+    ThreadPool pool(num_threads);
+    size_t per_thread = (num_ssts + num_threads - 1) / num_threads;
+    for (size_t begin = 0; begin < num_ssts; begin += per_thread) {
+      size_t end = std::min(begin + per_thread, num_ssts);
+      pool.submit([&, begin, end]() {
+        for (size_t i = begin; i < end; ++i) {
+          ssts[i] = SST::open(
+              i, FileObj::open_read_only(sst_path(dir, i), read_mode), cache,
+              kLevel);
+        }
+      });
+    }
+    pool.shutdown();
+    return ssts;
+  };
+
+  auto from_manifest = [&]() {
+    Manifest manifest(dir);
+    std::vector<std::shared_ptr<SST>> ssts;
+    ssts.reserve(manifest.live_ssts().size());
+    for (const auto &[sst_id, meta] : manifest.live_ssts()) {
+      ssts.push_back(
+          SST::open_lazy(meta, sst_path(dir, sst_id), read_mode, cache));
+    }
+    return ssts;
+  };
+
+  std::printf("%-10s %12s\n", "mode", "first get(ms)");
+  for (int round = 0; round < 3; ++round) {
+    std::printf("%-10s %12.1f\n", "serial",
+                time_to_first_get(serial, num_ssts, keys_per_sst));
+    std::printf("%-10s %12.1f\n", "parallel",
+                time_to_first_get(parallel, num_ssts, keys_per_sst));
+    std::printf("%-10s %12.1f\n", "manifest",
+                time_to_first_get(from_manifest, num_ssts, keys_per_sst));
+  }
+  return 0;
+}
@@ -13,42 +13,93 @@ namespace my_tiny_lsm {
 
 class BlockIterator;
 
+// block 编码格式:
+// v1: [entries][offsets(u16)...][num_entries(u16)][hash(u32)]
+//     entry: [key_len(u16)][key][value_len(u16)][value][tranc_id(u64)]
+// v2: [entries][offsets(u16)...][restart_interval(u16)]
+//     [num_entries | kBlockFormatV2Flag (u16)][hash(u32)]
+//     entry: [shared_len(u16)][unshared_len(u16)][key 后缀]
+//            [value_len(u16)][value][tranc_id(u64)]
+//     key 只保存与前一个 key 不同的后缀, 每 restart_interval 个 entry
+//     设置一个 restart 点, restart 点保存完整的 key (shared_len 为 0)
+// 尾部的 hash 原本是截断为 32 位的 std::hash, 设置 kBlockCrc32cFlag 时为
+// crc32c, 两种 entry 格式都可以使用
+// entry 数量受 u16 的 offset 限制, 不会用到最高的两位, 因此用它们区分格式
+constexpr uint16_t kBlockFormatV2Flag = 0x8000;
+constexpr uint16_t kBlockCrc32cFlag = 0x4000;
+constexpr uint16_t kDefaultBlockRestartInterval = 16;
+
 class Block : public std::enable_shared_from_this<Block> {
   friend BlockIterator;
 
-private:
-  std::vector<uint8_t> data;
-  std::vector<uint16_t> offsets;
-  size_t capacity;
+public:
   struct Entry {
     std::string key;
     std::string value;
     uint64_t tranc_id; // 事务 id
   };
-  Entry get_entry_at(size_t offset) const;
-  std::string get_key_at(size_t offset) const;
+
+private:
+  std::vector<uint8_t> data;
+  std::vector<uint16_t> offsets;
+  size_t capacity;
+  // 为 0 时按 v1 格式保存完整的 key
+  uint16_t restart_interval_ = 0;
+  // 构建时记录上一个 key, 用于计算公共前缀
+  std::string last_key_;
+
+  // decode_view 得到的 block 不拷贝数据, 直接指向 sst 的 mmap 映射区域
+  bool is_view_ = false;
+  const uint8_t *view_data_ = nullptr;
+  size_t view_data_size_ = 0;
+  const uint8_t *view_offsets_ = nullptr;
+  size_t view_num_entries_ = 0;
+  // 保证映射区域在 block 存活期间有效
+  std::shared_ptr<const void> view_owner_;
+
+  const uint8_t *data_ptr() const;
+  size_t data_size() const;
+  uint16_t offset_at(size_t idx) const;
+
+  // 相邻 restart 点之间的 entry 数, v1 格式的每个 entry 都是 restart 点
+  size_t restart_interval() const;
+  // 将 key 更新为第 idx 个 entry 的 key, 调用前 key 需为第 idx - 1 个
+  // entry 的 key; idx 为 restart 点时不依赖 key 原有的内容
+  void decode_key(size_t idx, std::string &key) const;
+  // 从所在的 restart 点开始顺序解码出第 idx 个 entry 的 key
+  std::string get_key_by_idx(size_t idx) const;
+  // 指定偏移量处 entry 的 value_len 字段的位置
+  size_t value_len_pos(size_t offset) const;
   std::string get_value_at(size_t offset) const;
   uint64_t get_tranc_id_at(size_t offset) const;
 
-  int compare_key_at(size_t offset, const std::string &target) const;
-  int adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id);
-
   bool is_same_key(size_t idx, const std::string &target_key) const;
 
 public:
   Block() = default;
-  Block(size_t cap);
+  // restart_interval 为 0 时按 v1 格式编码
+  Block(size_t cap, uint16_t restart_interval = kDefaultBlockRestartInterval);
   std::vector<uint8_t> encode(bool with_hash = true);
   static std::shared_ptr<Block> decode(const std::vector<uint8_t> &encoded,
                                        bool with_hash = true);
+  // 零拷贝解码, 返回的 block 引用 encoded 指向的内存, owner 负责保持其有效
+  static std::shared_ptr<Block> decode_view(const uint8_t *encoded,
+                                            size_t encoded_size,
+                                            bool with_hash,
+                                            std::shared_ptr<const void> owner);
   std::string get_first_key();
   size_t get_offset_at(size_t idx) const;
+  // 按下标获取 entry, 同一个 key 的所有版本都可以访问到
+  Entry get_entry_by_idx(size_t idx) const;
   bool add_entry(const std::string &key, const std::string &value,
                  uint64_t tranc_id, bool force_write);
   std::optional<std::string> get_value_binary(const std::string &key,
                                               uint64_t tranc_id);
   size_t size() const;
   size_t cur_size() const;
+  // block 占用的内存字节数, 作为 block cache 的计费;
+  // 零拷贝的 block 计入其引用的映射区域大小
+  size_t memory_usage() const;
   bool is_empty() const;
   std::optional<size_t> get_index_binary(const std::string &key,
                                          uint64_t tranc_id);
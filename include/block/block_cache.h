@@ -1,6 +1,8 @@
 #pragma once
 
 #include "block.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -15,8 +17,42 @@ namespace my_tiny_lsm {
 struct CacheItem {
   int sst_id;
   int block_id;
-  std::shared_ptr<Block> block_ptr;
+  // data block 或 sst 的 index/filter 分区, 由 get/get_entry 的调用方还原类型
+  std::shared_ptr<void> value;
   uint64_t access_count;
+  size_t charge; // 缓存项占用的字节数, 按此淘汰
+};
+
+struct BlockCacheStats {
+  // 更深的 level 统计到最后一个桶中
+  static constexpr size_t kMaxLevels = 8;
+
+  size_t capacity = 0;        // 容量(字节)
+  size_t usage = 0;           // 当前缓存的 block 占用的字节数
+  size_t entries = 0;         // 当前缓存的 block 数
+  uint64_t inserts = 0;       // 插入的 block 数
+  uint64_t evictions = 0;     // 淘汰的 block 数
+  uint64_t evicted_bytes = 0; // 淘汰的字节数
+  std::array<uint64_t, kMaxLevels> level_requests{};
+  std::array<uint64_t, kMaxLevels> level_hits{};
+
+  double hit_rate() const {
+    uint64_t requests = 0;
+    uint64_t hits = 0;
+    for (size_t i = 0; i < kMaxLevels; ++i) {
+      requests += level_requests[i];
+      hits += level_hits[i];
+    }
+    return requests == 0 ? 0.0 : static_cast<double>(hits) / requests;
+  }
+
+  double level_hit_rate(size_t level) const {
+    level = std::min(level, kMaxLevels - 1);
+    return level_requests[level] == 0
+               ? 0.0
+               : static_cast<double>(level_hits[level]) /
+                     level_requests[level];
+  }
 };
 
 struct pair_hash {
@@ -38,28 +74,54 @@ struct pair_equal {
 
 class BlockCache {
 public:
-  BlockCache(size_t capacity, size_t k);
+  // capacity 为所有分片的总容量(字节), 平均分配到各个分片
+  BlockCache(size_t capacity, size_t k, size_t num_shards = kDefaultNumShards);
   ~BlockCache();
-  std::shared_ptr<Block> get(int sst_id, int block_id);
+  // level 为 block 所在 sst 的层级, 仅用于统计各层的命中率
+  std::shared_ptr<Block> get(int sst_id, int block_id, size_t level = 0);
+  // 按 block->memory_usage() 计费, 超出容量时按 LRU-K 顺序淘汰
   void put(int stt_id, int block_id, std::shared_ptr<Block> block);
+  // 缓存 data block 以外的对象, 如 sst 的 index 和 filter 分区,
+  // 与 data block 共享容量和淘汰顺序, 调用方使用负数的 block_id 避免冲突
+  std::shared_ptr<void> get_entry(int sst_id, int block_id, size_t level = 0);
+  void put_entry(int sst_id, int block_id, std::shared_ptr<void> value,
+                 size_t charge);
   double hit_rate() const;
+  BlockCacheStats get_stats() const;
+
+  static constexpr size_t kDefaultNumShards = 16;
+  // 每个分片的最小容量(字节)
+  static constexpr size_t kMinShardCapacity = 64 * 1024;
 
 private:
-  size_t capacity_;
-  size_t k_; // 划分两部分的阈值
-  mutable std::mutex mutex_;
+  // 每个分片是一个独立加锁的 LRU-K 缓存
+  struct Shard {
+    size_t capacity_;
+    mutable std::mutex mutex_;
 
-  std::list<CacheItem> cache_list_greater_k;
-  std::list<CacheItem> cache_list_less_k;
-  //   键为 (sst_id, block_id) 的组合 ，值为指向 cache_list 中对应 CacheItem
-  //   的迭代器
-  std::unordered_map<std::pair<int, int>, std::list<CacheItem>::iterator,
-                     pair_hash, pair_equal>
-      cache_map_;
+    std::list<CacheItem> cache_list_greater_k;
+    std::list<CacheItem> cache_list_less_k;
+    //   键为 (sst_id, block_id) 的组合 ，值为指向 cache_list 中对应 CacheItem
+    //   的迭代器
+    std::unordered_map<std::pair<int, int>, std::list<CacheItem>::iterator,
+                       pair_hash, pair_equal>
+        cache_map_;
 
-  void update_access_time(std::list<CacheItem>::iterator it);
+    size_t usage_ = 0;
+    uint64_t inserts_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t evicted_bytes_ = 0;
+    std::array<uint64_t, BlockCacheStats::kMaxLevels> level_requests_{};
+    std::array<uint64_t, BlockCacheStats::kMaxLevels> level_hits_{};
+  };
+
+  size_t capacity_;
+  size_t k_; // 划分两部分的阈值
+  std::vector<std::unique_ptr<Shard>> shards_;
 
-  mutable size_t total_requests_ = 0;
-  mutable size_t hit_requests_ = 0;
+  Shard &shard_for(int sst_id, int block_id);
+  void update_access_time(Shard &shard, std::list<CacheItem>::iterator it);
+  // 淘汰 block 直到能再容纳 charge 字节
+  void evict(Shard &shard, size_t charge);
 };
 } // namespace my_tiny_lsm
\ No newline at end of file
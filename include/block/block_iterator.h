@@ -31,6 +31,8 @@ public:
   bool operator==(const BlockIterator &other) const;
   bool operator!=(const BlockIterator &other) const;
   bool is_end() const;
+  // 当前 entry 在 block 中的序号
+  size_t index() const { return current_index; }
 
 private:
   void update_current()const;
@@ -39,5 +41,8 @@ private:
   size_t current_index;
   uint64_t tranc_id_;
   mutable std::optional<value_type> cached_value;
+  // operator++ 顺序解码得到的当前 entry 的 key, 为空时 (构造或 seek 之后)
+  // 才需要从 restart 点开始解码
+  std::optional<std::string> current_key_;
 };
 } // namespace my_tiny_lsm
\ No newline at end of file
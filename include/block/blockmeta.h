@@ -12,11 +12,13 @@ public:
   size_t offset;
   std::string first_key;
   std::string last_key;
-  //   序列化和反序列化
+  //   序列化和反序列化, 校验和使用 crc32c
   static void encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
                                    std::vector<uint8_t> &metadata);
+  // 旧版本 sst 的元数据块使用 std::hash 校验, 此时 crc32c_checksum 为 false
   static std::vector<BlockMeta>
-  decode_meta_from_slice(const std::vector<uint8_t> &metadata);
+  decode_meta_from_slice(const std::vector<uint8_t> &metadata,
+                         bool crc32c_checksum = true);
   BlockMeta();
   BlockMeta(size_t off, const std::string &first, const std::string &last);
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 分区索引中的顶层索引项, 描述一个 index 分区及其对应的 filter 分区
+// index 分区是连续若干个 data block 的 BlockMeta, 编码格式与元数据块相同;
+// filter 分区是这些 block 中所有 key 的过滤器
+class IndexPartition {
+public:
+  uint32_t first_block = 0; // 分区中第一个 block 在 sst 中的序号, 不编码
+  uint32_t num_blocks = 0;
+  uint32_t blocks_end = 0; // 分区最后一个 data block 的结束位置
+  uint32_t index_offset = 0;
+  uint32_t index_size = 0;
+  uint32_t filter_offset = 0;
+  uint32_t filter_size = 0; // 为 0 时没有 filter 分区
+  std::string first_key;
+  std::string last_key;
+
+  // 编码格式: [num(u32)][entry...][crc32c(u32)], 每个 entry 为
+  // [num_blocks][blocks_end][index_offset][index_size][filter_offset]
+  // [filter_size](均为 u32)[first_key_len(u16)][first_key]
+  // [last_key_len(u16)][last_key]
+  static void encode_to_slice(const std::vector<IndexPartition> &partitions,
+                              std::vector<uint8_t> &data);
+  static std::vector<IndexPartition>
+  decode_from_slice(const std::vector<uint8_t> &data);
+
+  // 内存中占用的字节数
+  size_t memory_usage() const;
+};
+} // namespace my_tiny_lsm
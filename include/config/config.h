@@ -17,11 +17,24 @@ private:
   long long lsm_per_mem_size_limit_;
   int lsm_block_size_;
   int lsm_sst_level_ratio_;
+  // data block 中 restart 点的间隔, 为 0 时不做 key 的前缀压缩
+  int lsm_block_restart_interval_;
+  // sst 的 index 分区的目标大小(字节), 为 0 时整个 sst 只有一个分区
+  int lsm_index_partition_size_;
 
   // --- LSM Cache ---
-  int lsm_block_cache_capacity_;
+  long long lsm_block_cache_capacity_; // 单位为字节
   int lsm_block_cache_k_;
 
+  // --- LSM Compaction ---
+  int lsm_compaction_threads_;
+  std::string lsm_compact_type_; // "full", "leveled" 或 "tiered"
+
+  // --- LSM SST IO ---
+  std::string lsm_sst_read_mode_; // "stream", "pread", "direct" 或 "mmap"
+  // 各层 sst 的 data block 压缩方式: "none" 或 "lz4", 更深的层使用最后一个值
+  std::vector<std::string> lsm_block_compression_;
+
   // --- Redis Headers/Separators ---
   std::string redis_expire_header_;
   std::string redis_hash_value_preffix_;
@@ -35,6 +48,13 @@ private:
   // --- Bloom Filter ---
   int bloom_filter_expected_size_;
   double bloom_filter_expected_error_rate_;
+  // 各层 sst 的过滤器类型: "standard", "blocked", "fuse8" 或 "fuse16",
+  // 更深的层使用最后一个值
+  std::vector<std::string> bloom_filter_types_;
+  // 各层 sst 的过滤器每个 key 分配的位数, 更深的层使用最后一个值
+  std::vector<double> bloom_filter_bits_per_key_;
+  // 前缀过滤器的前缀提取方式, 如 "fixed:8" 或 "delim::", 为空时不启用
+  std::string bloom_filter_prefix_extractor_;
 
   // Private method to set default values
   void setDefaultValues();
@@ -58,10 +78,18 @@ public:
   long long getLsmPerMemSizeLimit() const;
   int getLsmBlockSize() const;
   int getLsmSstLevelRatio() const;
+  int getLsmBlockRestartInterval() const;
+  int getLsmIndexPartitionSize() const;
 
-  int getLsmBlockCacheCapacity() const;
+  long long getLsmBlockCacheCapacity() const;
   int getLsmBlockCacheK() const;
 
+  int getLsmCompactionThreads() const;
+  const std::string &getLsmCompactType() const;
+
+  const std::string &getLsmSstReadMode() const;
+  const std::string &getLsmBlockCompression(size_t level) const;
+
   const std::string &getRedisExpireHeader() const;
   const std::string &getRedisHashValuePreffix() const;
   const std::string &getRedisFieldPrefix() const;
@@ -73,6 +101,9 @@ public:
 
   int getBloomFilterExpectedSize() const;
   double getBloomFilterExpectedErrorRate() const;
+  const std::string &getBloomFilterType(size_t level) const;
+  double getBloomFilterBitsPerKey(size_t level) const;
+  const std::string &getBloomFilterPrefixExtractor() const;
 
   static const TomlConfig &
   getInstance(const std::string &config_path = "config.toml");
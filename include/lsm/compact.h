@@ -1,7 +1,128 @@
 #pragma once
 
+#include "../block/block.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
 namespace my_tiny_lsm {
+
+class SST;
+
 enum class CompactType {
-  FullCompact,
+  FullCompact,    // 将 level N 和 level N+1 的全部 sst 重写
+  LeveledCompact, // 每次只挑选 level N 的一个 sst, 与 level N+1 的重叠部分合并
+  TieredCompact,  // 每个 sst 是一个 sorted run, 同层的 run 大小相近且互相重叠,
+                  // 数量超限时合并为一个 run 放入下一层
 };
+
+// 配置文件中的字符串 -> CompactType, 无法识别时退回 FullCompact
+inline CompactType compact_type_from_string(const std::string &name) {
+  if (name == "leveled") {
+    return CompactType::LeveledCompact;
+  }
+  if (name == "tiered") {
+    return CompactType::TieredCompact;
+  }
+  return CompactType::FullCompact;
 }
+
+// 后台 compact 任务的计数器
+struct CompactionStats {
+  size_t queued;   // 已提交但尚未开始的任务数
+  size_t running;  // 正在执行的任务数
+  size_t finished; // 已完成的任务数
+
+  uint64_t flush_bytes;         // memtable 刷入 l0 的字节数
+  uint64_t compact_read_bytes;  // compact 读取的 sst 字节数
+  uint64_t compact_write_bytes; // compact 写出的 sst 字节数
+
+  uint64_t dropped_versions;   // compact 时清理的不可见旧版本数
+  uint64_t dropped_tombstones; // 写入最底层时清理的删除标记数
+
+  // 写放大 = 磁盘总写入量 / 刷盘的用户数据量
+  double write_amplification() const {
+    if (flush_bytes == 0) {
+      return 0.0;
+    }
+    return static_cast<double>(flush_bytes + compact_write_bytes) /
+           flush_bytes;
+  }
+};
+
+// 合并多个 sorted run 中 key 的所有版本, 按 (key 升序, tranc_id 降序) 输出
+// 同一个 key 只保留:
+//   1. tranc_id 大于 oldest_tranc_id 的版本, 仍可能被活跃事务区分
+//   2. tranc_id 小于等于 oldest_tranc_id 的最新版本,
+//      所有活跃事务看到的都是它, 更旧的版本被丢弃
+// 如果 2 中保留的版本是删除标记且输出到最底层, 它也可以被丢弃
+class CompactMerger {
+public:
+  // runs 按从新到旧排列, 每个 run 内的 sst 之间没有重叠且按 key 升序排列
+  CompactMerger(std::vector<std::vector<std::shared_ptr<SST>>> runs,
+                uint64_t oldest_tranc_id, bool drop_tombstones);
+
+  bool is_valid() const;
+  void next();
+
+  const std::string &key() const;
+  const std::string &value() const;
+  uint64_t tranc_id() const;
+
+  uint64_t dropped_versions() const;
+  uint64_t dropped_tombstones() const;
+
+private:
+  // 一个 run 上的游标, 依次遍历其中每个 sst 的每个 block 的每个 entry
+  struct RunCursor {
+    std::vector<std::shared_ptr<SST>> ssts;
+    size_t sst_idx = 0;
+    size_t block_idx = 0;
+    size_t entry_idx = 0;
+    std::shared_ptr<Block> block;
+  };
+
+  struct HeapItem {
+    Block::Entry entry;
+    size_t run_idx;
+  };
+
+  struct HeapItemGreater {
+    bool operator()(const HeapItem &a, const HeapItem &b) const {
+      if (a.entry.key != b.entry.key) {
+        return a.entry.key > b.entry.key;
+      }
+      if (a.entry.tranc_id != b.entry.tranc_id) {
+        return a.entry.tranc_id < b.entry.tranc_id;
+      }
+      // 相同版本出现在多个 run 中时, 越新的 run 越靠前
+      return a.run_idx > b.run_idx;
+    }
+  };
+
+  // 将 run 的游标移动到下一个 entry 并压入堆中
+  void push_next(size_t run_idx);
+  // 从堆中取出下一个需要保留的版本放入 current_
+  void advance();
+
+  std::vector<RunCursor> runs_;
+  std::priority_queue<HeapItem, std::vector<HeapItem>, HeapItemGreater> heap_;
+  uint64_t oldest_tranc_id_;
+  bool drop_tombstones_;
+
+  bool valid_ = false;
+  Block::Entry current_;
+  // 正在处理的 key
+  std::string cur_key_;
+  bool has_cur_key_ = false;
+  // 正在处理的 key 是否已经输出过所有活跃事务都可见的版本
+  bool cur_key_settled_ = false;
+  uint64_t last_tranc_id_ = 0;
+
+  uint64_t dropped_versions_ = 0;
+  uint64_t dropped_tombstones_ = 0;
+};
+} // namespace my_tiny_lsm
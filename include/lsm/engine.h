@@ -2,13 +2,20 @@
 
 #include "../memtable/memtable.h"
 #include "../sst/sst.h"
+#include "../utils/thread_pool.h"
 #include "compact.h"
+#include "manifest.h"
 #include "transaction.h"
 #include "two_merge_iterator.h"
+#include "version.h"
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -20,13 +27,18 @@ class LSMEngine : public std::enable_shared_from_this<LSMEngine> {
 public:
   std::string data_dir;
   MemTable memtable; // 当前内存表
+  // sst 记录, 只在 ssts_mtx 写锁下由 flush 和 compact 修改,
+  // 修改后通过 install_version 发布给读者; 读者应使用 get_current_version
   std::map<size_t, std::deque<size_t>> level_sst_ids;
   std::unordered_map<size_t, std::shared_ptr<SST>> ssts;
   std::shared_mutex ssts_mtx;
   std::shared_ptr<BlockCache> block_cache;
   std::weak_ptr<TranManager> tran_manager;
-  size_t next_sst_id;
+  std::atomic<size_t> next_sst_id;
   size_t cur_max_level;
+  CompactType compact_type;
+  // 前缀扫描时用于查询 sst 的前缀过滤器, 未配置时为 nullptr
+  std::shared_ptr<PrefixExtractor> prefix_extractor;
 
 public:
   LSMEngine(std::string path);
@@ -61,25 +73,122 @@ public:
   lsm_iters_monotony_predicate(
       uint64_t tranc_id, std::function<int(const std::string &)> predicate);
 
-  Level_Iterator begin(uint64_t tranc_id);
+  // 返回所有以 preffix 开头的 key, 会跳过前缀过滤器判断不包含该前缀的 sst
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix);
+
+  Level_Iterator begin(uint64_t tranc_id, bool fill_cache = true);
   Level_Iterator end();
 
   static size_t get_sst_size(size_t level);
 
+  // 当前 sst 集合的快照, 不需要加锁
+  std::shared_ptr<const Version> get_current_version() const;
+
   void set_tran_manager(std::shared_ptr<TranManager> tran_manager);
 
+  // 检查各 level 的 sst 数量, 为超限的 level 提交后台 compact 任务
+  void maybe_schedule_compaction();
+
+  // 阻塞直到所有已提交的 compact 任务执行完毕
+  void wait_for_compaction();
+
+  CompactionStats get_compaction_stats();
+
+  BlockCacheStats get_block_cache_stats() const;
+
+  // 该层的 sst 之间是否可能有重叠 (l0 或 tiered 模式下的所有层)
+  bool is_overlapping_level(size_t level) const;
+
+  // 把 tiered 层中按 sst_id 降序排列的 sst 划分为 sorted run, 从新到旧排列
+  // 一个 run 可能由多个 key 不重叠的 sst 组成: 按 sst_id 从小到大,
+  // 首key大于前一个 sst 尾key的 sst 与前一个 sst 属于同一个 run
+  static std::vector<std::vector<std::shared_ptr<SST>>>
+  split_sorted_runs(const std::vector<std::shared_ptr<SST>> &level_ssts);
+
+  // compact 时的可见性水位线, 未设置事务管理器时所有旧版本都可以清理
+  uint64_t get_oldest_active_tranc_id();
+
 private:
+  // 根据 manifest 创建 sst, 不访问 sst 文件
+  void load_from_manifest();
+  // 没有 manifest 时扫描目录中的 sst 文件, 并据此生成 manifest
+  void load_from_directory();
+
+  // filter_prefix 不为空时, 跳过前缀过滤器判断不包含它的 sst
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  iters_monotony_predicate_(uint64_t tranc_id,
+                            std::function<int(const std::string &)> predicate,
+                            const std::optional<std::string> &filter_prefix);
+
+  void run_compaction_job(size_t src_level);
   void full_compact(size_t src_level);
+  void leveled_compact(size_t src_level);
+  void tiered_compact(size_t src_level);
+
+  // 在写锁下用 new_ssts 替换 level x 和 level y 中参与 compact 的 sst
+  void install_compaction(size_t src_level,
+                          const std::vector<std::shared_ptr<SST>> &lx_ssts,
+                          const std::vector<std::shared_ptr<SST>> &ly_ssts,
+                          const std::vector<std::shared_ptr<SST>> &new_ssts);
+
+  // 有重叠的层按 sst_id 降序 (越新越靠前), 其余层按首key升序排列
+  void sort_level(size_t level);
+  // 根据 level_sst_ids 构造新的 Version 并替换当前 Version
+  // 调用方需持有 ssts_mtx 写锁
+  void install_version();
+  // 目标层之下的层都为空时, 输出层就是最底层, 可以清理删除标记
+  // 调用方需持有 ssts_mtx
+  bool is_bottom_level(size_t target_level) const;
+
   std::vector<std::shared_ptr<SST>>
-  full_l0_l1_compact(std::vector<size_t> &l0_ids, std::vector<size_t> &l1_ids);
+  full_l0_l1_compact(std::vector<std::shared_ptr<SST>> &l0_ssts,
+                     std::vector<std::shared_ptr<SST>> &l1_ssts,
+                     bool is_bottom);
 
   std::vector<std::shared_ptr<SST>>
-  full_common_compact(std::vector<size_t> &lx_ids, std::vector<size_t> &ly_ids,
-                      size_t level_y);
+  full_common_compact(std::vector<std::shared_ptr<SST>> &lx_ssts,
+                      std::vector<std::shared_ptr<SST>> &ly_ssts,
+                      size_t level_y, bool is_bottom);
 
-  std::vector<std::shared_ptr<SST>> gen_sst_from_iter(BaseIterator &iter,
+  std::vector<std::shared_ptr<SST>> gen_sst_from_iter(CompactMerger &merger,
                                                       size_t target_sst_size,
                                                       size_t target_level);
+
+  // 读者使用的 sst 集合快照, 只通过 std::atomic_load/std::atomic_store 访问
+  std::shared_ptr<const Version> current_version =
+      std::make_shared<const Version>();
+
+  // 记录 sst 集合的变化, flush 和 compact 在修改内存中的记录前写入
+  std::unique_ptr<Manifest> manifest;
+
+  // compact 输出的单个 sst 的大小上限, sst 中的偏移量是 u32,
+  // 为索引, 过滤器和超出目标大小的同一个 key 的多个版本留出余量
+  static constexpr size_t kMaxCompactSstSize = size_t(1) << 30;
+
+  // 启动时并行打开 sst 的线程数, 打开过程主要在等待 IO, 不按 cpu 核数限制
+  static constexpr size_t kSstOpenThreads = 16;
+
+  // 后台 compact 线程池及其调度状态
+  // compacting_levels 记录正在参与 compact 的 level, 避免两个任务修改同一层
+  std::unique_ptr<ThreadPool> compact_pool;
+  std::mutex compact_mtx;
+  std::condition_variable compact_cv;
+  std::set<size_t> compacting_levels;
+  // 上次 compact 失败的 level, 下次 flush 之前不再调度, 避免持续失败
+  // (磁盘已满, sst 损坏等) 时反复重试
+  std::set<size_t> failed_levels;
+  bool stop_compaction = false;
+  size_t compact_queued = 0;
+  size_t compact_running = 0;
+  size_t compact_finished = 0;
+  uint64_t flush_bytes = 0;
+  uint64_t compact_read_bytes = 0;
+  uint64_t compact_write_bytes = 0;
+  uint64_t dropped_versions = 0;
+  uint64_t dropped_tombstones = 0;
+  // leveled compact 时每一层上次挑选的 sst 的尾key, 下次从其后继续挑选
+  std::map<size_t, std::string> compact_cursor;
 };
 class LSM {
 private:
@@ -101,11 +210,14 @@ public:
   void remove_batch(const std::vector<std::string> &keys);
 
   using LSMIterator = Level_Iterator;
-  LSMIterator begin(uint64_t tranc_id);
+  // 全量扫描时可以传入 fill_cache = false, 避免冲掉 block cache 中的热点数据
+  LSMIterator begin(uint64_t tranc_id, bool fill_cache = true);
   LSMIterator end();
   std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
   lsm_iters_monotony_predicate(
       uint64_t tranc_id, std::function<int(const std::string &)> predicate);
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix);
   void clear();
   void flush();
   void flush_all();
@@ -2,15 +2,17 @@
 #include "../iterator/iterator.h"
 #include <memory>
 #include <optional>
-#include <shared_mutex>
 
 namespace my_tiny_lsm {
 class LSMEngine;
+class Version;
 
 class Level_Iterator : public BaseIterator {
 public:
   Level_Iterator() = default;
-  Level_Iterator(std::shared_ptr<LSMEngine> engine_, uint64_t max_tranc_id);
+  // fill_cache 为 false 时遍历 sst 读取的 block 不放入 block cache
+  Level_Iterator(std::shared_ptr<LSMEngine> engine_, uint64_t max_tranc_id,
+                 bool fill_cache = true);
 
   virtual BaseIterator &operator++() override;
   virtual bool operator==(const BaseIterator &other) const override;
@@ -29,7 +31,8 @@ private:
   size_t cur_idx_;
   uint64_t max_tranc_id_;
   mutable std::optional<value_type> cached_value; // 缓存当前值
-  std::shared_lock<std::shared_mutex> rlock_;
+  // 创建时的 sst 集合, 迭代期间其中的 sst 不会被释放
+  std::shared_ptr<const Version> version_;
 
 private:
   void update_current() const;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../sst/sst.h"
+#include "../utils/append_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// manifest 文件格式:
+// [magic(u32)][version(u8)] + 若干条记录, 每条记录为
+// [payload_len(u32)][payload][crc32c(u32)], payload 是一个 VersionEdit
+// 启动时依次回放所有记录得到当前的 sst 集合, 遇到不完整或校验失败的记录时
+// 认为是写入过程中崩溃留下的尾部, 丢弃它及之后的内容
+constexpr uint32_t kManifestMagic = 0x464E414DU;
+constexpr uint8_t kManifestFormatVersion = 1;
+constexpr size_t kManifestHeaderSize = sizeof(uint32_t) + sizeof(uint8_t);
+// 日志超过该大小时改写为只包含当前 sst 集合的快照
+constexpr size_t kManifestRolloverSize = 4 * 1024 * 1024;
+
+// 对 sst 集合的一次原子修改, 一次 flush 或 compact 对应一个 VersionEdit
+// payload 由若干字段组成, 每个字段以 1 字节的 tag 开头:
+// 1: [next_sst_id(u64)]
+// 2: 新增 sst [level(u32)][sst_id(u64)][file_size(u64)][min_tranc_id(u64)]
+//    [max_tranc_id(u64)][first_key_len(u16)][first_key]
+//    [last_key_len(u16)][last_key]
+// 3: 删除 sst [sst_id(u64)]
+class VersionEdit {
+public:
+  std::optional<uint64_t> next_sst_id;
+  std::vector<SSTMeta> added_ssts;
+  std::vector<size_t> deleted_ssts;
+
+  void encode_to(std::vector<uint8_t> &data) const;
+  static VersionEdit decode(const uint8_t *data, size_t size);
+};
+
+class Manifest {
+public:
+  // 打开 dir 下的 manifest 并回放, 不存在时创建空的 manifest
+  // 打开后总是改写为快照, 丢弃损坏的尾部, 之后的记录追加在快照之后
+  explicit Manifest(const std::string &dir);
+
+  Manifest(const Manifest &) = delete;
+  Manifest &operator=(const Manifest &) = delete;
+
+  static bool exists(const std::string &dir);
+
+  // 打开时回放得到的 sst 集合, 按 sst_id 排序
+  const std::map<size_t, SSTMeta> &live_ssts() const;
+  uint64_t next_sst_id() const;
+
+  // 将 edit 追加到日志并 sync, 成功后才应用到内存中的 sst 集合
+  // 写入失败时抛出异常, 调用方不能安装对应的修改
+  void log_and_apply(const VersionEdit &edit);
+
+private:
+  void apply(const VersionEdit &edit);
+  // 回放已有的日志
+  void recover(const std::string &path);
+  // 把当前 sst 集合写入临时文件, sync 后原子地替换 manifest
+  void write_snapshot();
+
+  std::string dir_;
+  std::string path_;
+  AppendFile file_;
+  std::mutex mutex_;
+  std::map<size_t, SSTMeta> live_ssts_;
+  uint64_t next_sst_id_ = 0;
+};
+} // namespace my_tiny_lsm
@@ -71,12 +71,17 @@ public:
   uint64_t getNextTransactionId();
   uint64_t get_max_flushed_tranc_id();
   uint64_t get_checkpoint_tranc_id();
+  // 仍在进行中的最老事务的 id, 没有活跃事务时返回下一个将分配的 id
+  // 比它更旧且已被更新版本覆盖的记录对任何事务都不可见
+  uint64_t get_oldest_active_tranc_id();
 
   std::set<uint64_t> &get_flushed_tranc_ids();
   void add_ready_to_flush_tranc_id(uint64_t tranc_id, TransactionState state);
   void add_flushed_tranc_id(uint64_t tranc_id);
 
   bool write_to_wal(const std::vector<Record> &records);
+  // wal 组提交的批大小和 sync 耗时分布
+  WALStats get_wal_stats();
   std::map<uint64_t, std::vector<Record>> check_recover();
   std::string get_tranc_id_file_path();
   void write_tranc_id_file();
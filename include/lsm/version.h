@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../sst/sst.h"
+#include "../utils/key_fence.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 某一时刻 sst 集合的不可变快照
+// flush 和 compact 在 ssts_mtx 写锁下修改 sst 记录后构造新的 Version,
+// 再原子地替换引擎的当前 Version; 读者只需获取一次当前 Version,
+// 之后不再访问引擎的锁. 读者持有 Version 期间其中的 sst 不会被释放,
+// compact 删除的文件在已打开的状态下仍然可以读取
+class Version {
+public:
+  // 每层的 sst, 有重叠的层按 sst_id 降序 (越新越靠前), 其余层按首key升序
+  // 只包含非空的层
+  std::map<size_t, std::vector<std::shared_ptr<SST>>> levels;
+
+  // 非重叠层中 sst 的首尾 key, 顺序与 levels 中相同, 点查时据此定位 sst
+  struct LevelFence {
+    KeyFence first_keys;
+    KeyFence last_keys;
+  };
+  std::map<size_t, LevelFence> fences;
+
+  // 为非重叠层构建 fence, 需要在 levels 填充完成后调用
+  void build_fence(size_t level);
+
+  // 非重叠层中可能包含 key 的 sst 在该层中的位置,
+  // 不存在时返回该层的 sst 数量; 该层需要已构建 fence
+  size_t find_sst(size_t level, const std::string &key) const;
+
+  // 返回该层的 sst, 不存在时返回空数组
+  const std::vector<std::shared_ptr<SST>> &level(size_t level) const;
+
+  // sst 的总数
+  size_t num_ssts() const;
+};
+} // namespace my_tiny_lsm
@@ -36,6 +36,8 @@ private:
 
   void remove_(const std::string &key, uint64_t transaction_id);
   void frozen_cur_table_();
+  // 获取写锁后再次检查当前表的大小, 超限时冻结
+  void freeze_cur_table_if_full();
 
 public:
   MemTable();
@@ -55,10 +57,14 @@ public:
                     uint64_t transaction_id);
 
   void clear();
+  // 将最旧的冻结表写入 sst, 该表仍保留在 memtable 中,
+  // 调用方在 sst 对读者可见后调用 pop_flushed_table 移除它
   std::shared_ptr<SST> flush_last(SSTBuilder &builder, std::string &sst_path,
                                   size_t sst_id,
                                   std::vector<uint64_t> &flush_transaction_ids,
                                   std::shared_ptr<BlockCache> block_cache);
+  // 移除最旧的冻结表
+  void pop_flushed_table();
   void frozen_cur_table();
   size_t get_cur_size();
   size_t get_frozen_size();
@@ -1,4 +1,8 @@
+#pragma once
+
 #include "../iterator/iterator.h"
+#include "../utils/arena.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -8,64 +12,74 @@
 #include <random>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <tuple>
 #include <utility>
 #include <vector>
 namespace my_tiny_lsm {
 
+// 跳表节点分配在 Arena 中, key 和 value 的字节紧跟在 forward_ 数组之后,
+// 节点本身不需要析构, 整张表在 Arena 释放时一起回收
+// 节点发布之后除 forward_ 外的字段都不再修改, 读者可以不加锁遍历
 struct SkiplistNode {
-  std::string key_;
-  std::string value_;
   uint64_t transaction_id_;
-  std::vector<std::shared_ptr<SkiplistNode>> forward_;
-  //   weak_ptr 防止循环引用导致内存泄漏
-  std::vector<std::weak_ptr<SkiplistNode>> backward_;
-  SkiplistNode(const std::string &key, const std::string &value,
-               uint64_t transaction_id, int level)
-      : key_(key), value_(value), transaction_id_(transaction_id),
-        forward_(level, nullptr),
-        backward_(level, std::weak_ptr<SkiplistNode>()) {}
-
-  void set_backward(int level, std::shared_ptr<SkiplistNode> node) {
-    if (level >= 0 && level < backward_.size()) {
-      backward_[level] = std::weak_ptr<SkiplistNode>(node);
-    }
+  uint32_t key_size_;
+  uint32_t value_size_;
+  int level_;
+  // 每一层的后继节点, 实际长度为 level_
+  std::atomic<SkiplistNode *> forward_[1];
+
+  // 在 arena 中创建一个 level 层的节点
+  static SkiplistNode *create(Arena &arena, std::string_view key,
+                              std::string_view value, uint64_t transaction_id,
+                              int level);
+
+  std::string_view key() const {
+    return std::string_view(data(), key_size_);
   }
-  bool operator==(const SkiplistNode &other) const {
-    return key_ == other.key_ && value_ == other.value_ &&
-           transaction_id_ == other.transaction_id_;
+  std::string_view value() const {
+    return std::string_view(data() + key_size_, value_size_);
+  }
+
+  // acquire 保证读到的后继节点已经完整初始化
+  SkiplistNode *next(int level) const {
+    return forward_[level].load(std::memory_order_acquire);
+  }
+  void set_next(int level, SkiplistNode *node) {
+    forward_[level].store(node, std::memory_order_release);
+  }
+  // 节点尚未发布时使用, 之后的 cas_next 会带上内存屏障
+  void no_barrier_set_next(int level, SkiplistNode *node) {
+    forward_[level].store(node, std::memory_order_relaxed);
+  }
+  bool cas_next(int level, SkiplistNode *expected, SkiplistNode *node) {
+    return forward_[level].compare_exchange_strong(expected, node);
   }
 
-  bool operator!=(const SkiplistNode &other) const { return !(*this == other); }
   // 事务越大的排在前面
-  bool operator<(const SkiplistNode &other) const {
-    if (key_ == other.key_) {
-      return transaction_id_ > other.transaction_id_;
+  bool less_than(std::string_view key, uint64_t transaction_id) const {
+    int cmp = this->key().compare(key);
+    if (cmp == 0) {
+      return transaction_id_ > transaction_id;
     }
-    return key_ < other.key_;
+    return cmp < 0;
   }
-  bool operator>(const SkiplistNode &other) const {
-    if (key_ == other.key_) {
-      return transaction_id_ < other.transaction_id_;
-    }
-    return key_ > other.key_;
+
+private:
+  const char *data() const {
+    return reinterpret_cast<const char *>(&forward_[level_]);
   }
 };
 
 class SkiplistIterator : public BaseIterator {
 public:
-  SkiplistIterator(std::shared_ptr<SkiplistNode> node) : current(node){};
-  SkiplistIterator() : current(nullptr), lock(nullptr){};
+  // 迭代器持有 arena 的引用, 表被冻结并刷盘后节点仍然有效
+  SkiplistIterator(SkiplistNode *node, std::shared_ptr<Arena> arena)
+      : current(node), arena(std::move(arena)){};
+  SkiplistIterator() : current(nullptr), arena(nullptr){};
   // friend class Skiplist;
   virtual BaseIterator &operator++() override;
-  virtual BaseIterator &operator--() override {
-    if (current) {
-      auto backward = current->backward_[0].lock();
-      current = backward;
-    }
-    return *this;
-  }
   virtual bool operator==(const BaseIterator &other) const override;
   virtual bool operator!=(const BaseIterator &other) const override;
   virtual value_type operator*() const override;
@@ -77,36 +91,39 @@ public:
   uint64_t get_transaction_id() const override;
 
 private:
-  std::shared_ptr<SkiplistNode> current;
-  std::shared_ptr<std::shared_lock<std::shared_mutex>> lock;
+  SkiplistNode *current;
+  std::shared_ptr<Arena> arena;
 };
 
+// put 可以由多个线程并发调用, 节点通过 CAS 逐层链接, 不需要加锁;
+// get 和各种迭代器可以与 put 并发执行
+// remove 和 clear 会摘除节点, 调用方需保证此时没有其他线程访问跳表
 class Skiplist {
 private:
-  std::shared_ptr<SkiplistNode> head;
+  // 层数上限, put/remove 的前驱节点数组按它在栈上分配
+  static constexpr int kMaxLevel = 30;
+
+  std::shared_ptr<Arena> arena;
+  SkiplistNode *head;
   int max_level;
-  int current_level;
-  size_t size_bytes;
-  //   random engine for level generation
-  std::uniform_int_distribution<> dis_01;
-  std::uniform_int_distribution<> dis_level;
-  std::mt19937 gen;
+  std::atomic<int> current_level;
+  std::atomic<size_t> size_bytes;
 
   int random_level();
+  SkiplistIterator make_iterator(SkiplistNode *node) const;
+
+  // 从 before 开始在 level 层向后查找 (key, transaction_id) 的插入位置,
+  // 结果满足 *prev < (key, transaction_id) <= *next
+  void find_splice_for_level(std::string_view key, uint64_t transaction_id,
+                             SkiplistNode *before, int level,
+                             SkiplistNode **prev, SkiplistNode **next) const;
 
 public:
   Skiplist(int max_level = 16);
-  ~Skiplist() {
-    auto current = head;
-    while (current && current->forward_[0]) {
-      auto next = current->forward_[0];
-      for (int i = 0; i < current->forward_.size(); ++i) {
-        current->forward_[i].reset();
-      }
-      current = next;
-    }
-    head.reset();
-  }
+
+  // 禁用拷贝
+  Skiplist(const Skiplist &) = delete;
+  Skiplist &operator=(const Skiplist &) = delete;
 
   // 插入或更新键值对
   // 这里不对 transaction_id 进行检查，由上层保证 transaction_id 的合法性
@@ -126,8 +143,12 @@ public:
   // value 为 真实 value 和 transaction_id 的二元组
   std::vector<std::tuple<std::string, std::string, uint64_t>> flush();
 
+  // key + value + transaction_id 的字节数, 即刷盘的数据量
   size_t get_size();
 
+  // arena 实际占用的内存字节数, 包括节点指针和已 remove 的节点
+  size_t get_memory_usage() const;
+
   void clear(); // 清空跳表，释放内存
 
   SkiplistIterator begin();
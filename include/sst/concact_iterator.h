@@ -13,10 +13,11 @@ private:
   size_t cur_idx;
   std::vector<std::shared_ptr<SST>> ssts;
   uint64_t max_tranc_id_;
+  bool fill_cache_;
 
 public:
   ConcactIterator(std::vector<std::shared_ptr<SST>> ssts,
-                  uint64_t max_tranc_id);
+                  uint64_t max_tranc_id, bool fill_cache = true);
 
   std::string key();
   std::string value();
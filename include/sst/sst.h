@@ -3,11 +3,15 @@
 #include "../block/block.h"
 #include "../block/block_cache.h"
 #include "../block/blockmeta.h"
-#include "../utils/bloom_filter.h"
+#include "../block/index_partition.h"
+#include "../utils/filter.h"
+#include "../utils/compression.h"
 #include "../utils/files.h"
+#include "../utils/prefix_extractor.h"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,6 +20,44 @@ namespace my_tiny_lsm {
 
 class SSTableIterator;
 
+// sst 文件尾部格式
+// v0: [meta_offset(u32)][bloom_offset(u32)][min_tranc_id(u64)][max_tranc_id(u64)]
+// v1: v0 + [filter_type(u8)][version(u8)][magic(u32)]
+// v2: v0 + [prefix_filter_offset(u32)][prefix_filter_type(u8)] + v1 的扩展部分
+//     前缀过滤器位于布隆过滤器和 v0 尾部之间, 格式为
+//     [extractor_name_len(u16)][extractor_name][filter],
+//     不存在时 prefix_filter_offset 等于 v0 尾部的起始位置
+// v3: 尾部与 v2 相同, data block 可能使用带前缀压缩的 v2 block 格式
+// v4: 尾部与 v2 相同, 每个 data block 之后追加 1 字节的 CompressionType,
+//     压缩的 block 保存 compress_block 的结果, 否则保存 Block::encode 的结果
+// v5: 尾部与 v2 相同, 元数据块和 data block 的校验和改为 crc32c
+// v6: 尾部与 v2 相同, 索引和过滤器分区存储:
+//     [data blocks][index 分区 0][filter 分区 0]...[顶层索引][前缀过滤器][尾部]
+//     meta_offset 指向顶层索引(IndexPartition 的编码), 布隆过滤器区域为空,
+//     open 时只读取顶层索引, 分区在使用时通过 block cache 加载
+// v7: 格式与 v6 相同, 过滤器改用固定的 Filter::hash_key,
+//     更早的版本使用 std::hash, 探测时使用 Filter::legacy_hash_key
+// 旧文件末尾是 max_tranc_id 的高 32 位, 不会与 magic 相同,
+// 因此可以通过末尾 4 字节区分新旧格式
+constexpr uint32_t kSstMagic = 0x54534D4C;
+constexpr uint8_t kSstFormatVersion = 7;
+constexpr size_t kSstFooterV0Size = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2;
+constexpr size_t kSstFooterExtSize = sizeof(uint8_t) * 2 + sizeof(uint32_t);
+constexpr size_t kSstFooterPrefixExtSize = sizeof(uint32_t) + sizeof(uint8_t);
+// 尾部和索引中的偏移量都是 u32, sst 文件不能超过该大小
+constexpr uint64_t kSstMaxFileSize = UINT32_MAX;
+
+// manifest 中记录的 sst 元数据, 启动时据此创建 sst 而不需要读取文件
+struct SSTMeta {
+  size_t sst_id = 0;
+  size_t level = 0;
+  uint64_t file_size = 0;
+  uint64_t min_tranc_id = 0;
+  uint64_t max_tranc_id = 0;
+  std::string first_key;
+  std::string last_key;
+};
+
 class SST : public std::enable_shared_from_this<SST> {
   friend class SSTBuilder;
   friend std::optional<std::pair<SSTableIterator, SSTableIterator>>
@@ -24,31 +66,91 @@ class SST : public std::enable_shared_from_this<SST> {
 
 private:
   FileObj file;
-  std::vector<BlockMeta> meta_entries;
+  // open_lazy 创建的 sst 在首次访问数据时才打开文件, 读取尾部和顶层索引
+  std::string path;
+  FileReadMode read_mode = FileReadMode::Pread;
+  bool lazy = false;
+  std::once_flag load_flag;
+  size_t file_size = 0;
+  // 顶层索引, 常驻内存; v6 之前的 sst 视为只有一个分区
+  std::vector<IndexPartition> index_partitions;
+  // v6 之前的 sst 的元数据块在 open 时解码并常驻内存, 作为唯一的 index 分区
+  std::shared_ptr<std::vector<BlockMeta>> pinned_index;
+  size_t block_count = 0;
   uint32_t bloom_offset;
   uint32_t meta_block_offset;
   size_t sst_id;
   std::string first_key;
   std::string last_key;
-  std::shared_ptr<BloomFilter> bloom_filter;
+  FilterType filter_type = FilterType::Bloom;
+  // 按 key 前缀构建的过滤器的位置, 以及构建时使用的前缀提取方式,
+  // 过滤器本身与分区一样通过 block cache 加载
+  uint32_t prefix_filter_offset = 0;
+  uint32_t prefix_filter_size = 0;
+  FilterType prefix_filter_type = FilterType::Bloom;
+  std::string prefix_extractor_name;
   std::shared_ptr<BlockCache> block_cache;
   uint64_t min_tranc_id;
   uint64_t max_tranc_id;
+  size_t level = 0; // sst 所在的层级, 用于统计 block cache 各层的命中率
+  uint8_t format_version = 0; // 尾部格式版本, 旧文件为 0
+
+  // 读取尾部和顶层索引, lazy 为 true 时首尾 key 和事务 id 已由 manifest 给出
+  void load();
+  void ensure_loaded();
+
+  // 分区在 block cache 中的 block_id, 使用负数与 data block 区分
+  static constexpr int kPrefixFilterCacheId = -1;
+  static int index_partition_cache_id(size_t partition);
+  static int filter_partition_cache_id(size_t partition);
+
+  // 第一个 last_key >= key 的分区, 不存在时返回分区数
+  size_t find_partition(const std::string &key) const;
+  // block_idx 所在的分区
+  size_t partition_of_block(size_t block_idx) const;
+  // 加载第 partition 个 index 分区, 先查询 block cache
+  std::shared_ptr<std::vector<BlockMeta>>
+  load_index_partition(size_t partition, bool fill_cache = true);
+  // 加载第 partition 个 filter 分区, 没有过滤器时返回 nullptr
+  std::shared_ptr<Filter> load_filter_partition(size_t partition);
+  // 从文件读取过滤器, 并以 cache_id 放入 block cache
+  std::shared_ptr<Filter> load_filter(int cache_id, FilterType type,
+                                      uint32_t offset, uint32_t size);
+  // 按 sst 的格式版本选择写入过滤器时使用的哈希函数
+  uint64_t filter_hash(const std::string &key) const;
 
 public:
   static std::shared_ptr<SST> open(size_t sst_id, FileObj file,
-                                   std::shared_ptr<BlockCache> block_cache);
+                                   std::shared_ptr<BlockCache> block_cache,
+                                   size_t level = 0);
+  // 使用 manifest 中的元数据创建 sst, 不访问文件;
+  // 首次读取数据时才按 read_mode 打开文件
+  static std::shared_ptr<SST> open_lazy(const SSTMeta &meta,
+                                        const std::string &path,
+                                        FileReadMode read_mode,
+                                        std::shared_ptr<BlockCache> block_cache);
+  // 删除文件, 尚未打开的 sst 会先打开, 保证仍持有它的读者可以继续读取
   void del_sst();
 
-  std::shared_ptr<Block> read_block(size_t block_idx);
+  // 设置底层文件的访问模式提示, compaction 顺序扫描输入 sst 时使用
+  void advise(FileAccessHint hint);
+
+  // fill_cache 为 false 时只查询缓存, 未命中时读取的 block 不放入缓存,
+  // 用于 compaction 和全量扫描, 避免冲掉点查的热点 block
+  std::shared_ptr<Block> read_block(size_t block_idx, bool fill_cache = true);
   size_t find_block_idx(const std::string &key);
+
+  // sst 中是否可能存在提取出的前缀为 prefix 的 key,
+  // 没有前缀过滤器或提取方式与构建时不同时总是返回 true
+  bool may_contain_prefix(const std::string &prefix,
+                          const PrefixExtractor &extractor);
   SSTableIterator get(const std::string &key, uint64_t tranc_id);
-  size_t num_blocks() const;
+  size_t num_blocks();
     // 返回sst的首key
-  std::string get_first_key() const;
+  const std::string &get_first_key() const;
 
   // 返回sst的尾key
-  std::string get_last_key() const;
+  const std::string &get_last_key() const;
 
   // 返回sst的大小
   size_t sst_size() const;
@@ -56,13 +158,22 @@ public:
   // 返回sst的id
   size_t get_sst_id() const;
 
+  // 返回sst所在的层级
+  size_t get_level() const;
+
+  // 返回 sst 对象常驻内存的字节数, 不包括 block cache 中的 block 和分区
+  size_t memory_usage() const;
+
   std::optional<std::pair<SSTableIterator, SSTableIterator>>
   iters_monotony_predicate(std::function<bool(const std::string &)> predicate);
 
-  SSTableIterator begin(uint64_t tranc_id);
+  SSTableIterator begin(uint64_t tranc_id, bool fill_cache = true);
   SSTableIterator end();
 
   std::pair<uint64_t, uint64_t> get_tranc_id_range() const;
+
+  // 返回写入 manifest 的元数据
+  SSTMeta get_meta() const;
 };
 class SSTBuilder {
 private:
@@ -72,7 +183,15 @@ private:
   std::vector<BlockMeta> meta_entries;
   std::vector<uint8_t> data;
   size_t block_size;
-  std::shared_ptr<BloomFilter> bloom_filter;
+  bool has_bloom;
+  // 每个不同 key 的哈希值, build 时按实际的 key 数量构建过滤器
+  std::vector<uint64_t> key_hashes;
+  // 每个 block 结束时 key_hashes 的长度, 用于切分 filter 分区
+  std::vector<size_t> block_hash_ends;
+  // 配置了前缀提取方式时, 记录每个不同前缀的哈希值
+  std::shared_ptr<PrefixExtractor> prefix_extractor;
+  std::vector<uint64_t> prefix_hashes;
+  std::string last_prefix;
   uint64_t min_tranc_id;
   uint64_t max_tranc_id;
 
@@ -81,8 +200,10 @@ public:
   void add(const std::string &key, const std::string &value, uint64_t tranc_id);
   size_t estimated_size() const;
   void finish_block();
+  // level 决定过滤器每个 key 分配的位数
   std::shared_ptr<SST> build(size_t sst_id, const std::string &path,
-                             std::shared_ptr<BlockCache> block_cache);
+                             std::shared_ptr<BlockCache> block_cache,
+                             size_t level = 0);
 };
 
 } // namespace my_tiny_lsm
\ No newline at end of file
@@ -26,6 +26,7 @@ private:
   std::shared_ptr<SST> m_sst;
   size_t m_block_idx;
   uint64_t max_tranc_id_;
+  bool fill_cache_ = true; // 遍历时读取的 block 是否放入 block cache
   std::shared_ptr<BlockIterator> m_block_it;
   mutable std::optional<value_type> cached_value; // 缓存当前值
 
@@ -35,7 +36,8 @@ private:
 
 public:
   // 创建迭代器, 并移动到第一个key
-  SSTableIterator(std::shared_ptr<SST> sst, uint64_t tranc_id);
+  SSTableIterator(std::shared_ptr<SST> sst, uint64_t tranc_id,
+                  bool fill_cache = true);
   // 创建迭代器, 并移动到第指定key
   SSTableIterator(std::shared_ptr<SST> sst, const std::string &key,
                   uint64_t tranc_id);
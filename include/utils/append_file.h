@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace my_tiny_lsm {
+
+// 只追加写入的文件, 直接使用文件描述符
+// 每次 append 对应一次 write 系统调用, 不经过 fstream 的缓冲和 seek
+class AppendFile {
+public:
+  AppendFile() = default;
+  ~AppendFile();
+
+  // 禁用拷贝
+  AppendFile(const AppendFile &) = delete;
+  AppendFile &operator=(const AppendFile &) = delete;
+
+  AppendFile(AppendFile &&other) noexcept;
+  AppendFile &operator=(AppendFile &&other) noexcept;
+
+  // 打开文件, truncate 为 true 时清空已有内容, 失败时抛出异常
+  static AppendFile open(const std::string &path, bool truncate);
+
+  // 将 data 全部追加到文件末尾
+  bool append(const uint8_t *data, size_t size);
+
+  // 将已写入的数据持久化到磁盘
+  bool sync();
+
+  // 当前文件大小
+  size_t size() const;
+
+  void close();
+
+private:
+  int fd_ = -1;
+  size_t size_ = 0;
+};
+} // namespace my_tiny_lsm
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 只能追加分配的内存池, 所有内存在 Arena 析构时一次性释放
+// 允许多个线程同时分配: 在当前块内用 fetch_add 移动偏移量, 不需要加锁,
+// 只有当前块用完需要换块, 或单独分配较大的对象时才加锁
+class Arena {
+public:
+  explicit Arena(size_t block_size = kDefaultBlockSize);
+
+  // 禁用拷贝
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // 分配 bytes 字节, 地址按指针大小对齐
+  char *allocate(size_t bytes);
+
+  // 已向系统申请的总字节数, 包括块中尚未使用的部分
+  // 可以在其他线程分配的同时读取
+  size_t memory_usage() const;
+
+private:
+  static constexpr size_t kDefaultBlockSize = 4096;
+
+  // 一块连续的内存, used 可能因并发分配失败而超过 size, 超出的部分不会被使用
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    std::atomic<size_t> used{0};
+  };
+
+  // 申请 size 字节的新块, 其中前 used 字节已分配给调用方
+  // 调用方需持有 mutex_
+  Chunk *allocate_new_chunk(size_t size, size_t used);
+
+  size_t block_size_;
+  std::mutex mutex_;
+  // 当前用于分配的块, 初始指向大小为 0 的 empty_chunk_
+  std::atomic<Chunk *> current_;
+  Chunk empty_chunk_;
+  std::atomic<size_t> memory_usage_{0};
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+};
+} // namespace my_tiny_lsm
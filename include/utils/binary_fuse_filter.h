@@ -0,0 +1,50 @@
+#pragma once
+
+#include "filter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 3-wise binary fuse filter (Graf & Lemire, 2022)
+// 静态过滤器, 必须一次性由所有 key 的哈希值构建, 之后不能再插入.
+// 每个 key 对应数组中 3 个相邻分段内的位置, 三处指纹异或等于 key 的指纹时
+// 认为 key 可能存在. 空间约为 1.125 * 指纹位数 每个 key,
+// 8 位指纹的假阳性率约 0.39%, 同等假阳性率下比布隆过滤器节省约 20%-30% 空间
+template <typename FingerprintT> class BinaryFuseFilter : public Filter {
+public:
+  BinaryFuseFilter() = default;
+
+  // 由 Filter::hash_key 的结果构建, 重复的哈希值会被去除
+  static BinaryFuseFilter build(std::vector<uint64_t> hashes);
+
+  // 静态过滤器不支持逐个插入, 调用时抛出异常
+  void add(const std::string &key) override;
+  void add_hash(uint64_t hash) override;
+
+  bool possibly_contains_hash(uint64_t hash) const override;
+
+  std::vector<uint8_t> encode() override;
+  static BinaryFuseFilter decode(const std::vector<uint8_t> &data);
+
+  FilterType type() const override;
+
+private:
+  uint64_t seed_ = 0;
+  uint32_t segment_length_ = 0;
+  uint32_t segment_length_mask_ = 0;
+  uint32_t segment_count_length_ = 0;
+  std::vector<FingerprintT> fingerprints_;
+
+  void init_layout(size_t num_keys);
+  // 第 index 个哈希函数对应的数组位置
+  uint32_t position(uint64_t hash, uint32_t index) const;
+  static uint64_t mix(uint64_t hash, uint64_t seed);
+  static FingerprintT fingerprint(uint64_t hash);
+};
+
+using BinaryFuse8Filter = BinaryFuseFilter<uint8_t>;
+using BinaryFuse16Filter = BinaryFuseFilter<uint16_t>;
+} // namespace my_tiny_lsm
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "filter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 分块布隆过滤器 (split block bloom filter)
+// 位数组被划分为 256 bit 的块, 每个 key 只落在一个块内,
+// 并在块的 8 个 32 bit 字中各置 1 位. 一次查询只访问一个 cache line,
+// 8 个字的检查可以用一条 AVX2 指令完成
+class BlockedBloomFilter : public Filter {
+public:
+  BlockedBloomFilter() = default;
+  // expected_elements: 预期插入的元素数量
+  // false_positive_rate: 允许的假阳性率
+  BlockedBloomFilter(size_t expected_elements, double false_positive_rate);
+
+  void add(const std::string &key) override;
+
+  void add_hash(uint64_t hash) override;
+
+  bool possibly_contains_hash(uint64_t hash) const override;
+
+  std::vector<uint8_t> encode() override;
+  static BlockedBloomFilter decode(const std::vector<uint8_t> &data);
+
+  FilterType type() const override { return FilterType::BlockedBloom; }
+
+  static constexpr size_t kWordsPerBlock = 8;
+
+private:
+  // 32 字节对齐, 保证一个块不会跨越两个 cache line
+  struct alignas(32) FilterBlock {
+    uint32_t words[kWordsPerBlock];
+  };
+
+  std::vector<FilterBlock> blocks_;
+
+  size_t block_index(uint64_t hash) const;
+};
+} // namespace my_tiny_lsm
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "filter.h"
 #include <cmath>
 #include <cstdint>
 #include <functional>
@@ -10,7 +11,7 @@
 
 namespace my_tiny_lsm {
 
-class BloomFilter {
+class BloomFilter : public Filter {
 public:
   // 构造函数，初始化布隆过滤器
   // expected_elements: 预期插入的元素数量
@@ -21,17 +22,21 @@ public:
   BloomFilter(size_t expected_elements, double false_positive_rate,
               size_t num_bits);
 
-  void add(const std::string &key);
+  void add(const std::string &key) override;
 
-  // 如果key可能存在于布隆过滤器中，返回true；否则返回false
-  bool possibly_contains(const std::string &key) const;
+  void add_hash(uint64_t hash) override;
+
+  // 如果哈希值对应的key可能存在于布隆过滤器中，返回true；否则返回false
+  bool possibly_contains_hash(uint64_t hash) const override;
 
   // 清空布隆过滤器
   void clear();
 
-  std::vector<uint8_t> encode();
+  std::vector<uint8_t> encode() override;
   static BloomFilter decode(const std::vector<uint8_t> &data);
 
+  FilterType type() const override { return FilterType::Bloom; }
+
 private:
   // 布隆过滤器的位数组大小
   size_t expected_elements_;
@@ -53,5 +58,8 @@ private:
   size_t hash2(const std::string &key) const;
 
   size_t hash(const std::string &key, size_t idx) const;
+
+  // 双重哈希: 由一个 64 位哈希值得到第 idx 个哈希函数对应的位
+  size_t bit_index(uint64_t hash, size_t idx) const;
 };
 } // namespace my_tiny_lsm
\ No newline at end of file
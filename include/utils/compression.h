@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// data block 的压缩方式, 写在 sst 中每个 block 的末尾
+enum class CompressionType : uint8_t {
+  None = 0,
+  LZ4 = 1, // LZ4 block 格式, 内置实现, 不依赖外部库
+};
+
+// 配置文件中的字符串 -> CompressionType, 无法识别时不压缩
+inline CompressionType compression_type_from_string(const std::string &name) {
+  if (name == "lz4") {
+    return CompressionType::LZ4;
+  }
+  return CompressionType::None;
+}
+
+// 压缩结果的格式为 [原始长度(u32)][压缩数据]
+// 压缩后没有明显变小时返回空数组, 调用方应保存原始数据
+std::vector<uint8_t> compress_block(CompressionType type, const uint8_t *data,
+                                    size_t size);
+
+// 解压 compress_block 的结果, 数据损坏时抛出 std::runtime_error
+std::vector<uint8_t> decompress_block(CompressionType type,
+                                      const uint8_t *data, size_t size);
+} // namespace my_tiny_lsm
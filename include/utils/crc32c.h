@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace my_tiny_lsm {
+
+// CRC32C (Castagnoli 多项式), 结果与平台和标准库无关, 可以写入文件.
+// CPU 支持 SSE4.2 时使用 crc32 指令, 否则使用查表实现
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t size);
+
+inline uint32_t crc32c_value(const uint8_t *data, size_t size) {
+  return crc32c_extend(0, data, size);
+}
+
+// 以下函数绕过运行时选择, 供测试和性能测试分别调用两种实现
+uint32_t crc32c_extend_software(uint32_t crc, const uint8_t *data,
+                                size_t size);
+// CPU 是否支持 crc32 指令
+bool crc32c_hardware_supported();
+// 调用前需确认 crc32c_hardware_supported() 为 true
+uint32_t crc32c_extend_hardware(uint32_t crc, const uint8_t *data,
+                                size_t size);
+} // namespace my_tiny_lsm
@@ -1,5 +1,6 @@
 // ...existing code...
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 namespace my_tiny_lsm {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mmap_file.h"
+#include "random_access_file.h"
 #include "std_file.h"
 #include <cstddef>
 #include <cstdint>
@@ -12,9 +13,37 @@ namespace my_tiny_lsm {
 
 class Cursor;
 
+// 只读文件的读取方式
+enum class FileReadMode {
+  Stream, // 通过 StdFile 的 fstream 读取, 不支持多线程并发读
+  Pread,  // 通过 pread 读取, 多线程可以并发读
+  Direct, // 通过 O_DIRECT + pread 读取, 绕过 page cache
+  Mmap,   // 以 PROT_READ 映射整个文件, block 直接引用映射区域
+};
+
+// 配置文件中的字符串 -> FileReadMode, 无法识别时使用 Pread
+inline FileReadMode file_read_mode_from_string(const std::string &name) {
+  if (name == "stream") {
+    return FileReadMode::Stream;
+  }
+  if (name == "direct") {
+    return FileReadMode::Direct;
+  }
+  if (name == "mmap") {
+    return FileReadMode::Mmap;
+  }
+  return FileReadMode::Pread;
+}
+
 class FileObj {
 private:
   std::unique_ptr<StdFile> m_file;
+  // 以 Pread/Direct 方式打开时使用, 此时文件是只读的
+  std::unique_ptr<RandomAccessFile> m_reader;
+  // 以 Mmap 方式打开时使用, 由引用映射区域的 block 共享所有权
+  std::shared_ptr<MmapFile> m_mmap;
+
+  std::vector<uint8_t> read_bytes(size_t offset, size_t length);
 
 public:
   FileObj();
@@ -44,6 +73,18 @@ public:
   // 打开文件对象
   static FileObj open(const std::string &path, bool create);
 
+  // 以只读方式打开文件, 用于 sst 等写入后不再修改的文件
+  static FileObj open_read_only(const std::string &path, FileReadMode mode);
+
+  // Mmap 方式打开时返回映射区域的起始地址, 否则返回 nullptr
+  const uint8_t *mmap_view() const;
+
+  // 映射区域的所有者, 零拷贝的 block 持有它以保证映射不被提前释放
+  std::shared_ptr<const void> mmap_owner() const;
+
+  // 设置访问模式提示, 只对 Mmap 方式打开的文件生效
+  void advise(FileAccessHint hint);
+
   // 读取并返回切片
   std::vector<uint8_t> read_to_slice(size_t offset, size_t length);
 
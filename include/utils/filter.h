@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// sst 中过滤器的类型, 写入 sst 尾部, 解码时据此选择实现
+enum class FilterType : uint8_t {
+  Bloom = 0,        // 标准布隆过滤器, 旧版本 sst 只有这一种
+  BlockedBloom = 1, // 每个 key 的所有探测位都在同一个 256 bit 的块内
+  BinaryFuse8 = 2,  // 静态的 binary fuse filter, 8 位指纹
+  BinaryFuse16 = 3, // 静态的 binary fuse filter, 16 位指纹
+};
+
+// 配置文件中的字符串 -> FilterType, 无法识别时使用 BlockedBloom
+inline FilterType filter_type_from_string(const std::string &name) {
+  if (name == "standard") {
+    return FilterType::Bloom;
+  }
+  if (name == "fuse8") {
+    return FilterType::BinaryFuse8;
+  }
+  if (name == "fuse16") {
+    return FilterType::BinaryFuse16;
+  }
+  return FilterType::BlockedBloom;
+}
+
+// sst 使用的 key 过滤器接口
+class Filter {
+public:
+  virtual ~Filter() = default;
+
+  virtual void add(const std::string &key) = 0;
+
+  // 按 hash_key 的结果插入, 用于先收集哈希值再构建过滤器的场景
+  virtual void add_hash(uint64_t hash) = 0;
+
+  // 按哈希值探测, 与 add_hash 对应
+  virtual bool possibly_contains_hash(uint64_t hash) const = 0;
+
+  // 如果key可能存在于过滤器中，返回true；否则返回false
+  bool possibly_contains(const std::string &key) const {
+    return possibly_contains_hash(hash_key(key));
+  }
+
+  virtual std::vector<uint8_t> encode() = 0;
+
+  virtual FilterType type() const = 0;
+
+  // 所有过滤器共用的 key 哈希函数, 结果会随过滤器写入磁盘,
+  // 因此使用固定的算法 (MurmurHash64A), 不依赖标准库实现和平台
+  static uint64_t hash_key(const std::string &key);
+
+  // v7 之前的 sst 中过滤器使用的哈希 (std::hash), 只用于探测旧文件
+  static uint64_t legacy_hash_key(const std::string &key);
+
+  // 创建指定类型的空过滤器, 不支持静态的 binary fuse filter
+  static std::shared_ptr<Filter> create(FilterType type,
+                                        size_t expected_elements,
+                                        double false_positive_rate);
+
+  // 按实际的 key 数量和每个 key 分配的位数创建过滤器, 并插入所有哈希值;
+  // binary fuse filter 的大小由指纹位数决定, 忽略 bits_per_key
+  static std::shared_ptr<Filter>
+  create_from_hashes(FilterType type, const std::vector<uint64_t> &hashes,
+                     double bits_per_key);
+
+  // 按类型解码 encode 的结果
+  static std::shared_ptr<Filter> decode(FilterType type,
+                                        const std::vector<uint8_t> &data);
+};
+} // namespace my_tiny_lsm
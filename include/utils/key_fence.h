@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 有序 key 数组的紧凑查找结构, 用于在一层的 sst 或 sst 的分区中定位 key
+// 所有 key 去掉公共前缀后, 取接下来的 8 个字节按大端序存为 uint64_t,
+// 连续存放在 prefixes_ 中; 查找时先在前缀数组上做无分支的二分查找,
+// 只有前缀相同的 key 才需要比较完整的 key.
+// 完整的 key 连续存放在 key_data_ 中, 由 offsets_ 定位, 查找时不拷贝 key
+class KeyFence {
+public:
+  KeyFence() = default;
+  // keys 需要按升序排列
+  explicit KeyFence(const std::vector<std::string_view> &keys);
+
+  // 第一个 >= key 的位置, 不存在时返回 size()
+  size_t lower_bound(std::string_view key) const;
+
+  size_t size() const { return prefixes_.size(); }
+  std::string_view key(size_t idx) const {
+    return std::string_view(key_data_).substr(
+        offsets_[idx], offsets_[idx + 1] - offsets_[idx]);
+  }
+
+  // 内存中占用的字节数
+  size_t memory_usage() const;
+
+private:
+  // key 去掉公共前缀后的 8 字节前缀, 不足 8 字节时补 0
+  uint64_t prefix_of(std::string_view key) const;
+  // 第一个 > target (upper 为 true) 或 >= target 的前缀的位置, 要求非空
+  size_t search(uint64_t target, bool upper) const;
+
+  std::string common_prefix_;
+  std::vector<uint64_t> prefixes_;
+  std::vector<uint32_t> offsets_; // 长度为 size() + 1
+  std::string key_data_;
+};
+} // namespace my_tiny_lsm
@@ -10,12 +10,20 @@
 
 namespace my_tiny_lsm {
 
+// 对映射区域的访问模式提示, 对应 madvise 的 advice
+enum class FileAccessHint {
+  Normal,
+  Random,     // 点查, 关闭内核预读
+  Sequential, // compaction 等顺序扫描, 加大预读
+};
+
 class MmapFile {
 private:
   int fd_;               // 文件描述符
   void *mapped_data_;    // 映射的内存地址
   size_t file_size_;     // 文件大小
   std::string filename_; // 文件名
+  bool read_only_ = false; // 以 PROT_READ 映射, 不允许写入
 
   // 获取映射的内存指针
   void *data() const { return mapped_data_; }
@@ -30,6 +38,9 @@ public:
   // 打开文件并映射到内存
   bool open(const std::string &filename, bool create = false);
 
+  // 以只读方式打开并映射, 用于写入后不再修改的 sst 文件
+  bool open_read_only(const std::string &filename);
+
   // 创建文件
   bool create(const std::string &filename, std::vector<uint8_t> &buf);
 
@@ -45,6 +56,17 @@ public:
   // 读取数据
   std::vector<uint8_t> read(size_t offset, size_t length);
 
+  // 映射区域的起始地址, 只读打开时调用方可以直接引用其中的数据而不拷贝
+  const uint8_t *view() const {
+    return static_cast<const uint8_t *>(mapped_data_);
+  }
+
+  // 设置访问模式提示
+  bool advise(FileAccessHint hint);
+
+  // 删除文件, 已建立的映射在 close 之前仍然可读
+  bool remove();
+
   // 同步到磁盘
   bool sync();
 
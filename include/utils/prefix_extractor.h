@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace my_tiny_lsm {
+
+// 从 key 中提取前缀, sst 为提取出的前缀单独构建过滤器,
+// 前缀扫描时据此跳过不可能包含该前缀的 sst
+// 支持的配置:
+//   "fixed:N"  取 key 的前 N 个字节, 长度不足 N 的 key 不参与
+//   "delim:C"  取 key 中第一个字符 C 及之前的部分, 不含 C 的 key 不参与
+class PrefixExtractor {
+public:
+  // spec 为空时返回 nullptr, 表示不启用前缀过滤器
+  static std::shared_ptr<PrefixExtractor> from_string(const std::string &spec);
+
+  // 写入 sst, 打开时配置不同则不使用该 sst 的前缀过滤器
+  const std::string &name() const { return spec_; }
+
+  // key 是否有可提取的前缀
+  bool in_domain(const std::string &key) const;
+
+  // 提取前缀, 要求 in_domain(key)
+  std::string transform(const std::string &key) const;
+
+  // 所有以 scan_prefix 开头的 key 提取出的前缀都相同时返回该前缀,
+  // 否则前缀过滤器无法用于这次扫描
+  std::optional<std::string>
+  prefix_for_scan(const std::string &scan_prefix) const;
+
+private:
+  enum class Kind { Fixed, Delimiter };
+
+  PrefixExtractor(std::string spec, Kind kind, size_t length, char delimiter);
+
+  std::string spec_;
+  Kind kind_;
+  size_t length_;
+  char delimiter_;
+};
+} // namespace my_tiny_lsm
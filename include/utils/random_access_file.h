@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 基于 pread 的只读文件, read 不修改共享的文件偏移量,
+// 多个线程可以同时读取同一个文件而不需要加锁
+class RandomAccessFile {
+public:
+  ~RandomAccessFile();
+
+  // 禁用拷贝
+  RandomAccessFile(const RandomAccessFile &) = delete;
+  RandomAccessFile &operator=(const RandomAccessFile &) = delete;
+
+  // direct_io 为 true 时尝试以 O_DIRECT 打开, 绕过 page cache,
+  // 文件系统不支持时退回普通的 pread
+  static std::unique_ptr<RandomAccessFile> open(const std::string &path,
+                                                bool direct_io);
+
+  // 读取 [offset, offset + length) 的数据, 线程安全
+  std::vector<uint8_t> read(size_t offset, size_t length) const;
+
+  size_t size() const;
+
+  bool is_direct_io() const;
+
+  // 删除文件, 已打开的描述符在析构前仍然可读
+  bool remove();
+
+private:
+  RandomAccessFile() = default;
+
+  // O_DIRECT 要求偏移量, 长度和缓冲区地址都按块对齐
+  static constexpr size_t kDirectIOAlignment = 4096;
+
+  std::vector<uint8_t> read_direct(size_t offset, size_t length) const;
+
+  int fd_ = -1;
+  size_t size_ = 0;
+  bool direct_io_ = false;
+  std::string path_;
+};
+} // namespace my_tiny_lsm
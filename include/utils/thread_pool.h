@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace my_tiny_lsm {
+
+// 简单的固定大小线程池, 任务按提交顺序 FIFO 执行
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t num_threads);
+  ~ThreadPool();
+
+  // 禁用拷贝
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // 提交一个任务, 线程池已停止时返回 false
+  bool submit(std::function<void()> task);
+
+  // 等待已提交的任务全部执行完毕后停止所有工作线程
+  void shutdown();
+
+  size_t num_threads() const;
+
+private:
+  void worker_loop();
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+};
+} // namespace my_tiny_lsm
@@ -15,6 +15,10 @@ enum class OperationType {
   DELETE,
 };
 
+// 记录格式:
+// [record_len(u16)][tranc_id(u64)][operation_type(u8)][key/value][crc32c(u32)]
+// record_len 为整条记录的长度, crc32c 覆盖记录中它之前的所有字节,
+// 旧格式的记录没有 crc32c
 class Record {
 private:
   Record() = default;
@@ -28,7 +32,12 @@ public:
   static Record deleteRecord(uint64_t tranc_id, const std::string &key);
 
   std::vector<uint8_t> encode() const;
-  static std::vector<Record> decode(const std::vector<uint8_t> &data);
+  // 将记录编码到 dst, dst 至少需要 getRecordSize() 字节, 返回写入的字节数
+  size_t encode_to(uint8_t *dst) const;
+  // 遇到不完整或校验失败的记录时停止, 返回它之前的所有记录;
+  // 旧格式的 wal 文件没有校验和, 此时 with_checksum 为 false
+  static std::vector<Record> decode(const std::vector<uint8_t> &data,
+                                    bool with_checksum = true);
   uint64_t getTrancId() const { return tranc_id_; };
   OperationType getOpType() const { return operation_type_; };
   std::string getKey() const { return key_; };
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "../utils/append_file.h"
 #include "../utils/files.h"
 #include "record.h"
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <map>
 #include <mutex>
 #include <string>
@@ -13,6 +17,31 @@
 
 namespace my_tiny_lsm {
 
+// wal 文件格式:
+// v0: 直接由记录组成, 记录没有校验和
+// v1: [0(u16)][magic(u32)][version(u8)] + 记录, 每条记录末尾带有 crc32c
+// v0 文件以记录长度开头, 不会为 0, 因此可以通过开头的 2 字节区分新旧格式
+constexpr uint32_t kWalMagic = 0x4C41574CU;
+constexpr uint8_t kWalFormatVersion = 1;
+constexpr size_t kWalHeaderSize =
+    sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+// 组提交的统计信息, 分布按 2 的幂分桶:
+// 第 i 个桶统计 [2^i, 2^(i+1)) 范围内的值, 第 0 个桶还包括 0
+struct WALStats {
+  static constexpr size_t kBuckets = 24;
+
+  uint64_t groups = 0;  // 写入并 sync 的次数
+  uint64_t writers = 0; // 参与组提交的 log 调用次数
+  uint64_t bytes = 0;   // 写入的字节数
+  std::array<uint64_t, kBuckets> batch_size_hist{};  // 每组的 writer 数
+  std::array<uint64_t, kBuckets> sync_latency_hist{}; // 每组 sync 的耗时(us)
+
+  double avg_batch_size() const {
+    return groups == 0 ? 0.0 : static_cast<double>(writers) / groups;
+  }
+};
+
 class WAL {
 public:
   WAL(const std::string &log_dir, size_t buffer_size,
@@ -24,6 +53,8 @@ public:
   recover(const std::string &log_dir, uint64_t checkpoint_tranc_id);
 
   // 将记录添加到缓冲区
+  // force_flush 或缓冲区已满时需要落盘, 并发的调用会组成一组:
+  // 队首的 leader 用一次 append 和一次 sync 写入整组记录, 再唤醒其余 follower
   void log(const std::vector<Record> &records, bool force_flush = false);
 
   // 强制将缓冲区中的数据写入 WAL 文件
@@ -31,18 +62,40 @@ public:
 
   void set_checkpoint_tranc_id(uint64_t checkpoint_tranc_id);
 
+  WALStats get_stats();
+
 private:
+  // 等待落盘的 log 调用
+  struct Writer {
+    bool done = false;
+    std::exception_ptr error;
+    std::condition_variable cv;
+  };
+
+  // leader 写入缓冲区中的所有记录, 调用时持有 mutex_, 写文件期间会释放
+  void write_group(std::unique_lock<std::mutex> &lock);
+
   void cleaner();
   void cleanWALFile();
   void reset_file();
+  // 在新建的 wal 文件开头写入格式头
+  void write_header();
+  // 返回文件格式版本, 没有格式头的旧文件为 0
+  static uint8_t read_format_version(FileObj &file);
 
 protected:
   std::string active_log_path_;
-  FileObj log_file_;
+  AppendFile log_file_;
   size_t file_size_limit_;
   std::mutex mutex_;
-  std::vector<Record> log_buffer_;
+  // 已编码但尚未写入的记录, leader 写入时与 write_buffer_ 交换,
+  // 两块缓冲区都会被复用, 稳定后不再分配内存
+  std::vector<uint8_t> log_buffer_;
+  std::vector<uint8_t> write_buffer_;
+  size_t buffered_records_ = 0;
   size_t buffer_size_;
+  std::deque<Writer *> writers_;
+  WALStats stats_;
   std::thread cleaner_thread_;
   uint64_t checkpoint_tranc_id_;
   std::atomic<bool> stop_cleaner_;
@@ -1,5 +1,7 @@
 #include "../../include/block/block.h"
 #include "../../include/block/block_iterator.h"
+#include "../../include/utils/crc32c.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -10,11 +12,11 @@
 #include <string>
 
 namespace my_tiny_lsm {
-Block::Block(size_t cap) : capacity(cap) {}
+Block::Block(size_t cap, uint16_t restart_interval)
+    : capacity(cap), restart_interval_(restart_interval) {}
 
 std::vector<uint8_t> Block::encode(bool with_hash) {
-  size_t total_size = data.size() * sizeof(uint8_t) +
-                      offsets.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  size_t total_size = cur_size();
   if (with_hash) {
     total_size += sizeof(uint32_t);
   }
@@ -25,37 +27,91 @@ std::vector<uint8_t> Block::encode(bool with_hash) {
 
   memcpy(encoded.data() + offset_pos, offsets.data(),
          offsets.size() * sizeof(uint16_t));
+
+  size_t num_pos = offset_pos + offsets.size() * sizeof(uint16_t);
+  uint16_t num_entries = offsets.size();
+  if (with_hash) {
+    num_entries |= kBlockCrc32cFlag;
+  }
+  if (restart_interval_ != 0) {
+    memcpy(encoded.data() + num_pos, &restart_interval_, sizeof(uint16_t));
+    num_pos += sizeof(uint16_t);
+    num_entries |= kBlockFormatV2Flag;
+  }
+  memcpy(encoded.data() + num_pos, &num_entries, sizeof(uint16_t));
+
+  if (with_hash) {
+    // 对前面的所有内容计算 crc32c, decode 时校验
+    uint32_t hash_value =
+        crc32c_value(encoded.data(), encoded.size() - sizeof(uint32_t));
+    memcpy(encoded.data() + encoded.size() - sizeof(uint32_t), &hash_value,
+           sizeof(uint32_t));
+  }
+
+  return encoded;
 }
 
-std::shared_ptr<Block> Block::decode(const std::vector<uint8_t> &encoded,
-                                     bool with_hash) {
-  auto block = std::make_shared<Block>();
+namespace {
+// 校验 block 尾部并解析出 entry 数量, restart 间隔和 offsets 区域的起始位置
+// v1 格式的 restart_interval 为 0
+void parse_block_trailer(const uint8_t *encoded, size_t encoded_size,
+                         bool with_hash, uint16_t &num_entries,
+                         uint16_t &restart_interval,
+                         size_t &offsets_section_start) {
   // 1. 安全性检查
-  if (with_hash && encoded.size() <= sizeof(uint16_t) + sizeof(uint32_t)) {
+  if (encoded_size < sizeof(uint16_t) ||
+      (with_hash && encoded_size <= sizeof(uint16_t) + sizeof(uint32_t))) {
     throw std::runtime_error("Encoded data too small");
   }
-  uint16_t num_entries;
-  size_t num_entries_pos = encoded.size() - sizeof(uint16_t);
+  size_t num_entries_pos = encoded_size - sizeof(uint16_t);
   if (with_hash) {
     num_entries_pos -= sizeof(uint32_t);
-    auto hash_pos = encoded.size() - sizeof(uint32_t);
+  }
+  memcpy(&num_entries, encoded + num_entries_pos, sizeof(uint16_t));
+  if (with_hash) {
+    auto hash_pos = encoded_size - sizeof(uint32_t);
     uint32_t hash_value;
-    memcpy(&hash_value, encoded.data() + hash_pos, sizeof(uint32_t));
-
-    uint32_t compute_hash = std::hash<std::string_view>{}(
-        std::string_view(reinterpret_cast<const char *>(encoded.data()),
-                         encoded.size() - sizeof(uint32_t)));
+    memcpy(&hash_value, encoded + hash_pos, sizeof(uint32_t));
+
+    // 旧格式的 block 使用 std::hash
+    uint32_t compute_hash =
+        (num_entries & kBlockCrc32cFlag)
+            ? crc32c_value(encoded, hash_pos)
+            : static_cast<uint32_t>(std::hash<std::string_view>{}(
+                  std::string_view(reinterpret_cast<const char *>(encoded),
+                                   hash_pos)));
     if (hash_value != compute_hash) {
       throw std::runtime_error("Block hash verification failed");
     }
   }
-  memcpy(&num_entries, encoded.data() + num_entries_pos, sizeof(uint16_t));
-  size_t required_size = sizeof(uint16_t) + num_entries * sizeof(uint16_t);
-  if (encoded.size() < required_size) {
+  num_entries &= ~kBlockCrc32cFlag;
+  restart_interval = 0;
+  size_t offsets_end = num_entries_pos;
+  if (num_entries & kBlockFormatV2Flag) {
+    num_entries &= ~kBlockFormatV2Flag;
+    if (offsets_end < sizeof(uint16_t)) {
+      throw std::runtime_error("Invalid encoded data size");
+    }
+    offsets_end -= sizeof(uint16_t);
+    memcpy(&restart_interval, encoded + offsets_end, sizeof(uint16_t));
+    if (restart_interval == 0) {
+      throw std::runtime_error("Invalid block restart interval");
+    }
+  }
+  if (offsets_end < num_entries * sizeof(uint16_t)) {
     throw std::runtime_error("Invalid encoded data size");
   }
-  size_t offsets_section_start =
-      num_entries_pos - num_entries * sizeof(uint16_t);
+  offsets_section_start = offsets_end - num_entries * sizeof(uint16_t);
+}
+} // namespace
+
+std::shared_ptr<Block> Block::decode(const std::vector<uint8_t> &encoded,
+                                     bool with_hash) {
+  auto block = std::make_shared<Block>();
+  uint16_t num_entries;
+  size_t offsets_section_start;
+  parse_block_trailer(encoded.data(), encoded.size(), with_hash, num_entries,
+                      block->restart_interval_, offsets_section_start);
 
   block->offsets.resize(num_entries);
   memcpy(block->offsets.data(), encoded.data() + offsets_section_start,
@@ -67,149 +123,182 @@ std::shared_ptr<Block> Block::decode(const std::vector<uint8_t> &encoded,
   return block;
 }
 
-std::string Block::get_first_key() {
-  if (data.empty() || offsets.empty()) {
-    return "";
+std::shared_ptr<Block> Block::decode_view(const uint8_t *encoded,
+                                          size_t encoded_size, bool with_hash,
+                                          std::shared_ptr<const void> owner) {
+  auto block = std::make_shared<Block>();
+  uint16_t num_entries;
+  size_t offsets_section_start;
+  parse_block_trailer(encoded, encoded_size, with_hash, num_entries,
+                      block->restart_interval_, offsets_section_start);
+
+  // 不拷贝数据, data 和 offsets 都直接指向 encoded
+  block->is_view_ = true;
+  block->view_data_ = encoded;
+  block->view_data_size_ = offsets_section_start;
+  block->view_offsets_ = encoded + offsets_section_start;
+  block->view_num_entries_ = num_entries;
+  block->view_owner_ = std::move(owner);
+  return block;
+}
+
+const uint8_t *Block::data_ptr() const {
+  return is_view_ ? view_data_ : data.data();
+}
+
+size_t Block::data_size() const {
+  return is_view_ ? view_data_size_ : data.size();
+}
+
+uint16_t Block::offset_at(size_t idx) const {
+  if (!is_view_) {
+    return offsets[idx];
   }
+  // 映射区域中的 offsets 不一定按 2 字节对齐
+  uint16_t offset;
+  memcpy(&offset, view_offsets_ + idx * sizeof(uint16_t), sizeof(uint16_t));
+  return offset;
+}
 
-  // 读取第一个key的长度（前2字节）
-  uint16_t key_len;
-  memcpy(&key_len, data.data(), sizeof(uint16_t));
+size_t Block::restart_interval() const {
+  return restart_interval_ == 0 ? 1 : restart_interval_;
+}
+
+void Block::decode_key(size_t idx, std::string &key) const {
+  const uint8_t *entry = data_ptr() + offset_at(idx);
+  if (restart_interval_ == 0) {
+    uint16_t key_len;
+    memcpy(&key_len, entry, sizeof(uint16_t));
+    key.assign(reinterpret_cast<const char *>(entry + sizeof(uint16_t)),
+               key_len);
+    return;
+  }
+  uint16_t shared_len;
+  uint16_t unshared_len;
+  memcpy(&shared_len, entry, sizeof(uint16_t));
+  memcpy(&unshared_len, entry + sizeof(uint16_t), sizeof(uint16_t));
+  key.resize(shared_len);
+  key.append(reinterpret_cast<const char *>(entry + sizeof(uint16_t) * 2),
+             unshared_len);
+}
 
-  // 读取key
-  std::string key(reinterpret_cast<char *>(data.data() + sizeof(uint16_t)),
-                  key_len);
+std::string Block::get_key_by_idx(size_t idx) const {
+  std::string key;
+  for (size_t i = idx - idx % restart_interval(); i <= idx; ++i) {
+    decode_key(i, key);
+  }
+  return key;
+}
+
+size_t Block::value_len_pos(size_t offset) const {
+  uint16_t len;
+  if (restart_interval_ == 0) {
+    memcpy(&len, data_ptr() + offset, sizeof(uint16_t));
+    return offset + sizeof(uint16_t) + len;
+  }
+  memcpy(&len, data_ptr() + offset + sizeof(uint16_t), sizeof(uint16_t));
+  return offset + sizeof(uint16_t) * 2 + len;
+}
+
+std::string Block::get_first_key() {
+  if (data_size() == 0 || size() == 0) {
+    return "";
+  }
+  // 第一个 entry 总是 restart 点, 保存了完整的 key
+  std::string key;
+  decode_key(0, key);
   return key;
 }
 
 size_t Block::get_offset_at(size_t idx) const {
-  if (idx > offsets.size()) {
+  if (idx > size()) {
     throw std::runtime_error("idx out of offsets range");
   }
-  return offsets[idx];
+  return offset_at(idx);
 }
 
 bool Block::add_entry(const std::string &key, const std::string &value,
                       uint64_t tranc_id, bool force_write) {
+  // restart 点之外的 entry 只保存与上一个 key 不同的后缀
+  size_t shared_len = 0;
+  if (restart_interval_ != 0 && offsets.size() % restart_interval_ != 0) {
+    size_t max_shared = std::min(last_key_.size(), key.size());
+    while (shared_len < max_shared &&
+           last_key_[shared_len] == key[shared_len]) {
+      ++shared_len;
+    }
+  }
+  size_t unshared_len = key.size() - shared_len;
+  // 计算entry大小：
+  // v1: key长度(2B) + key + value长度(2B) + value + tranc_id(8B)
+  // v2: 公共前缀长度(2B) + 后缀长度(2B) + key后缀 + value长度(2B) + value +
+  //     tranc_id(8B)
+  size_t header_size =
+      restart_interval_ == 0 ? sizeof(uint16_t) : sizeof(uint16_t) * 2;
+  size_t entry_size = header_size + unshared_len + sizeof(uint16_t) +
+                      value.size() + sizeof(uint64_t);
   if (!force_write &&
-      (cur_size() + key.size() + value.size() + 3 * sizeof(uint16_t) +
-           sizeof(uint64_t) >
-       capacity) &&
+      (cur_size() + entry_size + sizeof(uint16_t) > capacity) &&
       !offsets.empty()) {
     return false;
   }
-  // 计算entry大小：key长度(2B) + key + value长度(2B) + value + tranc_id(8B)
-  size_t entry_size = sizeof(uint16_t) + key.size() + sizeof(uint16_t) +
-                      value.size() + sizeof(uint64_t);
   size_t offset = data.size();
   data.resize(data.size() + entry_size);
-  uint16_t key_size = static_cast<uint16_t>(key.size());
+  uint8_t *entry = data.data() + offset;
+  if (restart_interval_ == 0) {
+    uint16_t key_size = static_cast<uint16_t>(key.size());
+    memcpy(entry, &key_size, sizeof(uint16_t));
+  } else {
+    uint16_t shared_size = static_cast<uint16_t>(shared_len);
+    uint16_t unshared_size = static_cast<uint16_t>(unshared_len);
+    memcpy(entry, &shared_size, sizeof(uint16_t));
+    memcpy(entry + sizeof(uint16_t), &unshared_size, sizeof(uint16_t));
+  }
+  entry += header_size;
+  memcpy(entry, key.data() + shared_len, unshared_len);
+  entry += unshared_len;
   uint16_t value_size = static_cast<uint16_t>(value.size());
-
-  memcpy(data.data() + offset, &key_size, sizeof(uint16_t));
-  memcpy(data.data() + offset + sizeof(uint16_t), key.data(), key.size());
-  memcpy(data.data() + offset + sizeof(uint16_t) + key.size(), &value_size,
-         sizeof(uint16_t));
-  memcpy(data.data() + offset + sizeof(uint16_t) + key.size() +
-             sizeof(uint16_t),
-         value.data(), value.size());
-  memcpy(data.data() + offset + sizeof(uint16_t) + key.size() +
-             sizeof(uint16_t) + value.size(),
-         &tranc_id, sizeof(uint64_t));
+  memcpy(entry, &value_size, sizeof(uint16_t));
+  entry += sizeof(uint16_t);
+  memcpy(entry, value.data(), value.size());
+  entry += value.size();
+  memcpy(entry, &tranc_id, sizeof(uint64_t));
   offsets.push_back(static_cast<uint16_t>(offset));
+  if (restart_interval_ != 0) {
+    last_key_ = key;
+  }
   return true;
 }
-// 从指定偏移量获取entry的key
-std::string Block::get_key_at(size_t offset) const {
-  uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
-  return std::string(
-      reinterpret_cast<const char *>(data.data() + offset + sizeof(uint16_t)),
-      key_len);
-}
 
 // 从指定偏移量获取entry的value
 std::string Block::get_value_at(size_t offset) const {
-  // 先获取key长度
-  uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
-
-  // 计算value长度的位置
-  size_t value_len_pos = offset + sizeof(uint16_t) + key_len;
+  size_t len_pos = value_len_pos(offset);
   uint16_t value_len;
-  memcpy(&value_len, data.data() + value_len_pos, sizeof(uint16_t));
+  memcpy(&value_len, data_ptr() + len_pos, sizeof(uint16_t));
 
   // 返回value
-  return std::string(reinterpret_cast<const char *>(
-                         data.data() + value_len_pos + sizeof(uint16_t)),
-                     value_len);
+  return std::string(
+      reinterpret_cast<const char *>(data_ptr() + len_pos + sizeof(uint16_t)),
+      value_len);
 }
 
 uint64_t Block::get_tranc_id_at(size_t offset) const {
-  // 先获取key长度
-  uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
-
-  // 计算value长度的位置
-  size_t value_len_pos = offset + sizeof(uint16_t) + key_len;
+  size_t len_pos = value_len_pos(offset);
   uint16_t value_len;
-  memcpy(&value_len, data.data() + value_len_pos, sizeof(uint16_t));
+  memcpy(&value_len, data_ptr() + len_pos, sizeof(uint16_t));
 
   // 计算事务id的位置
-  size_t tranc_id_pos = value_len_pos + sizeof(uint16_t) + value_len;
+  size_t tranc_id_pos = len_pos + sizeof(uint16_t) + value_len;
   uint64_t tranc_id;
-  memcpy(&tranc_id, data.data() + tranc_id_pos, sizeof(uint64_t));
+  memcpy(&tranc_id, data_ptr() + tranc_id_pos, sizeof(uint64_t));
   return tranc_id;
 }
 
-// 比较指定偏移量处的key与目标key
-int Block::compare_key_at(size_t offset, const std::string &target) const {
-  std::string key = get_key_at(offset);
-  return key.compare(target);
-}
-
-int Block::adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id) {
-  if (idx >= offsets.size()) {
-    return -1;
-  }
-  auto target_key = get_key_at(offsets[idx]);
-  if (tranc_id != 0) {
-    auto current_tranc_id = get_tranc_id_at(offsets[idx]);
-    if (current_tranc_id <= tranc_id) {
-      size_t prev_idx = idx;
-      while (prev_idx > 0 && is_same_key(prev_idx - 1, target_key)) {
-        --prev_idx;
-        auto new_tranc_id = get_tranc_id_at(offsets[prev_idx]);
-        if (new_tranc_id > tranc_id) {
-          return prev_idx + 1;
-        }
-      }
-      return prev_idx;
-    } else {
-      size_t next_idx = idx + 1;
-      while (next_idx < offsets.size() && is_same_key(next_idx, target_key)) {
-        auto new_tranc_id = get_tranc_id_at(offsets[next_idx]);
-        if (new_tranc_id <= tranc_id) {
-          return next_idx;
-        }
-        ++next_idx;
-      }
-      return -1;
-    }
-  } else {
-    size_t prev_idx = idx;
-    while (prev_idx > 0 && is_same_key(prev_idx - 1, target_key)) {
-      --prev_idx;
-    }
-    return prev_idx;
-  }
-}
-
 bool Block::is_same_key(size_t idx, const std::string &target_key) const {
-  if (idx >= offsets.size()) {
+  if (idx >= size()) {
     return false; // 索引超出范围
   }
-  return get_key_at(offsets[idx]) == target_key;
+  return get_key_by_idx(idx) == target_key;
 }
 // 使用二分查找获取value
 // 要求在插入数据时有序插入
@@ -220,51 +309,89 @@ std::optional<std::string> Block::get_value_binary(const std::string &key,
     return std::nullopt;
   }
 
-  return get_value_at(offsets[*idx]);
+  return get_value_at(offset_at(*idx));
 }
 
 std::optional<size_t> Block::get_index_binary(const std::string &key,
                                               uint64_t tranc_id) {
-  if (offsets.empty()) {
+  if (size() == 0) {
     return std::nullopt;
   }
-  int left = 0;
-  int right = offsets.size() - 1;
-  while (left <= right) {
-    int mid = (left + right) / 2;
-    size_t mid_offset = offsets[mid];
-    int cmp = compare_key_at(mid_offset, key);
-
-    if (cmp == 0) {
-      auto new_mid = adjust_idx_by_tranc_id(mid, tranc_id);
-      if (new_mid == -1) {
-        return std::nullopt;
-      }
-      return static_cast<size_t>(new_mid);
-    } else if (cmp < 0) {
+  // 1. 在 restart 点上二分, 找到第一个 key 不小于目标 key 的 restart 点
+  size_t interval = restart_interval();
+  size_t left = 0;
+  size_t right = (size() + interval - 1) / interval;
+  std::string cur_key;
+  while (left < right) {
+    size_t mid = (left + right) / 2;
+    decode_key(mid * interval, cur_key);
+    if (cur_key < key) {
       left = mid + 1;
-
     } else {
-      right = mid - 1;
+      right = mid;
+    }
+  }
+
+  // 2. 目标 key 的第一个版本可能在前一个 restart 区间内, 从那里开始顺序扫描
+  size_t idx = left == 0 ? 0 : (left - 1) * interval;
+  for (; idx < size(); ++idx) {
+    decode_key(idx, cur_key);
+    if (cur_key >= key) {
+      break;
+    }
+  }
+  if (idx == size() || cur_key != key) {
+    return std::nullopt;
+  }
+
+  // 3. 同一个 key 的多个版本按事务 id 降序排列, 返回第一个可见的版本
+  if (tranc_id == 0) {
+    return idx;
+  }
+  for (; idx < size(); ++idx) {
+    decode_key(idx, cur_key);
+    if (cur_key != key) {
+      break;
+    }
+    if (get_tranc_id_at(offset_at(idx)) <= tranc_id) {
+      return idx;
     }
   }
   return std::nullopt;
 }
-Block::Entry Block::get_entry_at(size_t offset) const {
+
+Block::Entry Block::get_entry_by_idx(size_t idx) const {
+  if (idx >= size()) {
+    throw std::out_of_range("idx out of offsets range");
+  }
+  size_t offset = offset_at(idx);
   Entry entry;
-  entry.key = get_key_at(offset);
+  entry.key = get_key_by_idx(idx);
   entry.value = get_value_at(offset);
   entry.tranc_id = get_tranc_id_at(offset);
   return entry;
 }
 
-size_t Block::size() const { return offsets.size(); }
+size_t Block::size() const {
+  return is_view_ ? view_num_entries_ : offsets.size();
+}
 
 size_t Block::cur_size() const {
-  return data.size() + offsets.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  size_t trailer_size =
+      restart_interval_ == 0 ? sizeof(uint16_t) : sizeof(uint16_t) * 2;
+  return data_size() + size() * sizeof(uint16_t) + trailer_size;
+}
+
+size_t Block::memory_usage() const {
+  if (is_view_) {
+    return sizeof(Block) + view_data_size_ +
+           view_num_entries_ * sizeof(uint16_t);
+  }
+  return sizeof(Block) + data.capacity() +
+         offsets.capacity() * sizeof(uint16_t);
 }
 
-bool Block::is_empty() const { return offsets.empty(); }
+bool Block::is_empty() const { return size() == 0; }
 
 BlockIterator Block::begin(uint64_t tranc_id) {
   return BlockIterator(shared_from_this(), 0, tranc_id);
@@ -280,7 +407,7 @@ Block::iters_preffix(uint64_t tranc_id, const std::string &preffix) {
 }
 
 BlockIterator Block::end() {
-  return BlockIterator(shared_from_this(), offsets.size(), 0);
+  return BlockIterator(shared_from_this(), size(), 0);
 }
 
 // 返回第一个满足谓词的位置和最后一个满足谓词的位置
@@ -295,17 +422,16 @@ std::optional<
     std::pair<std::shared_ptr<BlockIterator>, std::shared_ptr<BlockIterator>>>
 Block::get_monotony_predicate_iters(
     uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
-  if (offsets.empty()) {
+  if (size() == 0) {
     return std::nullopt;
   }
 
   int left = 0;
-  int right = offsets.size() - 1;
+  int right = size() - 1;
   int first = -1;
   while (left <= right) {
     int mid = (left + right) / 2;
-    size_t mid_offset = offsets[mid];
-    auto mid_key = get_key_at(mid_offset);
+    auto mid_key = get_key_by_idx(mid);
     int direction = predicate(mid_key);
     if (direction <= 0) {
       right = mid - 1;
@@ -313,17 +439,16 @@ Block::get_monotony_predicate_iters(
       left = mid + 1;
     }
   }
-  if (left >= offsets.size() || predicate(get_key_at(offsets[left]))) {
+  if (left >= size() || predicate(get_key_by_idx(left))) {
     return std::nullopt;
   }
   first = left;
   // 第二次二分查找，找到最后一个满足谓词的位置
   int last = -1;
-  right = offsets.size() - 1;
+  right = size() - 1;
   while (left <= right) {
     int mid = left + (right - left) / 2;
-    size_t mid_offset = offsets[mid];
-    auto mid_key = get_key_at(mid_offset);
+    auto mid_key = get_key_by_idx(mid);
     int direction = predicate(mid_key);
     if (direction < 0) {
       right = mid - 1;
@@ -1,5 +1,6 @@
 #include "../../include/block/block_cache.h"
 #include "../../include/block/block.h"
+#include <algorithm>
 #include <chrono>
 #include <list>
 #include <memory>
@@ -8,73 +9,135 @@
 
 namespace my_tiny_lsm {
 
-BlockCache::BlockCache(size_t capacity, size_t k)
-    : capacity_(capacity), k_(k) {}
+BlockCache::BlockCache(size_t capacity, size_t k, size_t num_shards)
+    : capacity_(capacity), k_(k) {
+  // 容量较小时减少分片数, 避免哈希不均导致单个分片过小而频繁淘汰
+  num_shards = std::max<size_t>(
+      1, std::min(num_shards, capacity / kMinShardCapacity));
+  shards_.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    auto shard = std::make_unique<Shard>();
+    // 容量不能整除时, 前面的分片多分配一个
+    shard->capacity_ = capacity / num_shards + (i < capacity % num_shards);
+    shards_.push_back(std::move(shard));
+  }
+}
 
 BlockCache::~BlockCache() = default;
 
-std::shared_ptr<Block> BlockCache::get(int sst_id, int block_id) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  total_requests_++;
+BlockCache::Shard &BlockCache::shard_for(int sst_id, int block_id) {
+  // 混合 sst_id 和 block_id 的所有位, 避免同一个 sst 的 block
+  // 或不同 sst 的同号 block 集中到少数分片上
+  uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(sst_id)) << 32) |
+               static_cast<uint32_t>(block_id);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return *shards_[h % shards_.size()];
+}
+
+std::shared_ptr<Block> BlockCache::get(int sst_id, int block_id,
+                                       size_t level) {
+  return std::static_pointer_cast<Block>(get_entry(sst_id, block_id, level));
+}
+
+void BlockCache::put(int sst_id, int block_id, std::shared_ptr<Block> block) {
+  size_t charge = block->memory_usage();
+  put_entry(sst_id, block_id, std::move(block), charge);
+}
+
+std::shared_ptr<void> BlockCache::get_entry(int sst_id, int block_id,
+                                            size_t level) {
+  level = std::min(level, BlockCacheStats::kMaxLevels - 1);
+  auto &shard = shard_for(sst_id, block_id);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  shard.level_requests_[level]++;
   auto key = std::make_pair(sst_id, block_id);
-  auto it = cache_map_.find(key);
-  if (it == cache_map_.end()) {
+  auto it = shard.cache_map_.find(key);
+  if (it == shard.cache_map_.end()) {
     return nullptr; // 未命中
   }
-  hit_requests_++;
-  update_access_time(it->second);
-  return it->second->block_ptr;
+  shard.level_hits_[level]++;
+  update_access_time(shard, it->second);
+  return it->second->value;
 }
 
-void BlockCache::put(int sst_id, int block_id, std::shared_ptr<Block> block) {
-  std::lock_guard<std::mutex> lock(mutex_);
+void BlockCache::put_entry(int sst_id, int block_id,
+                           std::shared_ptr<void> value, size_t charge) {
+  auto &shard = shard_for(sst_id, block_id);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
   auto key = std::make_pair(sst_id, block_id);
 
-  auto it = cache_map_.find(key);
+  auto it = shard.cache_map_.find(key);
 
-  if (it != cache_map_.end()) {
+  if (it != shard.cache_map_.end()) {
     // 如果已经存在，更新内容并调整位置
-    it->second->block_ptr = block;
-    update_access_time(it->second);
+    shard.usage_ = shard.usage_ - it->second->charge + charge;
+    it->second->value = std::move(value);
+    it->second->charge = charge;
+    update_access_time(shard, it->second);
     return;
   }
-  if (cache_map_.size() >= capacity_) {
-    if (!cache_list_less_k.empty()) {
-      cache_map_.erase(std::make_pair(cache_list_less_k.back().sst_id,
-                                      cache_list_less_k.back().block_id));
-      cache_list_less_k.pop_back();
-    } else {
-      cache_map_.erase(std::make_pair(cache_list_greater_k.back().sst_id,
-                                      cache_list_greater_k.back().block_id));
-      cache_list_greater_k.pop_back();
-    }
-  }
+  // 先腾出空间, 单个 block 超过分片容量时清空分片后仍然插入
+  evict(shard, charge);
   // 插入新元素, 初始访问时间为当前时间戳, 放在链表头部
-  CacheItem item = {sst_id, block_id, block, 1};
-  cache_list_less_k.push_front(item);
-  cache_map_[key] = cache_list_less_k.begin();
+  CacheItem item = {sst_id, block_id, std::move(value), 1, charge};
+  shard.cache_list_less_k.push_front(item);
+  shard.cache_map_[key] = shard.cache_list_less_k.begin();
+  shard.usage_ += charge;
+  shard.inserts_++;
 }
-void BlockCache::update_access_time(std::list<CacheItem>::iterator it) {
+
+void BlockCache::evict(Shard &shard, size_t charge) {
+  while (shard.usage_ + charge > shard.capacity_ &&
+         !shard.cache_map_.empty()) {
+    // 优先淘汰访问次数不足 k 的 block
+    auto &victims = shard.cache_list_less_k.empty()
+                        ? shard.cache_list_greater_k
+                        : shard.cache_list_less_k;
+    auto &victim = victims.back();
+    shard.usage_ -= victim.charge;
+    shard.evictions_++;
+    shard.evicted_bytes_ += victim.charge;
+    shard.cache_map_.erase(std::make_pair(victim.sst_id, victim.block_id));
+    victims.pop_back();
+  }
+}
+
+void BlockCache::update_access_time(Shard &shard,
+                                    std::list<CacheItem>::iterator it) {
   ++it->access_count;
   if (it->access_count < k_) {
-    cache_list_less_k.splice(cache_list_less_k.begin(), cache_list_less_k, it);
+    shard.cache_list_less_k.splice(shard.cache_list_less_k.begin(),
+                                   shard.cache_list_less_k, it);
   } else if (it->access_count == k_) {
-    auto item = *it;
-    cache_list_less_k.erase(it);
-    cache_list_greater_k.push_front(item);
-    cache_map_[std::make_pair(item.sst_id, item.block_id)] =
-        cache_list_greater_k.begin();
-
+    // 直接把节点移动到另一条链表, 迭代器保持有效, 不需要更新 cache_map_
+    shard.cache_list_greater_k.splice(shard.cache_list_greater_k.begin(),
+                                      shard.cache_list_less_k, it);
   } else {
-    cache_list_greater_k.splice(cache_list_greater_k.begin(),
-                                cache_list_greater_k, it);
+    shard.cache_list_greater_k.splice(shard.cache_list_greater_k.begin(),
+                                      shard.cache_list_greater_k, it);
   }
 }
-double BlockCache::hit_rate() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return total_requests_ == 0
-             ? 0.0
-             : static_cast<double>(hit_requests_) / total_requests_;
+
+double BlockCache::hit_rate() const { return get_stats().hit_rate(); }
+
+BlockCacheStats BlockCache::get_stats() const {
+  BlockCacheStats stats;
+  stats.capacity = capacity_;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex_);
+    stats.usage += shard->usage_;
+    stats.entries += shard->cache_map_.size();
+    stats.inserts += shard->inserts_;
+    stats.evictions += shard->evictions_;
+    stats.evicted_bytes += shard->evicted_bytes_;
+    for (size_t i = 0; i < BlockCacheStats::kMaxLevels; ++i) {
+      stats.level_requests[i] += shard->level_requests_[i];
+      stats.level_hits[i] += shard->level_hits_[i];
+    }
+  }
+  return stats;
 }
 
 } // namespace my_tiny_lsm
\ No newline at end of file
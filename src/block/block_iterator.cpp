@@ -21,7 +21,7 @@ BlockIterator::BlockIterator(std::shared_ptr<Block> b, const std::string &key,
   if (key_idx_opt.has_value()) {
     current_index = key_idx_opt.value();
   } else {
-    current_index = block->offsets.size(); // 设置为end()
+    current_index = block->size(); // 设置为end()
   }
 }
 BlockIterator::pointer BlockIterator::operator->() const {
@@ -30,15 +30,11 @@ BlockIterator::pointer BlockIterator::operator->() const {
 }
 
 BlockIterator::value_type BlockIterator::operator*() const {
-  if (!block || current_index >= block->offsets.size()) {
+  if (!block || current_index >= block->size()) {
     throw std::out_of_range("Dereferencing end iterator or invalid iterator");
   }
 
-  if (!cached_value.has_value()) {
-    size_t offset = block->get_offset_at(current_index);
-    cached_value =
-        std::make_pair(block->get_key_at(offset), block->get_value_at(offset));
-  }
+  update_current();
   return *cached_value;
 }
 
@@ -57,35 +53,31 @@ bool BlockIterator::operator!=(const BlockIterator &other) const {
   return !(*this == other);
 }
 
-BlockIterator::value_type BlockIterator::operator*() const {
-  if (!block || current_index >= block->size()) {
-    throw std::out_of_range("Iterator out of range");
-  }
-
-  // 使用缓存避免重复解析
-  if (!cached_value.has_value()) {
-    size_t offset = block->get_offset_at(current_index);
-    cached_value =
-        std::make_pair(block->get_key_at(offset), block->get_value_at(offset));
-  }
-  return *cached_value;
-}
-
 bool BlockIterator::is_end() const {
-  return current_index == block->offsets.size();
+  return current_index == block->size();
 }
 
 BlockIterator &BlockIterator::operator++() {
     if(block && current_index < block->size()) {
-        auto prev_index = current_index;
-        auto prev_offset = block->get_offset_at(prev_index);
-        auto prev_entry = block->get_entry_at(prev_offset);
+        std::string curr_key;
+        if(current_key_.has_value()) {
+            curr_key = std::move(*current_key_);
+        } else if(cached_value.has_value()) {
+            curr_key = cached_value->first;
+        } else {
+            curr_key = block->get_key_by_idx(current_index);
+        }
+        // 顺序向后解码, 每个 key 只需要在前一个 key 的基础上补全后缀
+        std::string prev_key = curr_key;
+        cached_value.reset();
+        current_key_.reset();
         ++current_index;
-        while(block && current_index < block->size()) {
-            auto curr_offset = block->get_offset_at(current_index);
-            auto curr_entry = block->get_entry_at(curr_offset);
-            if(curr_entry.key != prev_entry.key) {
-                break; // 找到不同的key，停止跳过
+        while(current_index < block->size()) {
+            block->decode_key(current_index, curr_key);
+            if(curr_key != prev_key) {
+                // 找到不同的key，停止跳过, 保留解码结果供 update_current 使用
+                current_key_ = std::move(curr_key);
+                break;
             }
             ++current_index;
         }
@@ -97,7 +89,10 @@ BlockIterator &BlockIterator::operator++() {
 void BlockIterator::update_current() const {
     if(!cached_value && current_index < block->size()) {
         size_t offset = block->get_offset_at(current_index);
-        cached_value = std::make_pair(block->get_key_at(offset), block->get_value_at(offset));
+        cached_value = std::make_pair(
+            current_key_.has_value() ? *current_key_
+                                     : block->get_key_by_idx(current_index),
+            block->get_value_at(offset));
     }
 }
 
@@ -111,6 +106,14 @@ void BlockIterator::skip_by_tranc_id() {
             break; // 找到符合条件的 entry，停止跳过
         }
         ++current_index;
+        // 已知前一个 key 时继续顺序解码, 否则留给 update_current
+        if(current_key_.has_value()) {
+            if(current_index < block->size()) {
+                block->decode_key(current_index, *current_key_);
+            } else {
+                current_key_.reset();
+            }
+        }
     }
 }
 
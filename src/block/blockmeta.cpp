@@ -1,4 +1,5 @@
 #include "../../include/block/blockmeta.h"
+#include "../../include/utils/crc32c.h"
 #include <cstring>
 #include <functional>
 #include <stdexcept>
@@ -16,7 +17,7 @@ void BlockMeta::encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
   uint32_t num_blocks = meta_entries.size();
   size_t total_size = sizeof(uint32_t);
   for(const auto &entry : meta_entries) {
-    total_size += sizeof(size_t); // offset
+    total_size += sizeof(uint32_t); // offset
     total_size += sizeof(uint16_t) + entry.first_key.size(); // first_key
     total_size += sizeof(uint16_t) + entry.last_key.size();  // last_key
   }
@@ -45,13 +46,13 @@ void BlockMeta::encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
   const uint8_t *data_end = ptr;
 
   size_t data_len = data_end - data_begin;
-  uint32_t checksum = std::hash<std::string_view>()(
-      std::string_view(reinterpret_cast<const char *>(data_begin), data_len));
-    memcpy(ptr,&checksum,sizeof(uint32_t));
+  uint32_t checksum = crc32c_value(data_begin, data_len);
+  memcpy(ptr, &checksum, sizeof(uint32_t));
 }
 
 std::vector<BlockMeta>
-BlockMeta::decode_meta_from_slice(const std::vector<uint8_t> &metadata) {
+BlockMeta::decode_meta_from_slice(const std::vector<uint8_t> &metadata,
+                                  bool crc32c_checksum) {
   std::vector<BlockMeta> meta_entries;
 
   // 1. 验证最小长度
@@ -100,9 +101,14 @@ BlockMeta::decode_meta_from_slice(const std::vector<uint8_t> &metadata) {
   const uint8_t *data_end = ptr;
   size_t data_len = data_end - data_start;
 
-  // 使用与编码时相同的 std::hash 计算哈希值
-  uint32_t computed_hash = std::hash<std::string_view>{}(
-      std::string_view(reinterpret_cast<const char *>(data_start), data_len));
+  // 使用与编码时相同的方式计算哈希值
+  uint32_t computed_hash;
+  if (crc32c_checksum) {
+    computed_hash = crc32c_value(data_start, data_len);
+  } else {
+    computed_hash = std::hash<std::string_view>{}(
+        std::string_view(reinterpret_cast<const char *>(data_start), data_len));
+  }
 
   if (stored_hash != computed_hash) {
     throw std::runtime_error("Metadata hash mismatch");
@@ -0,0 +1,112 @@
+#include "../../include/block/index_partition.h"
+#include "../../include/utils/crc32c.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace my_tiny_lsm {
+
+namespace {
+constexpr size_t kNumFields = 6;
+
+void put_u32(uint8_t *&ptr, uint32_t value) {
+  memcpy(ptr, &value, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+}
+
+void put_key(uint8_t *&ptr, const std::string &key) {
+  uint16_t len = static_cast<uint16_t>(key.size());
+  memcpy(ptr, &len, sizeof(uint16_t));
+  ptr += sizeof(uint16_t);
+  memcpy(ptr, key.data(), len);
+  ptr += len;
+}
+
+// 读取时检查剩余长度, 防止损坏的数据导致越界
+void get_bytes(const uint8_t *&ptr, const uint8_t *end, void *out,
+               size_t len) {
+  if (static_cast<size_t>(end - ptr) < len) {
+    throw std::runtime_error("Corrupted index partitions: truncated");
+  }
+  memcpy(out, ptr, len);
+  ptr += len;
+}
+
+std::string get_key(const uint8_t *&ptr, const uint8_t *end) {
+  uint16_t len;
+  get_bytes(ptr, end, &len, sizeof(uint16_t));
+  std::string key(len, '\0');
+  get_bytes(ptr, end, key.data(), len);
+  return key;
+}
+} // namespace
+
+void IndexPartition::encode_to_slice(
+    const std::vector<IndexPartition> &partitions, std::vector<uint8_t> &data) {
+  size_t total_size = sizeof(uint32_t) * 2;
+  for (const auto &p : partitions) {
+    total_size += sizeof(uint32_t) * kNumFields;
+    total_size += sizeof(uint16_t) + p.first_key.size();
+    total_size += sizeof(uint16_t) + p.last_key.size();
+  }
+  data.resize(total_size);
+  uint8_t *ptr = data.data();
+  put_u32(ptr, partitions.size());
+  for (const auto &p : partitions) {
+    put_u32(ptr, p.num_blocks);
+    put_u32(ptr, p.blocks_end);
+    put_u32(ptr, p.index_offset);
+    put_u32(ptr, p.index_size);
+    put_u32(ptr, p.filter_offset);
+    put_u32(ptr, p.filter_size);
+    put_key(ptr, p.first_key);
+    put_key(ptr, p.last_key);
+  }
+  const uint8_t *data_begin = data.data() + sizeof(uint32_t);
+  put_u32(ptr, crc32c_value(data_begin, ptr - data_begin));
+}
+
+std::vector<IndexPartition>
+IndexPartition::decode_from_slice(const std::vector<uint8_t> &data) {
+  if (data.size() < sizeof(uint32_t) * 2) {
+    throw std::runtime_error("Invalid index partitions size");
+  }
+  const uint8_t *ptr = data.data();
+  const uint8_t *end = data.data() + data.size() - sizeof(uint32_t);
+  uint32_t stored_checksum;
+  memcpy(&stored_checksum, end, sizeof(uint32_t));
+  const uint8_t *data_begin = ptr + sizeof(uint32_t);
+  if (stored_checksum != crc32c_value(data_begin, end - data_begin)) {
+    throw std::runtime_error("Index partitions checksum mismatch");
+  }
+
+  uint32_t num;
+  get_bytes(ptr, end, &num, sizeof(uint32_t));
+  std::vector<IndexPartition> partitions;
+  partitions.reserve(num);
+  uint32_t first_block = 0;
+  for (uint32_t i = 0; i < num; ++i) {
+    IndexPartition p;
+    uint32_t fields[kNumFields];
+    get_bytes(ptr, end, fields, sizeof(fields));
+    p.first_block = first_block;
+    p.num_blocks = fields[0];
+    p.blocks_end = fields[1];
+    p.index_offset = fields[2];
+    p.index_size = fields[3];
+    p.filter_offset = fields[4];
+    p.filter_size = fields[5];
+    p.first_key = get_key(ptr, end);
+    p.last_key = get_key(ptr, end);
+    first_block += p.num_blocks;
+    partitions.push_back(std::move(p));
+  }
+  if (ptr != end) {
+    throw std::runtime_error("Corrupted index partitions: trailing bytes");
+  }
+  return partitions;
+}
+
+size_t IndexPartition::memory_usage() const {
+  return sizeof(IndexPartition) + first_key.capacity() + last_key.capacity();
+}
+} // namespace my_tiny_lsm
@@ -90,10 +90,6 @@ BaseIterator &HeapIterator::operator++() {
   }
   return *this;
 }
-BaseIterator &HeapIterator::operator--() {
-  // 不支持向后迭代
-  return *this;
-}
 
 
 bool HeapIterator::operator==(const BaseIterator &other) const {
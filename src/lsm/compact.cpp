@@ -0,0 +1,104 @@
+#include "../../include/lsm/compact.h"
+#include "../../include/sst/sst.h"
+#include <utility>
+
+namespace my_tiny_lsm {
+
+CompactMerger::CompactMerger(
+    std::vector<std::vector<std::shared_ptr<SST>>> runs,
+    uint64_t oldest_tranc_id, bool drop_tombstones)
+    : oldest_tranc_id_(oldest_tranc_id), drop_tombstones_(drop_tombstones) {
+  runs_.resize(runs.size());
+  for (size_t i = 0; i < runs.size(); ++i) {
+    runs_[i].ssts = std::move(runs[i]);
+    for (auto &sst : runs_[i].ssts) {
+      // 输入 sst 会被从头到尾读一遍, 读完即删除
+      sst->advise(FileAccessHint::Sequential);
+    }
+    push_next(i);
+  }
+  advance();
+}
+
+void CompactMerger::push_next(size_t run_idx) {
+  auto &cursor = runs_[run_idx];
+  while (cursor.sst_idx < cursor.ssts.size()) {
+    auto &sst = cursor.ssts[cursor.sst_idx];
+    if (cursor.block == nullptr) {
+      if (cursor.block_idx >= sst->num_blocks()) {
+        // 当前 sst 遍历结束, 移动到下一个 sst
+        cursor.sst_idx++;
+        cursor.block_idx = 0;
+        continue;
+      }
+      // 输入 sst 在 compaction 结束后即被删除, 读取的 block 不放入缓存
+      cursor.block = sst->read_block(cursor.block_idx, false);
+      cursor.entry_idx = 0;
+    }
+    if (cursor.entry_idx < cursor.block->size()) {
+      heap_.push(
+          HeapItem{cursor.block->get_entry_by_idx(cursor.entry_idx), run_idx});
+      cursor.entry_idx++;
+      return;
+    }
+    // 当前 block 遍历结束, 移动到下一个 block
+    cursor.block = nullptr;
+    cursor.block_idx++;
+  }
+}
+
+void CompactMerger::advance() {
+  valid_ = false;
+  while (!heap_.empty()) {
+    auto item = heap_.top();
+    heap_.pop();
+    push_next(item.run_idx);
+
+    auto &entry = item.entry;
+    if (entry.key != cur_key_ || !has_cur_key_) {
+      cur_key_ = entry.key;
+      has_cur_key_ = true;
+      cur_key_settled_ = false;
+    } else if (entry.tranc_id == last_tranc_id_) {
+      // 同一个版本出现在多个 run 中, 只保留最新 run 中的那一份
+      continue;
+    }
+    last_tranc_id_ = entry.tranc_id;
+
+    if (cur_key_settled_) {
+      // 已有更新的版本对所有活跃事务可见, 这个版本不会再被读到
+      dropped_versions_++;
+      continue;
+    }
+
+    if (entry.tranc_id <= oldest_tranc_id_) {
+      cur_key_settled_ = true;
+      if (entry.value.empty() && drop_tombstones_) {
+        // 最底层不存在更旧的数据, 删除标记本身也不再需要
+        dropped_tombstones_++;
+        continue;
+      }
+    }
+
+    current_ = std::move(entry);
+    valid_ = true;
+    return;
+  }
+}
+
+bool CompactMerger::is_valid() const { return valid_; }
+
+void CompactMerger::next() { advance(); }
+
+const std::string &CompactMerger::key() const { return current_.key; }
+
+const std::string &CompactMerger::value() const { return current_.value; }
+
+uint64_t CompactMerger::tranc_id() const { return current_.tranc_id; }
+
+uint64_t CompactMerger::dropped_versions() const { return dropped_versions_; }
+
+uint64_t CompactMerger::dropped_tombstones() const {
+  return dropped_tombstones_;
+}
+} // namespace my_tiny_lsm
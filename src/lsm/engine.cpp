@@ -3,13 +3,18 @@
 #include "../../include/consts.h"
 #include "../../include/logger/logger.h"
 #include "../../include/lsm/level_iterator.h"
+#include "../../include/lsm/manifest.h"
 #include "../../include/sst/concact_iterator.h"
 #include "../../include/sst/sst.h"
 #include "../../include/sst/sst_iterator.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -18,73 +23,230 @@
 
 namespace my_tiny_lsm {
 
-LSMEngine::LSMEngine(std::string path) : data_dir(path) {
-  block_cache = std::make_shared<BlockCache>(10, 10);
+namespace {
+// SST文件名格式为: sst_{id}.level, 解析失败时返回 std::nullopt
+std::optional<std::pair<size_t, size_t>>
+parse_sst_filename(const std::string &filename) {
+  if (!filename.starts_with("sst_")) {
+    return std::nullopt;
+  }
+
+  // 找到 . 的位置
+  size_t dot_pos = filename.find('.');
+  if (dot_pos == std::string::npos || dot_pos == filename.length() - 1) {
+    return std::nullopt;
+  }
+
+  // 提取 level
+  std::string level_str =
+      filename.substr(dot_pos + 1, filename.length() - 1 - dot_pos);
+  if (level_str.empty()) {
+    return std::nullopt;
+  }
+  size_t level = std::stoull(level_str);
+
+  // 提取SST ID
+  std::string id_str = filename.substr(4, dot_pos - 4); // 4 for "sst_"
+  if (id_str.empty()) {
+    return std::nullopt;
+  }
+  size_t sst_id = std::stoull(id_str);
+  return std::make_pair(sst_id, level);
+}
+} // namespace
+
+LSMEngine::LSMEngine(std::string path)
+    : data_dir(path), next_sst_id(0), cur_max_level(0),
+      compact_type(compact_type_from_string(
+          TomlConfig::getInstance().getLsmCompactType())) {
+  block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  compact_pool = std::make_unique<ThreadPool>(
+      TomlConfig::getInstance().getLsmCompactionThreads());
+  prefix_extractor = PrefixExtractor::from_string(
+      TomlConfig::getInstance().getBloomFilterPrefixExtractor());
 
   if (!std::filesystem::exists(data_dir)) {
     std::filesystem::create_directories(data_dir);
+    manifest = std::make_unique<Manifest>(data_dir);
+  } else if (Manifest::exists(data_dir)) {
+    load_from_manifest();
   } else {
-    for (const auto &entry : std::filesystem::directory_iterator(path)) {
-      if (!entry.is_regular_file()) {
-        continue;
-      }
-
-      std::string filename = entry.path().filename().string();
-      // SST文件名格式为: sst_{id}.level
-      if (!filename.starts_with("sst_")) {
-        continue;
-      }
+    load_from_directory();
+  }
+}
 
-      // 找到 . 的位置
-      size_t dot_pos = filename.find('.');
-      if (dot_pos == std::string::npos || dot_pos == filename.length() - 1) {
-        continue;
-      }
+void LSMEngine::load_from_manifest() {
+  // sst 集合和元数据都记录在 manifest 中, 不需要列出目录或读取 sst 文件,
+  // 文件在首次读取数据时才打开
+  auto start = std::chrono::steady_clock::now();
+  manifest = std::make_unique<Manifest>(data_dir);
+  auto read_mode = file_read_mode_from_string(
+      TomlConfig::getInstance().getLsmSstReadMode());
 
-      // 提取 level
-      std::string level_str =
-          filename.substr(dot_pos + 1, filename.length() - 1 - dot_pos);
-      if (level_str.empty()) {
-        continue;
+  std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+  next_sst_id = manifest->next_sst_id();
+  std::set<size_t> live_ids;
+  for (const auto &[sst_id, meta] : manifest->live_ssts()) {
+    ssts[sst_id] = SST::open_lazy(meta, get_sst_path(sst_id, meta.level),
+                                  read_mode, block_cache);
+    level_sst_ids[meta.level].push_back(sst_id);
+    cur_max_level = std::max(meta.level, cur_max_level);
+    next_sst_id = std::max(sst_id + 1, next_sst_id.load());
+    live_ids.insert(sst_id);
+  }
+  for (auto &[level, sst_id_list] : level_sst_ids) {
+    sort_level(level);
+  }
+  install_version();
+  spdlog::info("LSMEngine--"
+               "Loaded {} SSTs from manifest in {} ms",
+               live_ids.size(),
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count());
+
+  // 写入 manifest 前崩溃的 flush 或 compact 会留下不属于任何 level 的文件.
+  // 它们的 sst_id 可能不小于 manifest 中的 next_sst_id, 不能按 id 区分,
+  // 因此在分配任何新的 sst_id 之前列出目录, 此时不在 manifest 中的 sst
+  // 文件都是残留的. 删除在后台进行, 新分配的 sst_id 需要跳过这些文件,
+  // 否则删除时可能删掉同名的新文件
+  std::vector<std::filesystem::path> obsolete_files;
+  try {
+    for (const auto &entry : std::filesystem::directory_iterator(data_dir)) {
+      auto parsed = parse_sst_filename(entry.path().filename().string());
+      if (parsed.has_value() && !live_ids.count(parsed->first)) {
+        obsolete_files.push_back(entry.path());
+        next_sst_id = std::max(parsed->first + 1, next_sst_id.load());
       }
-      size_t level = std::stoull(level_str);
-
-      // 提取SST ID
-      std::string id_str = filename.substr(4, dot_pos - 4); // 4 for "sst_"
-      if (id_str.empty()) {
-        continue;
+    }
+  } catch (const std::exception &e) {
+    spdlog::warn("LSMEngine--"
+                 "Failed to list obsolete SST files: {}",
+                 e.what());
+  }
+  if (obsolete_files.empty()) {
+    return;
+  }
+  compact_pool->submit([obsolete_files = std::move(obsolete_files)]() {
+    size_t removed = 0;
+    for (const auto &path : obsolete_files) {
+      std::error_code ec;
+      if (std::filesystem::remove(path, ec)) {
+        removed++;
+      } else if (ec) {
+        spdlog::warn("LSMEngine--"
+                     "Failed to remove obsolete SST file {}: {}",
+                     path.string(), ec.message());
       }
-      size_t sst_id = std::stoull(id_str);
-
-      // 加载SST文件, 初始化时需要加写锁
-      std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
-
-      next_sst_id = std::max(sst_id, next_sst_id); // 记录目前最大的 sst_id
-      cur_max_level = std::max(level, cur_max_level); // 记录目前最大的 level
-      std::string sst_path = get_sst_path(sst_id, level);
-      auto sst = SST::open(sst_id, FileObj::open(sst_path, false), block_cache);
+    }
+    if (removed > 0) {
       spdlog::info("LSMEngine--"
-                   "Loaded SST: {} successfully!",
-                   sst_path);
-      ssts[sst_id] = sst;
-
-      level_sst_ids[level].push_back(sst_id);
+                   "Removed {} obsolete SST files",
+                   removed);
     }
+  });
+}
 
-    next_sst_id++; // 现有的最大 sst_id 自增后才是下一个分配的 sst_id
+void LSMEngine::load_from_directory() {
+  // 没有 manifest 的旧数据目录, 扫描 sst 文件后生成 manifest
+  struct SstFile {
+    size_t sst_id;
+    size_t level;
+    std::string path;
+  };
+  std::vector<SstFile> sst_files;
+  for (const auto &entry : std::filesystem::directory_iterator(data_dir)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    auto parsed = parse_sst_filename(entry.path().filename().string());
+    if (!parsed.has_value()) {
+      continue;
+    }
+    sst_files.push_back({parsed->first, parsed->second, entry.path().string()});
+  }
 
-    for (auto &[level, sst_id_list] : level_sst_ids) {
-      std::sort(sst_id_list.begin(), sst_id_list.end());
-      if (level == 0) {
-        // 其他 level 的 sst 都是没有重叠的, 且 id 小的表示 key
-        // 排序在前面的部分, 不需要 reverse
-        std::reverse(sst_id_list.begin(), sst_id_list.end());
-      }
+  // 并行打开所有 sst, 每个 sst 只读取尾部和顶层索引,
+  // index 和 filter 分区在首次访问时才加载
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::shared_ptr<SST>> opened(sst_files.size());
+  std::vector<std::exception_ptr> errors(sst_files.size());
+  auto read_mode = file_read_mode_from_string(
+      TomlConfig::getInstance().getLsmSstReadMode());
+  if (!sst_files.empty()) {
+    size_t num_threads = std::min(sst_files.size(), kSstOpenThreads);
+    ThreadPool open_pool(num_threads);
+    // 每个线程处理连续的一段, 避免逐个提交任务的调度开销
+    size_t per_thread = (sst_files.size() + num_threads - 1) / num_threads;
+    for (size_t begin = 0; begin < sst_files.size(); begin += per_thread) {
+      size_t end = std::min(begin + per_thread, sst_files.size());
+      open_pool.submit([&, begin, end]() {
+        for (size_t i = begin; i < end; ++i) {
+          const auto &file = sst_files[i];
+          try {
+            opened[i] = SST::open(
+                file.sst_id, FileObj::open_read_only(file.path, read_mode),
+                block_cache, file.level);
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        }
+      });
     }
+    // 等待所有打开任务完成
+    open_pool.shutdown();
   }
+  for (size_t i = 0; i < sst_files.size(); ++i) {
+    if (errors[i]) {
+      spdlog::error("LSMEngine--"
+                    "Failed to load SST: {}",
+                    sst_files[i].path);
+      std::rethrow_exception(errors[i]);
+    }
+  }
+
+  // 加载SST文件, 初始化时需要加写锁
+  std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+  VersionEdit edit;
+  for (size_t i = 0; i < sst_files.size(); ++i) {
+    const auto &file = sst_files[i];
+    next_sst_id =
+        std::max(file.sst_id, next_sst_id.load()); // 记录目前最大的 sst_id
+    cur_max_level = std::max(file.level, cur_max_level); // 记录目前最大的 level
+    edit.added_ssts.push_back(opened[i]->get_meta());
+    ssts[file.sst_id] = std::move(opened[i]);
+    level_sst_ids[file.level].push_back(file.sst_id);
+  }
+  spdlog::info("LSMEngine--"
+               "Loaded {} SSTs in {} ms",
+               sst_files.size(),
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count());
+
+  next_sst_id++; // 现有的最大 sst_id 自增后才是下一个分配的 sst_id
+
+  for (auto &[level, sst_id_list] : level_sst_ids) {
+    sort_level(level);
+  }
+  install_version();
+
+  edit.next_sst_id = next_sst_id.load();
+  manifest = std::make_unique<Manifest>(data_dir);
+  manifest->log_and_apply(edit);
 }
 
-LSMEngine::~LSMEngine() = default;
+LSMEngine::~LSMEngine() {
+  // 后台任务持有 this, 必须在成员析构前全部结束
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    stop_compaction = true;
+  }
+  wait_for_compaction();
+  compact_pool->shutdown();
+}
 
 std::optional<std::pair<std::string, uint64_t>>
 LSMEngine::get(const std::string &key, uint64_t tranc_id) {
@@ -98,31 +260,14 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
     }
   }
 
-  std::shared_lock<std::shared_mutex> rlock(ssts_mtx);
-  for (auto &sst_id : level_sst_ids[0]) {
-    //  中的 sst_id 是按从大到小的顺序排列,
-    // sst_id 越大, 表示是越晚刷入的, 优先查询
-    auto &sst = ssts[sst_id];
-    auto sst_iterator = sst->get(key, tranc_id);
-    if (sst_iterator != sst->end()) {
-      if ((sst_iterator)->second.size() > 0) {
-        return std::pair<std::string, uint64_t>{
-            sst_iterator->second, sst_iterator.get_transaction_id()};
-      } else {
-        return std::nullopt;
-      }
-    }
-  }
-  for (size_t level = 1; level <= cur_max_level; level++) {
-    std::deque<size_t> l_sst_ids = level_sst_ids[level];
-    size_t left = 0;
-    ;
-    size_t right = l_sst_ids.size();
-    while (left < right) {
-
-      size_t mid = (left + right) / 2;
-      auto &sst = ssts[l_sst_ids[mid]];
-      if (sst->get_first_key() <= key && key <= sst->get_last_key()) {
+  // 先读 memtable 再获取 Version: flush 发布新 Version 后才会从 memtable
+  // 中移除已刷盘的表, 因此 memtable 中找不到的数据一定在这个 Version 中
+  auto version = get_current_version();
+  for (const auto &[level, level_ssts] : version->levels) {
+    if (is_overlapping_level(level)) {
+      for (auto &sst : level_ssts) {
+        // 有重叠的层中 sst_id 是按从大到小的顺序排列,
+        // sst_id 越大, 表示是越晚写入的, 优先查询
         auto sst_iterator = sst->get(key, tranc_id);
         if (sst_iterator != sst->end()) {
           if ((sst_iterator)->second.size() > 0) {
@@ -132,11 +277,23 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
             return std::nullopt;
           }
         }
-        break;
-      } else if (sst->get_first_key() > key) {
-        right = mid;
+      }
+      continue;
+    }
+
+    // 通过该层的 fence 定位唯一可能包含 key 的 sst
+    size_t idx = version->find_sst(level, key);
+    if (idx == level_ssts.size()) {
+      continue;
+    }
+    auto &sst = level_ssts[idx];
+    auto sst_iterator = sst->get(key, tranc_id);
+    if (sst_iterator != sst->end()) {
+      if ((sst_iterator)->second.size() > 0) {
+        return std::pair<std::string, uint64_t>{
+            sst_iterator->second, sst_iterator.get_transaction_id()};
       } else {
-        left = mid + 1;
+        return std::nullopt;
       }
     }
   }
@@ -164,28 +321,38 @@ LSMEngine::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
   }
 
   // 2. 从 L0 层 SST 文件中批量查找未命中的键
-  std::shared_lock<std::shared_mutex> rlock(ssts_mtx); // 加读锁
-  for (auto &[key, value] : results) {
-    for (auto &sst_id : level_sst_ids[0]) {
-      auto &sst = ssts[sst_id];
-      auto sst_iterator = sst->get(key, tranc_id);
-      if (sst_iterator != sst->end()) {
-        if (sst_iterator->second.size() > 0) {
-          // 值存在且不为空
-          value = std::make_pair(sst_iterator->second,
-                                 sst_iterator.get_transaction_id());
-        } else {
-          // 空值表示被删除
-          value = std::nullopt;
+  auto version = get_current_version();
+  for (const auto &[level, level_ssts] : version->levels) {
+    if (!is_overlapping_level(level)) {
+      continue;
+    }
+    for (auto &[key, value] : results) {
+      if (value.has_value()) // 已找到，跳过
+      {
+        continue;
+      }
+      for (auto &sst : level_ssts) {
+        auto sst_iterator = sst->get(key, tranc_id);
+        if (sst_iterator != sst->end()) {
+          if (sst_iterator->second.size() > 0) {
+            // 值存在且不为空
+            value = std::make_pair(sst_iterator->second,
+                                   sst_iterator.get_transaction_id());
+          } else {
+            // 空值表示被删除
+            value = std::nullopt;
+          }
+          break; // 停止继续查找
         }
-        break; // 停止继续查找
       }
     }
   }
 
   // 3. 从其他层级 SST 文件中批量查找未命中的键
-  for (size_t level = 1; level <= cur_max_level; level++) {
-    std::deque<size_t> l_sst_ids = level_sst_ids[level];
+  for (const auto &[level, level_ssts] : version->levels) {
+    if (is_overlapping_level(level)) {
+      continue;
+    }
 
     for (auto &[key, value] : results) {
       if (value.has_value()) // 已找到，跳过
@@ -193,31 +360,21 @@ LSMEngine::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
         continue;
       }
 
-      // 二分查找确定键可能所在的 SST 文件
-      size_t left = 0;
-      size_t right = l_sst_ids.size();
-      while (left < right) {
-        size_t mid = left + (right - left) / 2;
-        auto &sst = ssts[l_sst_ids[mid]];
-
-        if (sst->get_first_key() <= key && key <= sst->get_last_key()) {
-          // 如果键在当前 SST 文件范围内，则在 SST 中查找
-          auto sst_iterator = sst->get(key, tranc_id);
-          if (sst_iterator.is_valid()) {
-            if (sst_iterator->second.size() > 0) {
-              // 值存在且不为空
-              value = std::make_pair(sst_iterator->second,
-                                     sst_iterator.get_tranc_id());
-            } else {
-              // 空值表示被删除
-              value = std::nullopt;
-            }
-          }
-          break; // 停止继续查找
-        } else if (sst->get_last_key() < key) {
-          left = mid + 1;
+      // 通过该层的 fence 定位键可能所在的 SST 文件
+      size_t idx = version->find_sst(level, key);
+      if (idx == level_ssts.size()) {
+        continue;
+      }
+      auto &sst = level_ssts[idx];
+      auto sst_iterator = sst->get(key, tranc_id);
+      if (sst_iterator.is_valid()) {
+        if (sst_iterator->second.size() > 0) {
+          // 值存在且不为空
+          value = std::make_pair(sst_iterator->second,
+                                 sst_iterator.get_tranc_id());
         } else {
-          right = mid;
+          // 空值表示被删除
+          value = std::nullopt;
         }
       }
     }
@@ -275,9 +432,12 @@ uint64_t LSMEngine::remove_batch(const std::vector<std::string> &keys,
 }
 
 void LSMEngine::clear() {
+  wait_for_compaction();
+  std::unique_lock<std::shared_mutex> lock(ssts_mtx);
   memtable.clear();
   level_sst_ids.clear();
   ssts.clear();
+  install_version();
   // 清空当前文件夹的所有内容
   try {
     for (const auto &entry : std::filesystem::directory_iterator(data_dir)) {
@@ -289,6 +449,8 @@ void LSMEngine::clear() {
   } catch (const std::filesystem::filesystem_error &e) {
     // 处理文件系统错误
   }
+  // manifest 已随其他文件一起删除, 重新创建空的 manifest
+  manifest = std::make_unique<Manifest>(data_dir);
 }
 
 uint64_t LSMEngine::flush() {
@@ -296,39 +458,61 @@ uint64_t LSMEngine::flush() {
     return 0;
   }
 
-  std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+  std::shared_ptr<SST> new_sst;
+  std::vector<uint64_t> flushed_tranc_ids;
+  {
+    // 写锁只覆盖 memtable 落盘和 l0 的更新,
+    // compact 由后台线程完成, 不在这里阻塞读写
+    std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+
+    // 1. 创建新的 SST ID
+    size_t new_sst_id = next_sst_id++;
+
+    // 2. 准备 SSTBuilder
+    SSTBuilder builder(TomlConfig::getInstance().getLsmBlockSize(),
+                       true); // 4KB block size
+
+    // 3. 将 memtable 中最旧的表写入 SST
+    auto sst_path = get_sst_path(new_sst_id, 0);
+    new_sst = memtable.flush_last(builder, sst_path, new_sst_id,
+                                  flushed_tranc_ids, block_cache);
+    if (new_sst == nullptr) {
+      // 没有冻结表时 flush_last 只会冻结当前表, 本次没有生成 sst
+      return 0;
+    }
 
-  // 1. 先判断 l0 sst 是否数量超限需要concat到 l1
-  if (level_sst_ids.find(0) != level_sst_ids.end() &&
-      level_sst_ids[0].size() >=
-          TomlConfig::getInstance().getLsmSstLevelRatio()) {
-    full_compact(0);
-  }
+    // 4. 先写入 manifest, 重启后才能看到这个 sst
+    VersionEdit edit;
+    edit.added_ssts.push_back(new_sst->get_meta());
+    edit.next_sst_id = next_sst_id.load();
+    manifest->log_and_apply(edit);
 
-  // 2. 创建新的 SST ID
-  size_t new_sst_id = next_sst_id++;
+    // 5. 更新内存索引
+    ssts[new_sst_id] = new_sst;
 
-  // 3. 准备 SSTBuilder
-  SSTBuilder builder(TomlConfig::getInstance().getLsmBlockSize(),
-                     true); // 4KB block size
+    // 6. 更新 sst_ids
+    level_sst_ids[0].push_front(new_sst_id);
 
-  // 4. 将 memtable 中最旧的表写入 SST
-  std::vector<uint64_t> flushed_tranc_ids;
-  auto sst_path = get_sst_path(new_sst_id, 0);
-  auto new_sst =
-      memtable.flush_last(builder, sst_path, new_sst_id, flushed_tranc_ids, block_cache);
-
-  // 5. 更新内存索引
-  ssts[new_sst_id] = new_sst;
+    // 7. 发布包含新 sst 的 Version 后才能从 memtable 中移除已刷盘的表,
+    // 否则先查 memtable 再取 Version 的读者可能在两处都找不到这些数据
+    install_version();
+    memtable.pop_flushed_table();
+  }
 
-  // 6. 更新 sst_ids
-  level_sst_ids[0].push_front(new_sst_id);
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    flush_bytes += new_sst->sst_size();
+    // 新数据可能改变 compact 的输入, 之前失败的 level 可以重试
+    failed_levels.clear();
+  }
 
-  // 7. 添加到 flushed 集合
-  for (auto& id : flushed_tranc_ids) {
+  // 8. 添加到 flushed 集合
+  for (auto &id : flushed_tranc_ids) {
     tran_manager.lock()->add_flushed_tranc_id(id);
   }
 
+  // 9. l0 sst 数量超限时由后台线程 compact 到 l1
+  maybe_schedule_compaction();
 
   return new_sst->get_tranc_id_range().second;
 }
@@ -344,15 +528,39 @@ std::string LSMEngine::get_sst_path(size_t sst_id, size_t target_level) {
 std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
 LSMEngine::lsm_iters_monotony_predicate(
     uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
+  return iters_monotony_predicate_(tranc_id, predicate, std::nullopt);
+}
+
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSMEngine::lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix) {
+  auto predicate = [&preffix](const std::string &key) {
+    return -key.compare(0, preffix.size(), preffix);
+  };
+  std::optional<std::string> filter_prefix = std::nullopt;
+  if (prefix_extractor != nullptr) {
+    filter_prefix = prefix_extractor->prefix_for_scan(preffix);
+  }
+  return iters_monotony_predicate_(tranc_id, predicate, filter_prefix);
+}
+
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSMEngine::iters_monotony_predicate_(
+    uint64_t tranc_id, std::function<int(const std::string &)> predicate,
+    const std::optional<std::string> &filter_prefix) {
 
   //  先从 memtable 中查询
   auto mem_result = memtable.iters_monotony_predicate(tranc_id, predicate);
 
   // 再从 sst 中查询
   std::vector<SearchItem> item_vec;
-  for (auto &[sst_level, sst_ids] : level_sst_ids) {
-    for (auto &sst_id : sst_ids) {
-      auto sst = ssts[sst_id];
+  auto version = get_current_version();
+  for (const auto &[sst_level, level_ssts] : version->levels) {
+    for (const auto &sst : level_ssts) {
+      size_t sst_id = sst->get_sst_id();
+      if (filter_prefix.has_value() &&
+          !sst->may_contain_prefix(*filter_prefix, *prefix_extractor)) {
+        continue;
+      }
       auto result = sst_iters_monotony_predicate(sst, tranc_id, predicate);
       if (!result.has_value()) {
         continue;
@@ -407,164 +615,560 @@ LSMEngine::lsm_iters_monotony_predicate(
 }
 
 
-Level_Iterator LSMEngine::begin(uint64_t tranc_id) {
-  return Level_Iterator(shared_from_this(), tranc_id);
+Level_Iterator LSMEngine::begin(uint64_t tranc_id, bool fill_cache) {
+  return Level_Iterator(shared_from_this(), tranc_id, fill_cache);
 }
 
 Level_Iterator LSMEngine::end() { return Level_Iterator{}; }
 
-void LSMEngine::full_compact(size_t src_level) {
-  // 将 src_level 的 sst 全体压缩到 src_level + 1
+void LSMEngine::maybe_schedule_compaction() {
+  size_t ratio = TomlConfig::getInstance().getLsmSstLevelRatio();
+  std::vector<size_t> over_limit_levels;
+  for (const auto &[level, level_ssts] : get_current_version()->levels) {
+    // tiered 模式下按 run 的数量触发, l0 的每个 sst 来自一次 flush,
+    // 仍按 sst 数量触发
+    size_t num_runs = level_ssts.size();
+    if (compact_type == CompactType::TieredCompact && level > 0) {
+      num_runs = split_sorted_runs(level_ssts).size();
+    }
+    if (compact_type == CompactType::LeveledCompact && level > 0) {
+      // leveled 模式下每次只移走一个 sst, 移入没有重叠的区间时不会与下层合并,
+      // 各层的 sst 可能远小于目标大小, 按 sst 数量触发会使层数不断增加.
+      // 改为按整层的大小触发, 容量与 full 模式下 ratio 个 sst 相同
+      size_t level_bytes = 0;
+      for (const auto &sst : level_ssts) {
+        level_bytes += sst->sst_size();
+      }
+      if (level_bytes >= ratio * get_sst_size(level)) {
+        over_limit_levels.push_back(level);
+      }
+      continue;
+    }
+    if (num_runs >= ratio) {
+      over_limit_levels.push_back(level);
+    }
+  }
 
-  // 递归地判断下一级 level 是否需要 full compact
-  if (level_sst_ids[src_level + 1].size() >=
-      TomlConfig::getInstance().getLsmSstLevelRatio()) {
-    full_compact(src_level + 1);
+  std::lock_guard<std::mutex> lock(compact_mtx);
+  if (stop_compaction) {
+    return;
   }
+  for (auto level : over_limit_levels) {
+    // src_level 和 src_level + 1 都会被修改, 与正在执行的任务冲突时跳过,
+    // 等该任务结束后会重新检查
+    if (compacting_levels.count(level) || compacting_levels.count(level + 1) ||
+        failed_levels.count(level)) {
+      continue;
+    }
+    compacting_levels.insert(level);
+    compacting_levels.insert(level + 1);
+    compact_queued++;
+    compact_pool->submit([this, level]() { run_compaction_job(level); });
+  }
+}
+
+void LSMEngine::run_compaction_job(size_t src_level) {
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    compact_queued--;
+    compact_running++;
+  }
+
+  try {
+    if (compact_type == CompactType::LeveledCompact) {
+      leveled_compact(src_level);
+    } else if (compact_type == CompactType::TieredCompact) {
+      tiered_compact(src_level);
+    } else {
+      full_compact(src_level);
+    }
+  } catch (const std::exception &e) {
+    spdlog::error("LSMEngine--"
+                  "Compaction: level{} to level{} failed, retry after the "
+                  "next flush: {}",
+                  src_level, src_level + 1, e.what());
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    failed_levels.insert(src_level);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    compacting_levels.erase(src_level);
+    compacting_levels.erase(src_level + 1);
+  }
+
+  // 本次 compact 可能使下一层超限, 先提交后续任务再减少 running 计数,
+  // 保证 wait_for_compaction 不会在两个任务之间提前返回
+  maybe_schedule_compaction();
+
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    compact_running--;
+    compact_finished++;
+  }
+  compact_cv.notify_all();
+}
+
+void LSMEngine::wait_for_compaction() {
+  std::unique_lock<std::mutex> lock(compact_mtx);
+  compact_cv.wait(lock, [this]() {
+    return compact_queued == 0 && compact_running == 0;
+  });
+}
+
+CompactionStats LSMEngine::get_compaction_stats() {
+  std::lock_guard<std::mutex> lock(compact_mtx);
+  return CompactionStats{compact_queued,     compact_running,
+                         compact_finished,   flush_bytes,
+                         compact_read_bytes, compact_write_bytes,
+                         dropped_versions,   dropped_tombstones};
+}
+
+BlockCacheStats LSMEngine::get_block_cache_stats() const {
+  return block_cache->get_stats();
+}
+
+void LSMEngine::full_compact(size_t src_level) {
+  // 将 src_level 的 sst 全体压缩到 src_level + 1
+  // 调用方保证 src_level 和 src_level + 1 没有其他 compact 任务在执行
 
   spdlog::debug("LSMEngine--"
                 "Compaction: Starting full compaction from level{} to level{}",
                 src_level, src_level + 1);
 
-  // 获取源level和目标level的 sst_id
-  auto old_level_id_x = level_sst_ids[src_level];
-  auto old_level_id_y = level_sst_ids[src_level + 1];
+  // 1. 在读锁下获取源level和目标level的 sst 快照
+  // 快照之后 flush 仍可能向 l0 头部插入新的 sst, 它们不参与本次 compact
+  std::vector<std::shared_ptr<SST>> lx_ssts;
+  std::vector<std::shared_ptr<SST>> ly_ssts;
+  bool is_bottom = false;
+  {
+    std::shared_lock<std::shared_mutex> rlock(ssts_mtx);
+    auto x_it = level_sst_ids.find(src_level);
+    if (x_it == level_sst_ids.end() || x_it->second.empty()) {
+      return;
+    }
+    for (auto id : x_it->second) {
+      lx_ssts.push_back(ssts.at(id));
+    }
+    auto y_it = level_sst_ids.find(src_level + 1);
+    if (y_it != level_sst_ids.end()) {
+      for (auto id : y_it->second) {
+        ly_ssts.push_back(ssts.at(id));
+      }
+    }
+    is_bottom = is_bottom_level(src_level + 1);
+  }
+
+  // 2. 不持有引擎锁, 构建新的 sst
   std::vector<std::shared_ptr<SST>> new_ssts;
-  std::vector<size_t> lx_ids(old_level_id_x.begin(), old_level_id_x.end());
-  std::vector<size_t> ly_ids(old_level_id_y.begin(), old_level_id_y.end());
   if (src_level == 0) {
     // l0这一层不同sst的key有重叠, 需要额外处理
-    new_ssts = full_l0_l1_compact(lx_ids, ly_ids);
+    new_ssts = full_l0_l1_compact(lx_ssts, ly_ssts, is_bottom);
   } else {
-    new_ssts = full_common_compact(lx_ids, ly_ids, src_level + 1);
+    new_ssts = full_common_compact(lx_ssts, ly_ssts, src_level + 1, is_bottom);
   }
-  // 完成 compact 后移除旧的sst记录
-  for (auto &old_sst_id : old_level_id_x) {
-    ssts[old_sst_id]->del_sst();
-    ssts.erase(old_sst_id);
+
+  // 3. 替换 sst 记录
+  install_compaction(src_level, lx_ssts, ly_ssts, new_ssts);
+
+  spdlog::debug("LSMEngine--"
+                "Compaction: Finished compaction. New SSTs added at level{}",
+                src_level + 1);
+}
+
+void LSMEngine::leveled_compact(size_t src_level) {
+  // 只挑选 src_level 中的一部分 sst, 与 src_level + 1 中 key 范围重叠的 sst
+  // 合并, 其余 sst 保持不动, 写放大只和重叠部分的大小有关
+  // 调用方保证 src_level 和 src_level + 1 没有其他 compact 任务在执行
+
+  std::string cursor;
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    cursor = compact_cursor[src_level];
   }
-  for (auto &old_sst_id : old_level_id_y) {
-    ssts[old_sst_id]->del_sst();
-    ssts.erase(old_sst_id);
+
+  std::vector<std::shared_ptr<SST>> lx_ssts;
+  std::vector<std::shared_ptr<SST>> ly_ssts;
+  bool is_bottom = false;
+  {
+    std::shared_lock<std::shared_mutex> rlock(ssts_mtx);
+    auto x_it = level_sst_ids.find(src_level);
+    if (x_it == level_sst_ids.end() || x_it->second.empty()) {
+      return;
+    }
+
+    // 1. 挑选 src_level 中参与 compact 的 sst
+    if (src_level == 0) {
+      // l0 的 sst 之间有重叠, 且 l1 中的数据必须比 l0 中剩余的数据更旧,
+      // 因此快照中的 l0 sst 需要全部参与
+      for (auto id : x_it->second) {
+        lx_ssts.push_back(ssts.at(id));
+      }
+    } else {
+      // 从上次的游标位置开始轮转挑选一个 sst, 到达末尾后回到开头
+      auto picked = x_it->second.front();
+      for (auto id : x_it->second) {
+        if (ssts.at(id)->get_first_key() > cursor) {
+          picked = id;
+          break;
+        }
+      }
+      lx_ssts.push_back(ssts.at(picked));
+      cursor = lx_ssts.back()->get_last_key();
+    }
+
+    // 2. 通过首尾key找到 src_level + 1 中与之重叠的 sst
+    std::string min_key = lx_ssts.front()->get_first_key();
+    std::string max_key = lx_ssts.front()->get_last_key();
+    for (auto &sst : lx_ssts) {
+      min_key = std::min(min_key, sst->get_first_key());
+      max_key = std::max(max_key, sst->get_last_key());
+    }
+    auto y_it = level_sst_ids.find(src_level + 1);
+    if (y_it != level_sst_ids.end()) {
+      for (auto id : y_it->second) {
+        auto &sst = ssts.at(id);
+        if (sst->get_last_key() < min_key || sst->get_first_key() > max_key) {
+          continue;
+        }
+        ly_ssts.push_back(sst);
+      }
+    }
+    // src_level + 1 中未参与的 sst 与这些 key 不重叠, 只需看更深的层
+    is_bottom = is_bottom_level(src_level + 1);
+  }
+
+  spdlog::debug("LSMEngine--"
+                "Compaction: Starting leveled compaction from level{} "
+                "({} ssts) to level{} ({} overlapping ssts)",
+                src_level, lx_ssts.size(), src_level + 1, ly_ssts.size());
+
+  if (src_level > 0) {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    compact_cursor[src_level] = cursor;
+  }
+
+  // 3. 不持有引擎锁, 构建新的 sst
+  std::vector<std::shared_ptr<SST>> new_ssts;
+  if (src_level == 0) {
+    new_ssts = full_l0_l1_compact(lx_ssts, ly_ssts, is_bottom);
+  } else {
+    new_ssts = full_common_compact(lx_ssts, ly_ssts, src_level + 1, is_bottom);
   }
-  level_sst_ids[src_level].clear();
-  level_sst_ids[src_level + 1].clear();
 
-  cur_max_level = std::max(cur_max_level, src_level + 1);
+  // 4. 替换 sst 记录
+  install_compaction(src_level, lx_ssts, ly_ssts, new_ssts);
+
+  spdlog::debug("LSMEngine--"
+                "Compaction: Finished leveled compaction. {} new SSTs added "
+                "at level{}",
+                new_ssts.size(), src_level + 1);
+}
 
-  // 添加新的sst
-  for (auto &new_sst : new_ssts) {
-    level_sst_ids[src_level + 1].push_back(new_sst->get_sst_id());
-    ssts[new_sst->get_sst_id()] = new_sst;
+void LSMEngine::tiered_compact(size_t src_level) {
+  // tiered 模式下同一层的 sorted run 互相重叠, 且比下一层的所有 run 都新.
+  // 将 src_level 中的全部 run 合并为一个更大的 run, 作为最新的 run
+  // 放入 src_level + 1, 下一层的数据不需要重写
+  // 调用方保证 src_level 和 src_level + 1 没有其他 compact 任务在执行
+
+  std::vector<std::shared_ptr<SST>> lx_ssts;
+  bool is_bottom = false;
+  {
+    std::shared_lock<std::shared_mutex> rlock(ssts_mtx);
+    auto x_it = level_sst_ids.find(src_level);
+    if (x_it == level_sst_ids.end() || x_it->second.empty()) {
+      return;
+    }
+    for (auto id : x_it->second) {
+      lx_ssts.push_back(ssts.at(id));
+    }
+    // src_level + 1 中已有的 run 不参与合并, 它们也比新 run 更旧
+    auto y_it = level_sst_ids.find(src_level + 1);
+    is_bottom = (y_it == level_sst_ids.end() || y_it->second.empty()) &&
+                is_bottom_level(src_level + 1);
   }
-  // 此处没必要reverse了
-  std::sort(level_sst_ids[src_level + 1].begin(),
-            level_sst_ids[src_level + 1].end());
 
+  // lx_ssts 按 sst_id 降序排列, 划分得到的 run 从新到旧
+  auto runs = split_sorted_runs(lx_ssts);
   spdlog::debug("LSMEngine--"
-                "Compaction: Finished compaction. New SSTs added at level{}",
+                "Compaction: Starting tiered compaction of {} runs from "
+                "level{} to level{}",
+                runs.size(), src_level, src_level + 1);
+  CompactMerger merger(std::move(runs), get_oldest_active_tranc_id(),
+                       is_bottom);
+
+  // 合并结果按下一层的 sst 大小切分, 这些 sst 的 sst_id 和 key 同时递增,
+  // split_sorted_runs 会把它们识别为同一个 run
+  auto new_ssts =
+      gen_sst_from_iter(merger, get_sst_size(src_level + 1), src_level + 1);
+
+  install_compaction(src_level, lx_ssts, {}, new_ssts);
+
+  spdlog::debug("LSMEngine--"
+                "Compaction: Finished tiered compaction. New run added at "
+                "level{}",
                 src_level + 1);
 }
 
-std::vector<std::shared_ptr<SST>>
-LSMEngine::full_l0_l1_compact(std::vector<size_t> &l0_ids,
-                              std::vector<size_t> &l1_ids) {
-  // TODO: 这里需要补全的是对已经完成事务的删除
-  std::vector<SstIterator> l0_iters;
-  std::vector<std::shared_ptr<SST>> l1_ssts;
+void LSMEngine::install_compaction(
+    size_t src_level, const std::vector<std::shared_ptr<SST>> &lx_ssts,
+    const std::vector<std::shared_ptr<SST>> &ly_ssts,
+    const std::vector<std::shared_ptr<SST>> &new_ssts) {
+  uint64_t read_bytes = 0;
+  uint64_t write_bytes = 0;
+
+  // 1. 在写锁下原子地替换 sst 记录
+  {
+    std::unique_lock<std::shared_mutex> lock(ssts_mtx);
+    std::set<size_t> old_ids;
+    for (auto &sst : lx_ssts) {
+      old_ids.insert(sst->get_sst_id());
+      read_bytes += sst->sst_size();
+    }
+    for (auto &sst : ly_ssts) {
+      old_ids.insert(sst->get_sst_id());
+      read_bytes += sst->sst_size();
+    }
+    auto is_old = [&old_ids](size_t id) { return old_ids.count(id) > 0; };
+
+    // 删除和新增记录在同一个 edit 中, 重启后要么看到 compact 前的 sst,
+    // 要么看到 compact 后的 sst; 写入失败时抛出异常, 不修改内存中的记录
+    VersionEdit edit;
+    edit.deleted_ssts.assign(old_ids.begin(), old_ids.end());
+    for (auto &new_sst : new_ssts) {
+      edit.added_ssts.push_back(new_sst->get_meta());
+    }
+    edit.next_sst_id = next_sst_id.load();
+    try {
+      manifest->log_and_apply(edit);
+    } catch (...) {
+      // 新的 sst 没有记录到 manifest, 不会再被引用
+      for (auto &new_sst : new_ssts) {
+        new_sst->del_sst();
+      }
+      throw;
+    }
 
-  for (auto id : l0_ids) {
-    auto sst_it = ssts[id]->begin(0);
-    l0_iters.push_back(sst_it);
-  }
-  for (auto id : l1_ids) {
-    l1_ssts.push_back(ssts[id]);
+    auto &level_x = level_sst_ids[src_level];
+    level_x.erase(std::remove_if(level_x.begin(), level_x.end(), is_old),
+                  level_x.end());
+    auto &level_y = level_sst_ids[src_level + 1];
+    level_y.erase(std::remove_if(level_y.begin(), level_y.end(), is_old),
+                  level_y.end());
+    for (auto id : old_ids) {
+      ssts.erase(id);
+    }
+
+    for (auto &new_sst : new_ssts) {
+      level_y.push_back(new_sst->get_sst_id());
+      ssts[new_sst->get_sst_id()] = new_sst;
+      write_bytes += new_sst->sst_size();
+    }
+    sort_level(src_level + 1);
+
+    cur_max_level = std::max(cur_max_level, src_level + 1);
+    install_version();
   }
-  // l0 的sst之间的key有重叠, 需要合并
-  auto [l0_begin, l0_end] = SstIterator::merge_sst_iterator(l0_iters, 0);
 
-  std::shared_ptr<HeapIterator> l0_begin_ptr = std::make_shared<HeapIterator>();
-  *l0_begin_ptr = l0_begin;
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    compact_read_bytes += read_bytes;
+    compact_write_bytes += write_bytes;
+    spdlog::debug("LSMEngine--"
+                  "Compaction: read {} bytes, wrote {} bytes",
+                  read_bytes, write_bytes);
+  }
 
-  std::shared_ptr<ConcactIterator> old_l1_begin_ptr =
-      std::make_shared<ConcactIterator>(l1_ssts, 0);
+  // 2. 旧文件已不可见, 在锁外删除
+  // 仍在使用旧 sst 的读者持有其 shared_ptr, 已打开的文件不受影响
+  for (auto &old_sst : lx_ssts) {
+    old_sst->del_sst();
+  }
+  for (auto &old_sst : ly_ssts) {
+    old_sst->del_sst();
+  }
+}
 
-  TwoMergeIterator l0_l1_begin(l0_begin_ptr, old_l1_begin_ptr, 0);
+std::shared_ptr<const Version> LSMEngine::get_current_version() const {
+  return std::atomic_load(&current_version);
+}
 
-  return gen_sst_from_iter(l0_l1_begin,
-                           TomlConfig::getInstance().getLsmPerMemSizeLimit() *
-                               TomlConfig::getInstance().getLsmSstLevelRatio(),
-                           1);
+void LSMEngine::install_version() {
+  auto version = std::make_shared<Version>();
+  for (const auto &[level, sst_ids] : level_sst_ids) {
+    if (sst_ids.empty()) {
+      continue;
+    }
+    auto &level_ssts = version->levels[level];
+    level_ssts.reserve(sst_ids.size());
+    for (auto sst_id : sst_ids) {
+      level_ssts.push_back(ssts.at(sst_id));
+    }
+    if (!is_overlapping_level(level)) {
+      version->build_fence(level);
+    }
+  }
+  std::atomic_store(&current_version,
+                    std::shared_ptr<const Version>(std::move(version)));
 }
 
-std::vector<std::shared_ptr<SST>>
-LSMEngine::full_common_compact(std::vector<size_t> &lx_ids,
-                               std::vector<size_t> &ly_ids, size_t level_y) {
-  // TODO 需要补全已完成事务的滤除
-  std::vector<std::shared_ptr<SST>> lx_iters;
-  std::vector<std::shared_ptr<SST>> ly_iters;
+bool LSMEngine::is_overlapping_level(size_t level) const {
+  return level == 0 || compact_type == CompactType::TieredCompact;
+}
 
-  for (auto id : lx_ids) {
-    lx_iters.push_back(ssts[id]);
+std::vector<std::vector<std::shared_ptr<SST>>> LSMEngine::split_sorted_runs(
+    const std::vector<std::shared_ptr<SST>> &level_ssts) {
+  // 同一个 compact 输出的 sst 的 sst_id 和 key 同时递增; 不同 compact 的输出
+  // 恰好不重叠时也会被归入同一个 run, 由于它们没有相同的 key, 合并时
+  // 当作一个 run 处理仍然正确
+  std::vector<std::vector<std::shared_ptr<SST>>> runs;
+  for (auto it = level_ssts.rbegin(); it != level_ssts.rend(); ++it) {
+    if (runs.empty() ||
+        (*it)->get_first_key() <= runs.back().back()->get_last_key()) {
+      runs.emplace_back();
+    }
+    runs.back().push_back(*it);
   }
-  for (auto id : ly_ids) {
-    ly_iters.push_back(ssts[id]);
+  // 从旧到新构建, 反转为从新到旧
+  std::reverse(runs.begin(), runs.end());
+  return runs;
+}
+
+bool LSMEngine::is_bottom_level(size_t target_level) const {
+  // 只有 src_level 和 src_level + 1 被当前任务占用, 更深的层上的任务
+  // 只会把数据继续往下移, 不会让这里判断为空的层重新出现数据
+  for (auto &[level, sst_ids] : level_sst_ids) {
+    if (level > target_level && !sst_ids.empty()) {
+      return false;
+    }
   }
+  return true;
+}
 
-  std::shared_ptr<ConcactIterator> old_lx_begin_ptr =
-      std::make_shared<ConcactIterator>(lx_iters, 0);
+uint64_t LSMEngine::get_oldest_active_tranc_id() {
+  auto manager = tran_manager.lock();
+  if (manager == nullptr) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return manager->get_oldest_active_tranc_id();
+}
 
-  std::shared_ptr<ConcactIterator> old_ly_begin_ptr =
-      std::make_shared<ConcactIterator>(ly_iters, 0);
+void LSMEngine::sort_level(size_t level) {
+  // 调用方需持有 ssts_mtx
+  auto &sst_id_list = level_sst_ids[level];
+  if (is_overlapping_level(level)) {
+    // sst_id 越大表示越晚写入, 按 id 降序排列
+    std::sort(sst_id_list.begin(), sst_id_list.end(), std::greater<size_t>());
+    return;
+  }
+  // 其他 level 的 sst 都是没有重叠的, leveled compact 后 id 的大小
+  // 不再代表 key 的顺序, 需要按首key排序
+  std::sort(sst_id_list.begin(), sst_id_list.end(),
+            [this](size_t a, size_t b) {
+              return ssts[a]->get_first_key() < ssts[b]->get_first_key();
+            });
+}
 
-  TwoMergeIterator lx_ly_begin(old_lx_begin_ptr, old_ly_begin_ptr, 0);
+std::vector<std::shared_ptr<SST>>
+LSMEngine::full_l0_l1_compact(std::vector<std::shared_ptr<SST>> &l0_ssts,
+                              std::vector<std::shared_ptr<SST>> &l1_ssts,
+                              bool is_bottom) {
+  // l0 的sst之间的key有重叠, 每个 sst 单独作为一个 run, 越新越靠前
+  // l0_ssts 已按 sst_id 降序排列, l1 整体作为最旧的一个 run
+  std::vector<std::vector<std::shared_ptr<SST>>> runs;
+  for (auto &sst : l0_ssts) {
+    runs.push_back({sst});
+  }
+  runs.push_back(l1_ssts);
 
-  // TODO:如果目标 level 的下一级 level+1 不存在, 则为底层的level,
-  // 可以清理掉删除标记
+  CompactMerger merger(std::move(runs), get_oldest_active_tranc_id(),
+                       is_bottom);
+  return gen_sst_from_iter(merger,
+                           TomlConfig::getInstance().getLsmPerMemSizeLimit() *
+                               TomlConfig::getInstance().getLsmSstLevelRatio(),
+                           1);
+}
 
-  return gen_sst_from_iter(lx_ly_begin, LSMEngine::get_sst_size(level_y),
-                           level_y);
+std::vector<std::shared_ptr<SST>>
+LSMEngine::full_common_compact(std::vector<std::shared_ptr<SST>> &lx_ssts,
+                               std::vector<std::shared_ptr<SST>> &ly_ssts,
+                               size_t level_y, bool is_bottom) {
+  // lx 和 ly 内部都没有重叠, 各自作为一个 run, lx 比 ly 更新
+  CompactMerger merger({lx_ssts, ly_ssts}, get_oldest_active_tranc_id(),
+                       is_bottom);
+  return gen_sst_from_iter(merger, LSMEngine::get_sst_size(level_y), level_y);
 }
 
 std::vector<std::shared_ptr<SST>>
-LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
+LSMEngine::gen_sst_from_iter(CompactMerger &merger, size_t target_sst_size,
                              size_t target_level) {
-  // TODO: 这里需要补全的是对已经完成事务的删除
+  // merger 已经滤除了对所有活跃事务都不可见的旧版本,
+  // 剩余的版本连同其事务id原样写入新的 sst
+  // 深层的目标大小按层数指数增长, 限制在 u32 偏移量能表示的范围内
+  target_sst_size = std::min(target_sst_size, kMaxCompactSstSize);
 
   std::vector<std::shared_ptr<SST>> new_ssts;
   auto new_sst_builder =
       SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(), true);
-  while (iter.is_valid() && !iter.is_end()) {
-
-    new_sst_builder.add((*iter).first, (*iter).second, 0);
-    ++iter;
+  std::string last_key;
+  // 正在写入的文件, 失败时可能只写了一部分
+  std::string sst_path;
+  try {
+    while (merger.is_valid()) {
+      // 同一个 key 的多个版本必须位于同一个 sst,
+      // 否则非重叠层中按首尾key二分查找时会漏掉部分版本
+      if (new_sst_builder.estimated_size() >= target_sst_size &&
+          merger.key() != last_key) {
+        size_t sst_id = next_sst_id++;
+        sst_path = get_sst_path(sst_id, target_level);
+        auto new_sst = new_sst_builder.build(sst_id, sst_path,
+                                             this->block_cache, target_level);
+        new_ssts.push_back(new_sst);
+
+        spdlog::debug("LSMEngine--"
+                      "Compaction: Generated new SST file with sst_id={} "
+                      "at level{}",
+                      sst_id, target_level);
+
+        new_sst_builder = SSTBuilder(
+            TomlConfig::getInstance().getLsmBlockSize(), true); // 重置builder
+      }
 
-    if (new_sst_builder.estimated_size() >= target_sst_size) {
-      size_t sst_id = next_sst_id++; // TODO: 后续优化并发性
-      std::string sst_path = get_sst_path(sst_id, target_level);
-      auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache);
+      new_sst_builder.add(merger.key(), merger.value(), merger.tranc_id());
+      last_key = merger.key();
+      merger.next();
+    }
+    if (new_sst_builder.estimated_size() > 0) {
+      size_t sst_id = next_sst_id++;
+      sst_path = get_sst_path(sst_id, target_level);
+      auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache,
+                                           target_level);
       new_ssts.push_back(new_sst);
 
       spdlog::debug("LSMEngine--"
-                    "Compaction: Generated new SST file with sst_id={}"
+                    "Compaction: Generated new SST file with sst_id={} "
                     "at level{}",
                     sst_id, target_level);
-
-      new_sst_builder = SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(),
-                                   true); // 重置builder
     }
+  } catch (...) {
+    // 输出还没有记录到 manifest, 已生成的 sst 和写到一半的文件都不会
+    // 再被引用, 删除后再抛出, 否则每次失败都会在磁盘上留下这些文件
+    for (auto &new_sst : new_ssts) {
+      new_sst->del_sst();
+    }
+    std::error_code ec;
+    std::filesystem::remove(sst_path, ec);
+    throw;
   }
-  if (new_sst_builder.estimated_size() > 0) {
-    size_t sst_id = next_sst_id++; // TODO: 后续优化并发性
-    std::string sst_path = get_sst_path(sst_id, target_level);
-    auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache);
-    new_ssts.push_back(new_sst);
 
-    spdlog::debug("LSMEngine--"
-                  "Compaction: Generated new SST file with sst_id={} "
-                  "at level{}",
-                  sst_id, target_level);
+  {
+    std::lock_guard<std::mutex> lock(compact_mtx);
+    dropped_versions += merger.dropped_versions();
+    dropped_tombstones += merger.dropped_tombstones();
   }
+  spdlog::debug("LSMEngine--"
+                "Compaction: dropped {} obsolete versions and {} tombstones",
+                merger.dropped_versions(), merger.dropped_tombstones());
 
   return new_ssts;
 }
@@ -673,10 +1277,11 @@ void LSM::flush_all() {
     auto max_tranc_id = engine->flush();
     // tran_manager_->update_checkpoint_tranc_id(max_tranc_id);
   }
+  engine->wait_for_compaction();
 }
 
-LSM::LSMIterator LSM::begin(uint64_t tranc_id) {
-  return engine->begin(tranc_id);
+LSM::LSMIterator LSM::begin(uint64_t tranc_id, bool fill_cache) {
+  return engine->begin(tranc_id, fill_cache);
 }
 
 LSM::LSMIterator LSM::end() { return engine->end(); }
@@ -687,6 +1292,11 @@ LSM::lsm_iters_monotony_predicate(
   return engine->lsm_iters_monotony_predicate(tranc_id, predicate);
 }
 
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSM::lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix) {
+  return engine->lsm_iters_preffix(tranc_id, preffix);
+}
+
 // 开启一个事务
 std::shared_ptr<TranContext>
 LSM::begin_tran(const IsolationLevel &isolation_level) {
@@ -9,10 +9,8 @@
 // TODO: 需要进行单元测试
 namespace tiny_lsm {
 Level_Iterator::Level_Iterator(std::shared_ptr<LSMEngine> engine,
-                               uint64_t max_tranc_id)
-    : engine_(engine), max_tranc_id_(max_tranc_id), rlock_(engine_->ssts_mtx) {
-  // 成员变量获取sst读锁
-
+                               uint64_t max_tranc_id, bool fill_cache)
+    : engine_(engine), max_tranc_id_(max_tranc_id) {
   // 1. 获取内存部分迭代器
   // TODO: 这里最好修改 memtable.begin 使其返回一个指针, 避免多余的内存拷贝
   auto mem_iter = engine_->memtable.begin(max_tranc_id_);
@@ -20,38 +18,48 @@ Level_Iterator::Level_Iterator(std::shared_ptr<LSMEngine> engine,
   *mem_iter_ptr = mem_iter;
   iter_vec.push_back(mem_iter_ptr);
 
-  // 2. 获取 L0 层的迭代器
-  std::vector<SearchItem> item_vec;
-  for (auto &sst_id : engine_->level_sst_ids[0]) {
-    auto sst = engine_->ssts[sst_id];
-    for (auto iter = sst->begin(max_tranc_id_);
-         iter.is_valid() && iter != sst->end(); ++iter) {
-      // 这里越新的sst的idx越大, 我们需要让新的sst优先在堆顶
-      // 让新的sst(拥有更大的idx)排序在前面, 反转符号就行了
-      if (max_tranc_id_ != 0 && iter.get_tranc_id() > max_tranc_id_) {
-        // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
-        continue;
+  // 2. 按层获取 sst 部分的迭代器
+  // 迭代器持有 Version, 不会阻塞 flush 和 compact 替换 sst;
+  // 先读 memtable 再取 Version, 保证刷盘中的数据至少出现在其中一处
+  version_ = engine_->get_current_version();
+  for (auto &[level, level_ssts] : version_->levels) {
+    if (level == 0) {
+      // l0 的 sst 之间有重叠, 需要通过堆合并同一层的所有 sst
+      std::vector<SearchItem> item_vec;
+      for (auto &sst : level_ssts) {
+        size_t sst_id = sst->get_sst_id();
+        for (auto iter = sst->begin(max_tranc_id_, fill_cache);
+             iter.is_valid() && iter != sst->end(); ++iter) {
+          // 这里越新的sst的idx越大, 我们需要让新的sst优先在堆顶
+          // 让新的sst(拥有更大的idx)排序在前面, 反转符号就行了
+          if (max_tranc_id_ != 0 && iter.get_tranc_id() > max_tranc_id_) {
+            // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
+            continue;
+          }
+          item_vec.emplace_back(iter.key(), iter.value(), -sst_id, level,
+                                iter.get_tranc_id());
+        }
       }
-      item_vec.emplace_back(iter.key(), iter.value(), -sst_id, 0,
-                            iter.get_tranc_id());
+      std::shared_ptr<HeapIterator> level_i_iter =
+          std::make_shared<HeapIterator>(item_vec, max_tranc_id);
+      iter_vec.push_back(level_i_iter);
+      continue;
     }
-  }
-  std::shared_ptr<HeapIterator> l0_iter_ptr =
-      std::make_shared<HeapIterator>(item_vec, max_tranc_id);
-  iter_vec.push_back(l0_iter_ptr);
 
-  // 3. 获取其他层的迭代器
-  for (auto &[level, sst_id_list] : engine_->level_sst_ids) {
-    if (level == 0) {
+    if (engine_->is_overlapping_level(level)) {
+      // tiered 模式下其他层由多个 sorted run 组成, 数据量可能很大,
+      // 不能像 l0 一样全部读入内存. 每个 run 内部没有重叠, 用一个
+      // ConcactIterator 按需读取, 与其他迭代器一起在这里逐个 key 合并.
+      // run 从新到旧排列, key 相同时靠前的迭代器优先
+      for (auto &run : LSMEngine::split_sorted_runs(level_ssts)) {
+        iter_vec.push_back(
+            std::make_shared<ConcactIterator>(run, max_tranc_id, fill_cache));
+      }
       continue;
     }
-    std::vector<std::shared_ptr<SST>> ssts;
-    for (auto sst_id : sst_id_list) {
-      auto sst = engine_->ssts[sst_id];
-      ssts.push_back(sst);
-    }
+
     std::shared_ptr<ConcactIterator> level_i_iter =
-      std::make_shared<ConcactIterator>(ssts, max_tranc_id);
+      std::make_shared<ConcactIterator>(level_ssts, max_tranc_id, fill_cache);
     iter_vec.push_back(level_i_iter);
   }
 
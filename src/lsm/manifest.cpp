@@ -0,0 +1,249 @@
+#include "../../include/lsm/manifest.h"
+#include "../../include/utils/crc32c.h"
+#include "../../include/utils/files.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace my_tiny_lsm {
+
+namespace {
+constexpr uint8_t kTagNextSstId = 1;
+constexpr uint8_t kTagAddSst = 2;
+constexpr uint8_t kTagDeleteSst = 3;
+
+const char *kManifestName = "MANIFEST";
+
+template <typename T> void put_value(std::vector<uint8_t> &data, T value) {
+  size_t offset = data.size();
+  data.resize(offset + sizeof(T));
+  memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+void put_key(std::vector<uint8_t> &data, const std::string &key) {
+  if (key.size() > UINT16_MAX) {
+    throw std::runtime_error("Key too long for manifest");
+  }
+  put_value<uint16_t>(data, key.size());
+  data.insert(data.end(), key.begin(), key.end());
+}
+
+// 读取时检查剩余长度, 防止损坏的数据导致越界
+template <typename T> T get_value(const uint8_t *&ptr, const uint8_t *end) {
+  if (static_cast<size_t>(end - ptr) < sizeof(T)) {
+    throw std::runtime_error("Corrupted version edit: truncated");
+  }
+  T value;
+  memcpy(&value, ptr, sizeof(T));
+  ptr += sizeof(T);
+  return value;
+}
+
+std::string get_key(const uint8_t *&ptr, const uint8_t *end) {
+  uint16_t len = get_value<uint16_t>(ptr, end);
+  if (static_cast<size_t>(end - ptr) < len) {
+    throw std::runtime_error("Corrupted version edit: truncated");
+  }
+  std::string key(reinterpret_cast<const char *>(ptr), len);
+  ptr += len;
+  return key;
+}
+
+// rename 之后需要 sync 所在目录, 目录项的修改才会持久化
+void sync_dir(const std::string &dir) {
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open directory: " + dir);
+  }
+  int ret = ::fsync(fd);
+  ::close(fd);
+  if (ret != 0) {
+    throw std::runtime_error("Failed to sync directory: " + dir);
+  }
+}
+} // namespace
+
+void VersionEdit::encode_to(std::vector<uint8_t> &data) const {
+  if (next_sst_id.has_value()) {
+    put_value<uint8_t>(data, kTagNextSstId);
+    put_value<uint64_t>(data, *next_sst_id);
+  }
+  for (const auto &meta : added_ssts) {
+    put_value<uint8_t>(data, kTagAddSst);
+    put_value<uint32_t>(data, meta.level);
+    put_value<uint64_t>(data, meta.sst_id);
+    put_value<uint64_t>(data, meta.file_size);
+    put_value<uint64_t>(data, meta.min_tranc_id);
+    put_value<uint64_t>(data, meta.max_tranc_id);
+    put_key(data, meta.first_key);
+    put_key(data, meta.last_key);
+  }
+  for (auto sst_id : deleted_ssts) {
+    put_value<uint8_t>(data, kTagDeleteSst);
+    put_value<uint64_t>(data, sst_id);
+  }
+}
+
+VersionEdit VersionEdit::decode(const uint8_t *data, size_t size) {
+  VersionEdit edit;
+  const uint8_t *ptr = data;
+  const uint8_t *end = data + size;
+  while (ptr < end) {
+    uint8_t tag = get_value<uint8_t>(ptr, end);
+    switch (tag) {
+    case kTagNextSstId:
+      edit.next_sst_id = get_value<uint64_t>(ptr, end);
+      break;
+    case kTagAddSst: {
+      SSTMeta meta;
+      meta.level = get_value<uint32_t>(ptr, end);
+      meta.sst_id = get_value<uint64_t>(ptr, end);
+      meta.file_size = get_value<uint64_t>(ptr, end);
+      meta.min_tranc_id = get_value<uint64_t>(ptr, end);
+      meta.max_tranc_id = get_value<uint64_t>(ptr, end);
+      meta.first_key = get_key(ptr, end);
+      meta.last_key = get_key(ptr, end);
+      edit.added_ssts.push_back(std::move(meta));
+      break;
+    }
+    case kTagDeleteSst:
+      edit.deleted_ssts.push_back(get_value<uint64_t>(ptr, end));
+      break;
+    default:
+      throw std::runtime_error("Unknown version edit tag: " +
+                               std::to_string(tag));
+    }
+  }
+  return edit;
+}
+
+Manifest::Manifest(const std::string &dir)
+    : dir_(dir), path_(dir + "/" + kManifestName) {
+  if (std::filesystem::exists(path_)) {
+    recover(path_);
+  }
+  write_snapshot();
+}
+
+bool Manifest::exists(const std::string &dir) {
+  return std::filesystem::exists(dir + "/" + kManifestName);
+}
+
+const std::map<size_t, SSTMeta> &Manifest::live_ssts() const {
+  return live_ssts_;
+}
+
+uint64_t Manifest::next_sst_id() const { return next_sst_id_; }
+
+void Manifest::apply(const VersionEdit &edit) {
+  // 同一个 edit 中先删除再新增, compact 的输入和输出不会有相同的 id
+  for (auto sst_id : edit.deleted_ssts) {
+    live_ssts_.erase(sst_id);
+  }
+  for (const auto &meta : edit.added_ssts) {
+    live_ssts_[meta.sst_id] = meta;
+  }
+  if (edit.next_sst_id.has_value()) {
+    next_sst_id_ = std::max(next_sst_id_, *edit.next_sst_id);
+  }
+}
+
+void Manifest::recover(const std::string &path) {
+  auto file = FileObj::open(path, false);
+  if (file.size() < kManifestHeaderSize ||
+      file.read_uint32(0) != kManifestMagic) {
+    throw std::runtime_error("Invalid manifest file: " + path);
+  }
+  uint8_t version = file.read_uint8(sizeof(uint32_t));
+  if (version > kManifestFormatVersion) {
+    throw std::runtime_error("Unsupported manifest format version: " +
+                             std::to_string(version));
+  }
+
+  auto data = file.read_to_slice(kManifestHeaderSize,
+                                 file.size() - kManifestHeaderSize);
+  size_t offset = 0;
+  size_t num_edits = 0;
+  while (offset < data.size()) {
+    // 不完整或校验失败的记录只可能出现在尾部, 丢弃之后的内容
+    if (data.size() - offset < sizeof(uint32_t) * 2) {
+      break;
+    }
+    uint32_t len;
+    memcpy(&len, data.data() + offset, sizeof(uint32_t));
+    if (data.size() - offset - sizeof(uint32_t) * 2 < len) {
+      break;
+    }
+    const uint8_t *payload = data.data() + offset + sizeof(uint32_t);
+    uint32_t checksum;
+    memcpy(&checksum, payload + len, sizeof(uint32_t));
+    if (checksum != crc32c_value(payload, len)) {
+      break;
+    }
+    apply(VersionEdit::decode(payload, len));
+    offset += sizeof(uint32_t) * 2 + len;
+    num_edits++;
+  }
+  if (offset < data.size()) {
+    spdlog::warn("LSMEngine--"
+                 "Manifest: discarded {} bytes of incomplete tail after {} "
+                 "edits",
+                 data.size() - offset, num_edits);
+  }
+}
+
+void Manifest::log_and_apply(const VersionEdit &edit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<uint8_t> record(sizeof(uint32_t));
+  edit.encode_to(record);
+  uint32_t len = record.size() - sizeof(uint32_t);
+  memcpy(record.data(), &len, sizeof(uint32_t));
+  put_value<uint32_t>(record, crc32c_value(record.data() + sizeof(uint32_t),
+                                           len));
+  if (!file_.append(record.data(), record.size()) || !file_.sync()) {
+    throw std::runtime_error("Failed to write manifest: " + path_);
+  }
+  apply(edit);
+
+  if (file_.size() > kManifestRolloverSize) {
+    write_snapshot();
+  }
+}
+
+void Manifest::write_snapshot() {
+  // 快照是只包含一个 VersionEdit 的 manifest, 记录当前全部 sst
+  VersionEdit snapshot;
+  snapshot.next_sst_id = next_sst_id_;
+  for (const auto &[sst_id, meta] : live_ssts_) {
+    snapshot.added_ssts.push_back(meta);
+  }
+
+  std::vector<uint8_t> data;
+  put_value<uint32_t>(data, kManifestMagic);
+  put_value<uint8_t>(data, kManifestFormatVersion);
+  size_t len_offset = data.size();
+  put_value<uint32_t>(data, 0);
+  snapshot.encode_to(data);
+  uint32_t len = data.size() - len_offset - sizeof(uint32_t);
+  memcpy(data.data() + len_offset, &len, sizeof(uint32_t));
+  put_value<uint32_t>(
+      data, crc32c_value(data.data() + len_offset + sizeof(uint32_t), len));
+
+  // 先写临时文件再 rename, 崩溃时要么是旧的 manifest, 要么是完整的快照
+  std::string tmp_path = path_ + ".tmp";
+  {
+    auto tmp_file = AppendFile::open(tmp_path, true);
+    if (!tmp_file.append(data.data(), data.size()) || !tmp_file.sync()) {
+      throw std::runtime_error("Failed to write manifest: " + tmp_path);
+    }
+  }
+  std::filesystem::rename(tmp_path, path_);
+  sync_dir(dir_);
+  file_ = AppendFile::open(path_, false);
+}
+} // namespace my_tiny_lsm
@@ -103,7 +103,7 @@ bool TranContext::commit() {
   std::unique_lock<std::shared_mutex> wlock2(memtable.current_mtx);
   if (isolation_level == Isolationlevel::READ_COMMITTED ||
       isolation_level == Isolationlevel::REPEATABLE_READ) {
-    std::shared_lock<std::shared_mutex> rlock(engine_->ssts_mtx);
+    // engine_->get 读取的是 sst 集合的快照, 不需要持有 ssts_mtx
     for (auto &[k, v] : temp_map_) {
       auto res = memtable.get_(k, 0);
       if (res.is_valid() && res.get_transaction_id() > tranc_id_) {
@@ -226,6 +226,8 @@ void TranManager::add_ready_to_flush_tranc_id(uint64_t tranc_id,
                                               TransactionState state) {
   std::unique_lock lock(mutex_);
   readyToFlushTrancIds_[tranc_id] = state;
+  // 事务已提交或回滚, 不再是活跃事务
+  activeTrans_.erase(tranc_id);
 }
 
 void TranManager::add_flushed_tranc_id(uint64_t tranc_id) {
@@ -262,6 +264,14 @@ uint64_t TranManager::get_checkpoint_tranc_id() {
   // 需保证 size 至少为1
   return *flushedTrancIds_.begin();
 }
+
+uint64_t TranManager::get_oldest_active_tranc_id() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (activeTrans_.empty()) {
+    return nextTransactionId_.load();
+  }
+  return activeTrans_.begin()->first;
+}
 std::shared_ptr<TranContext>
 TranManager::new_tranc(const Isolationlevel &isolation_level) {
 
@@ -295,4 +305,11 @@ bool TranManager::write_to_wal(const std::vector<Record> &records) {
   return true;
 }
 
+WALStats TranManager::get_wal_stats() {
+  if (wal == nullptr) {
+    return WALStats{};
+  }
+  return wal->get_stats();
+}
+
 } // namespace my_tiny_lsm
\ No newline at end of file
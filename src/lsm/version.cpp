@@ -0,0 +1,42 @@
+#include "../../include/lsm/version.h"
+#include <string_view>
+
+namespace my_tiny_lsm {
+
+const std::vector<std::shared_ptr<SST>> &Version::level(size_t level) const {
+  static const std::vector<std::shared_ptr<SST>> kEmptyLevel;
+  auto it = levels.find(level);
+  return it == levels.end() ? kEmptyLevel : it->second;
+}
+
+void Version::build_fence(size_t level) {
+  const auto &level_ssts = this->level(level);
+  std::vector<std::string_view> first_keys;
+  std::vector<std::string_view> last_keys;
+  first_keys.reserve(level_ssts.size());
+  last_keys.reserve(level_ssts.size());
+  for (const auto &sst : level_ssts) {
+    first_keys.push_back(sst->get_first_key());
+    last_keys.push_back(sst->get_last_key());
+  }
+  fences[level] = LevelFence{KeyFence(first_keys), KeyFence(last_keys)};
+}
+
+size_t Version::find_sst(size_t level, const std::string &key) const {
+  const auto &fence = fences.at(level);
+  // sst 之间没有重叠, 第一个尾key >= key 的 sst 是唯一可能包含 key 的 sst
+  size_t idx = fence.last_keys.lower_bound(key);
+  if (idx == fence.last_keys.size() || key < fence.first_keys.key(idx)) {
+    return fence.last_keys.size();
+  }
+  return idx;
+}
+
+size_t Version::num_ssts() const {
+  size_t num = 0;
+  for (const auto &[level, ssts] : levels) {
+    num += ssts.size();
+  }
+  return num;
+}
+} // namespace my_tiny_lsm
@@ -29,24 +29,43 @@ void MemTable::put_(const std::string &key, const std::string &value,
   current_table_->put(key, value, transaction_id);
 }
 
+// 跳表支持多线程并发插入, 写入只需要读锁保证 current_table_ 不被替换,
+// 写锁只在冻结当前表时使用
 void MemTable::put(const std::string &key, const std::string &value,
                    uint64_t transaction_id) {
-  std::unique_lock<std::shared_mutex> lock(current_mtx);
-  put_(key, value, transaction_id);
-  if (current_table_->get_size() >= LSM_PER_MEM_SIZE_LIMIT) {
-    std::unique_lock<std::shared_mutex> freeze_lock(frozen_mtx);
-    frozen_cur_table_();
+  bool need_freeze = false;
+  {
+    std::shared_lock<std::shared_mutex> lock(current_mtx);
+    put_(key, value, transaction_id);
+    need_freeze =
+        current_table_->get_memory_usage() >= LSM_PER_MEM_SIZE_LIMIT;
+  }
+  if (need_freeze) {
+    freeze_cur_table_if_full();
   }
 }
 
 void MemTable::put_batch(
     const std::vector<std::pair<std::string, std::string>> &kv,
     uint64_t transaction_id) {
-  std::unique_lock<std::shared_mutex> lock(current_mtx);
-  for (auto &[key, value] : kv) {
-    put_(key, value, transaction_id);
+  bool need_freeze = false;
+  {
+    std::shared_lock<std::shared_mutex> lock(current_mtx);
+    for (auto &[key, value] : kv) {
+      put_(key, value, transaction_id);
+    }
+    need_freeze =
+        current_table_->get_memory_usage() >= LSM_PER_MEM_SIZE_LIMIT;
   }
-  if (current_table_->get_size() >= LSM_PER_MEM_SIZE_LIMIT) {
+  if (need_freeze) {
+    freeze_cur_table_if_full();
+  }
+}
+
+void MemTable::freeze_cur_table_if_full() {
+  std::unique_lock<std::shared_mutex> lock(current_mtx);
+  // 多个写线程可能同时发现当前表已满, 只有第一个拿到写锁的线程需要冻结
+  if (current_table_->get_memory_usage() >= LSM_PER_MEM_SIZE_LIMIT) {
     std::unique_lock<std::shared_mutex> freeze_lock(frozen_mtx);
     frozen_cur_table_();
   }
@@ -165,23 +184,31 @@ void MemTable::remove_(const std::string &key, uint64_t transaction_id) {
 }
 
 void MemTable::remove(const std::string &key, uint64_t transacton_id) {
-  std::unique_lock<std::shared_mutex> lock(current_mtx);
-  remove_(key, transacton_id);
-  if (current_table_->get_size() >= LSM_PER_MEM_SIZE_LIMIT) {
-    std::unique_lock<std::shared_mutex> freeze_lock(frozen_mtx);
-    frozen_cur_table_();
+  bool need_freeze = false;
+  {
+    std::shared_lock<std::shared_mutex> lock(current_mtx);
+    remove_(key, transacton_id);
+    need_freeze =
+        current_table_->get_memory_usage() >= LSM_PER_MEM_SIZE_LIMIT;
+  }
+  if (need_freeze) {
+    freeze_cur_table_if_full();
   }
 }
 
 void MemTable::remove_batch(const std::vector<std::string> &keys,
                             uint64_t transaction_id) {
-  std::unique_lock<std::shared_mutex> lock(current_mtx);
-  for (auto &key : keys) {
-    remove_(key, transaction_id);
+  bool need_freeze = false;
+  {
+    std::shared_lock<std::shared_mutex> lock(current_mtx);
+    for (auto &key : keys) {
+      remove_(key, transaction_id);
+    }
+    need_freeze =
+        current_table_->get_memory_usage() >= LSM_PER_MEM_SIZE_LIMIT;
   }
-  if (current_table_->get_size() >= LSM_PER_MEM_SIZE_LIMIT) {
-    std::unique_lock<std::shared_mutex> freeze_lock(frozen_mtx);
-    frozen_cur_table_();
+  if (need_freeze) {
+    freeze_cur_table_if_full();
   }
 }
 
@@ -206,9 +233,10 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
   }
   uint64_t max_tranc_id = 0;
   uint64_t min_tranc_id = UINT64_MAX;
+  // 冻结表不再被修改, 构建 sst 时不需要持有锁, 读写可以继续进行
+  // 表在 sst 对读者可见后才由 pop_flushed_table 移除
   std::shared_ptr<Skiplist> table = frozen_tables_.back();
-  frozen_tables_.pop_back();
-  frozen_size_ -= table->get_size();
+  lock.unlock();
   std::vector<std::tuple<std::string, std::string, uint64_t>> data =
       table->flush();
   for (auto &[key, value, tranc_id] : data) {
@@ -224,6 +252,15 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
   return sst;
 }
 
+void MemTable::pop_flushed_table() {
+  std::unique_lock<std::shared_mutex> lock(frozen_mtx);
+  if (frozen_tables_.empty()) {
+    return;
+  }
+  frozen_size_ -= frozen_tables_.back()->get_size();
+  frozen_tables_.pop_back();
+}
+
 void MemTable::frozen_cur_table_() {
   frozen_size_ += current_table_->get_size();
   frozen_tables_.push_front(current_table_);
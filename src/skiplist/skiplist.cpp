@@ -1,5 +1,9 @@
 #include "../../include/skiplist/skiplist.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
@@ -8,9 +12,30 @@
 
 namespace my_tiny_lsm {
 
+SkiplistNode *SkiplistNode::create(Arena &arena, std::string_view key,
+                                   std::string_view value,
+                                   uint64_t transaction_id, int level) {
+  // 节点头 + level 个指针 + key + value 一次性分配
+  size_t node_size = offsetof(SkiplistNode, forward_) +
+                     sizeof(SkiplistNode *) * level + key.size() +
+                     value.size();
+  auto *node = reinterpret_cast<SkiplistNode *>(arena.allocate(node_size));
+  node->transaction_id_ = transaction_id;
+  node->key_size_ = static_cast<uint32_t>(key.size());
+  node->value_size_ = static_cast<uint32_t>(value.size());
+  node->level_ = level;
+  for (int i = 0; i < level; i++) {
+    new (&node->forward_[i]) std::atomic<SkiplistNode *>(nullptr);
+  }
+  char *data = reinterpret_cast<char *>(&node->forward_[level]);
+  std::memcpy(data, key.data(), key.size());
+  std::memcpy(data + key.size(), value.data(), value.size());
+  return node;
+}
+
 BaseIterator &SkiplistIterator::operator++() {
   if (current) {
-    current = current->forward_[0];
+    current = current->next(0);
   }
   return *this;
 }
@@ -30,7 +55,7 @@ SkiplistIterator::value_type SkiplistIterator::operator*() const {
   if (!current) {
     throw std::runtime_error("Dereferencing end iterator");
   }
-  return {current->key_, current->value_};
+  return {std::string(current->key()), std::string(current->value())};
 }
 
 IteratorType SkiplistIterator::type() const {
@@ -38,25 +63,33 @@ IteratorType SkiplistIterator::type() const {
 }
 
 bool SkiplistIterator::is_valid() const {
-  return current && !current->key_.empty();
+  return current && !current->key().empty();
 }
 bool SkiplistIterator::is_end() const { return current == nullptr; }
 
-std::string SkiplistIterator::get_key() const { return current->key_; }
-std::string SkiplistIterator::get_value() const { return current->value_; }
+std::string SkiplistIterator::get_key() const {
+  return std::string(current->key());
+}
+std::string SkiplistIterator::get_value() const {
+  return std::string(current->value());
+}
 uint64_t SkiplistIterator::get_transaction_id() const {
   return current->transaction_id_;
 }
 
-Skiplist::Skiplist(int max_level) : max_level(max_level), current_level(1) {
-  head = std::make_shared<SkiplistNode>("", "", 0, max_level);
-  dis_01 = std::uniform_int_distribution<>(0, 1);
-  dis_level = std::uniform_int_distribution<>(0, (1 << max_level) - 1);
-  gen = std::mt19937(std::random_device()());
-  spdlog::info("Skiplist created with max level {}", max_level);
+Skiplist::Skiplist(int max_level)
+    : arena(std::make_shared<Arena>()),
+      max_level(std::clamp(max_level, 1, kMaxLevel)), current_level(1),
+      size_bytes(0) {
+  head = SkiplistNode::create(*arena, "", "", 0, this->max_level);
+  spdlog::info("Skiplist created with max level {}", this->max_level);
 }
 
 int Skiplist::random_level() {
+  // 多个线程会同时插入, 每个线程使用自己的随机数引擎
+  thread_local std::mt19937 gen(std::random_device{}());
+  thread_local std::uniform_int_distribution<> dis_01(0, 1);
+
   int level = 1;
   // 通过"抛硬币"的方式随机生成层数：
   // - 每次有50%的概率增加一层
@@ -68,188 +101,187 @@ int Skiplist::random_level() {
   return level;
 }
 
-// in skiplist.cpp
-// ... (previous code) ...
-void Skiplist::put(const std::string &key, const std::string &value,
-                   uint64_t transaction_id) {
-
-  std::vector<std::shared_ptr<SkiplistNode>> update(max_level, nullptr);
-  auto current = head;
-
-  // 使用一个临时的、仅用于比较的节点，确保多版本排序正确
-  auto temp_node_for_compare = std::make_shared<SkiplistNode>(key, value, transaction_id, 1);
+SkiplistIterator Skiplist::make_iterator(SkiplistNode *node) const {
+  if (node == nullptr) {
+    return SkiplistIterator{};
+  }
+  return SkiplistIterator(node, arena);
+}
 
-  // 1. 从当前有效最高层开始，查找每一层的前驱节点
-  for (int i = current_level - 1; i >= 0; i--) {
-    while (current->forward_[i] && *current->forward_[i] < *temp_node_for_compare) {
-      current = current->forward_[i];
+void Skiplist::find_splice_for_level(std::string_view key,
+                                     uint64_t transaction_id,
+                                     SkiplistNode *before, int level,
+                                     SkiplistNode **prev,
+                                     SkiplistNode **next) const {
+  while (true) {
+    SkiplistNode *after = before->next(level);
+    if (after == nullptr || !after->less_than(key, transaction_id)) {
+      *prev = before;
+      *next = after;
+      return;
     }
-    update[i] = current;
+    before = after;
   }
+}
 
-  // 2. 生成新节点的随机层高
+void Skiplist::put(const std::string &key, const std::string &value,
+                   uint64_t transaction_id) {
+  // 1. 生成新节点的随机层高, 并在 arena 中创建新节点
   int new_node_level = random_level();
-
-  // 3. 如果新节点的层高超过当前跳表的最大层高，才更新 current_level 和 update 数组
-  if (new_node_level > current_level) {
-    for (int i = current_level; i < new_node_level; i++) {
-      update[i] = head;
+  SkiplistNode *new_node =
+      SkiplistNode::create(*arena, key, value, transaction_id, new_node_level);
+
+  // 2. 如果新节点的层高超过当前跳表的层高，更新 current_level
+  // 其他线程可能同时在提升层高, 只需保证结果不低于新节点的层高
+  int cur_level = current_level.load(std::memory_order_relaxed);
+  while (new_node_level > cur_level) {
+    if (current_level.compare_exchange_weak(cur_level, new_node_level)) {
+      cur_level = new_node_level;
+      break;
     }
-    // 只有在这种情况下才更新 current_level
-    current_level = new_node_level;
   }
 
-  // 4. 创建并链接新节点
-  auto new_node =
-      std::make_shared<SkiplistNode>(key, value, transaction_id, new_node_level);
+  // 3. 从最高层开始，查找每一层的前驱和后继节点
+  // 按 (key 升序, transaction_id 降序) 比较, 确保多版本排序正确
+  // 跳表的层数不会超过 kMaxLevel, 前驱节点数组放在栈上即可
+  std::array<SkiplistNode *, kMaxLevel> prev{};
+  std::array<SkiplistNode *, kMaxLevel> next{};
+  SkiplistNode *before = head;
+  for (int i = cur_level - 1; i >= 0; i--) {
+    find_splice_for_level(key, transaction_id, before, i, &prev[i], &next[i]);
+    before = prev[i];
+  }
 
+  // 4. 自底向上逐层通过 CAS 链接新节点
+  // 第 0 层链接成功后新节点即对读者可见, 上层只是加速查找
   for (int i = 0; i < new_node_level; i++) {
-    // 设置新节点的前向指针
-    new_node->forward_[i] = update[i]->forward_[i];
-    
-    // 更新后继节点的后向指针
-    if (new_node->forward_[i]) {
-      new_node->forward_[i]->set_backward(i, new_node);
+    while (true) {
+      new_node->no_barrier_set_next(i, next[i]);
+      if (prev[i]->cas_next(i, next[i], new_node)) {
+        break;
+      }
+      // 其他线程在 prev 和 next 之间插入了节点, 从 prev 开始重新查找这一层
+      find_splice_for_level(key, transaction_id, prev[i], i, &prev[i],
+                            &next[i]);
     }
-    
-    // 更新前驱节点的前向指针
-    update[i]->forward_[i] = new_node;
-    // 设置新节点的后向指针
-    new_node->set_backward(i, update[i]);
   }
 
   // 5. 更新跳表的总大小
-  size_bytes += key.size() + value.size() + sizeof(uint64_t);
+  size_bytes.fetch_add(key.size() + value.size() + sizeof(uint64_t),
+                       std::memory_order_relaxed);
 }
 
 SkiplistIterator Skiplist::get(const std::string &key, uint64_t transaction_id) {
-  auto current = head;
-  for (int i = current_level - 1; i >= 0; i--) {
-    while (current->forward_[i] && current->forward_[i]->key_ < key) {
-      current = current->forward_[i];
+  SkiplistNode *current = head;
+  for (int i = current_level.load() - 1; i >= 0; i--) {
+    for (SkiplistNode *n = current->next(i); n && n->key() < key;
+         n = current->next(i)) {
+      current = n;
     }
   }
-  current = current->forward_[0];
+  current = current->next(0);
   if (transaction_id == 0) {
-    if (current && current->key_ == key) {
-      // return SkiplistIterator{current};
-      return SkiplistIterator(current);
+    if (current && current->key() == key) {
+      return make_iterator(current);
     }
   } else {
-    while (current && current->key_ == key) {
+    while (current && current->key() == key) {
       if (current->transaction_id_ <= transaction_id) {
-        return SkiplistIterator(current);
+        return make_iterator(current);
       }
       // current transaction_id is greater than the given transaction_id, keep
       // looking
-      current = current->forward_[0];
+      current = current->next(0);
     }
   }
-  return SkiplistIterator{nullptr};
+  return SkiplistIterator{};
 }
 
 // lsm-tree use lazy deletion don't use this function
-// in skiplist.cpp
+// 节点只是从链表中摘除, 其内存随 arena 一起释放
 void Skiplist::remove(const std::string &key) {
-  std::vector<std::shared_ptr<SkiplistNode>> update(max_level, nullptr);
-  auto current = head;
-
-  // 1. 循环删除，确保所有匹配 key 的版本都被处理
-  while (true) {
-    // 每次循环都重新查找前驱节点，因为上一次删除可能改变了结构
-    current = head;
-    
-    // 2. 从当前的有效最高层开始查找 (修正了循环边界)
-    for (int i = current_level - 1; i >= 0; --i) {
-      while (current->forward_[i] && current->forward_[i]->key_ < key) {
-        current = current->forward_[i];
-      }
-      update[i] = current;
-    }
-
-    // 移动到最底层，找到第一个可能匹配的节点
-    auto node_to_delete = current->forward_[0];
-
-    // 如果下一个节点不是我们要找的key，说明所有该key的版本都已删除，退出循环
-    if (!node_to_delete || node_to_delete->key_ != key) {
-      break; 
-    }
-
-    // --- 执行删除操作 ---
-
-    // 3. 更新每一层的 forward 指针，跳过目标节点 (循环更清晰)
-    for (int i = 0; i < node_to_delete->forward_.size(); ++i) {
-      // 确保前驱节点的下一个节点确实是我们要删除的节点
-      if (update[i]->forward_[i] == node_to_delete) {
-        update[i]->forward_[i] = node_to_delete->forward_[i];
-      }
+  std::array<SkiplistNode *, kMaxLevel> update{};
+
+  // 1. 查找每一层中最后一个 key 小于目标 key 的前驱节点
+  SkiplistNode *current = head;
+  for (int i = current_level.load() - 1; i >= 0; --i) {
+    for (SkiplistNode *n = current->next(i); n && n->key() < key;
+         n = current->next(i)) {
+      current = n;
     }
+    update[i] = current;
+  }
 
-    // 更新 backward 指针
-    for (int i = 0; i < node_to_delete->backward_.size(); ++i) {
-      if (node_to_delete->forward_[i]) {
-        node_to_delete->forward_[i]->set_backward(i, update[i]);
+  // 2. 同一个 key 的所有版本是连续的, 逐个摘除
+  SkiplistNode *node_to_delete = current->next(0);
+  while (node_to_delete && node_to_delete->key() == key) {
+    for (int i = 0; i < node_to_delete->level_; ++i) {
+      if (update[i]->next(i) == node_to_delete) {
+        update[i]->set_next(i, node_to_delete->next(i));
       }
     }
-
-    // 4. 正确更新跳表的内存大小
-    size_bytes -= (node_to_delete->key_.size() + node_to_delete->value_.size() + sizeof(uint64_t));
+    size_bytes -= node_to_delete->key_size_ + node_to_delete->value_size_ +
+                  sizeof(uint64_t);
+    node_to_delete = node_to_delete->next(0);
   }
 
-  // 5. 在所有删除操作完成后，统一更新跳表的当前层级
-  while (current_level > 1 && head->forward_[current_level - 1] == nullptr) {
+  // 3. 在所有删除操作完成后，统一更新跳表的当前层级
+  while (current_level > 1 && head->next(current_level - 1) == nullptr) {
     current_level--;
   }
 }
 
 std::vector<std::tuple<std::string, std::string, uint64_t>> Skiplist::flush() {
   std::vector<std::tuple<std::string, std::string, uint64_t>> result;
-  auto node = head->forward_[0];
+  SkiplistNode *node = head->next(0);
   while (node) {
-    result.emplace_back(
-        std::make_tuple(node->key_, node->value_, node->transaction_id_));
-    node = node->forward_[0];
+    result.emplace_back(std::string(node->key()), std::string(node->value()),
+                        node->transaction_id_);
+    node = node->next(0);
   }
   return result;
 }
 
 size_t Skiplist::get_size() { return size_bytes; }
 
+size_t Skiplist::get_memory_usage() const { return arena->memory_usage(); }
+
 void Skiplist::clear() {
-  head = std::make_shared<SkiplistNode>("", "", 0, max_level);
+  // 旧的 arena 在最后一个引用它的迭代器析构后释放
+  arena = std::make_shared<Arena>();
+  head = SkiplistNode::create(*arena, "", "", 0, max_level);
+  current_level = 1;
   size_bytes = 0;
 }
 
-SkiplistIterator Skiplist::begin() {
-  // return SkiplistIterator{head->forward_[0]};
-  return SkiplistIterator(head->forward_[0]);
-}
+SkiplistIterator Skiplist::begin() { return make_iterator(head->next(0)); }
 
-SkiplistIterator Skiplist::end() { return SkiplistIterator{nullptr}; }
+SkiplistIterator Skiplist::end() { return SkiplistIterator{}; }
 
 SkiplistIterator Skiplist::begin_preffix(const std::string &preffix) {
-  auto current = head;
-  for (int i = current_level - 1; i >= 0; i--) {
-    while (current->forward_[i] && current->forward_[i]->key_ < preffix) {
-      current = current->forward_[i];
+  SkiplistNode *current = head;
+  for (int i = current_level.load() - 1; i >= 0; i--) {
+    for (SkiplistNode *n = current->next(i); n && n->key() < preffix;
+         n = current->next(i)) {
+      current = n;
     }
   }
-  current = current->forward_[0];
-  return SkiplistIterator(current);
+  return make_iterator(current->next(0));
 }
 
 SkiplistIterator Skiplist::end_preffix(const std::string &preffix) {
-  auto current = head;
-  for (int i = current_level - 1; i >= 0; i--) {
-    while (current->forward_[i] && current->forward_[i]->key_ < preffix) {
-      current = current->forward_[i];
+  SkiplistNode *current = head;
+  for (int i = current_level.load() - 1; i >= 0; i--) {
+    for (SkiplistNode *n = current->next(i); n && n->key() < preffix;
+         n = current->next(i)) {
+      current = n;
     }
   }
-  current = current->forward_[0];
-  while (current && current->key_.substr(0, preffix.size()) == preffix) {
-    current = current->forward_[0];
+  current = current->next(0);
+  while (current && current->key().substr(0, preffix.size()) == preffix) {
+    current = current->next(0);
   }
-  return SkiplistIterator(current);
+  return make_iterator(current);
 }
 
 // 返回第一个满足谓词的位置和最后一个满足谓词的迭代器
@@ -262,18 +294,19 @@ SkiplistIterator Skiplist::end_preffix(const std::string &preffix) {
 std::optional<std::pair<SkiplistIterator, SkiplistIterator>>
 Skiplist::iters_monotony_predicate(
     std::function<int(const std::string &)> predicate) {
-  
-  auto current = head;
 
-  // 1. 粗略定位：从高层向低层快速逼近目标区域的某个节点
-  for (int i = current_level - 1; i >= 0; i--) {
+  SkiplistNode *current = head;
+
+  // 1. 从高层向低层定位最后一个需要向右移动 (>0) 的节点
+  // 谓词是单调的, 它在第 0 层的后继就是第一个满足谓词的节点,
+  // 因此不需要反向指针再向前回退
+  for (int i = current_level.load() - 1; i >= 0; i--) {
     while (true) {
-      auto forward = current->forward_[i];
+      SkiplistNode *forward = current->next(i);
       if (!forward) {
         break; // 到达本层末尾，下降一层
       }
-      int direction = predicate(forward->key_);
-      if (direction > 0) {
+      if (predicate(std::string(forward->key())) > 0) {
         // key太小，需要向右移动
         current = forward;
       } else {
@@ -283,137 +316,42 @@ Skiplist::iters_monotony_predicate(
     }
   }
 
-  // 它的下一个节点 current->forward_[0] 是第一个可能满足条件的节点
-  current = current->forward_[0];
+  SkiplistNode *begin_node = current->next(0);
 
   // 如果下一个节点不存在，或者它的 key 不满足条件，则说明没有匹配项
-  if (!current || predicate(current->key_) != 0) {
+  if (!begin_node || predicate(std::string(begin_node->key())) != 0) {
     return std::nullopt;
   }
-  
-  // 2. 精确查找范围的起始点 (begin_it)
-  // 我们需要从 current 出发，向后查找第一个满足条件的节点
-  auto begin_node = current;
-  for (int i = current_level - 1; i >= 0; i--) {
-    while (true) {
-      auto backward = begin_node->backward_[i].lock();
-      // 停止条件是前一个节点不存在、是头节点、或不满足谓词
-      if (!backward || backward == head || predicate(backward->key_) != 0) {
-        break;
-      }
-      // 否则，继续后退
-      begin_node = backward;
-    }
-  }
-  SkiplistIterator begin_it(begin_node);
 
-  // 3. 精确查找范围的结束点 (end_it)
-  // 从找到的第一个满足条件的节点 begin_node 开始，向前查找最后一个满足条件的节点
-  auto end_node = begin_node;
-  for (int i = current_level - 1; i >= 0; i--) {
+  // 2. 从 begin_node 开始，向前查找最后一个满足条件的节点
+  SkiplistNode *end_node = begin_node;
+  for (int i = current_level.load() - 1; i >= 0; i--) {
+    if (i >= end_node->level_) {
+      continue;
+    }
     while (true) {
-      auto forward = end_node->forward_[i];
+      SkiplistNode *forward = end_node->next(i);
       // 停止条件是后一个节点不存在，或者不满足谓词
-      if (!forward || predicate(forward->key_) != 0) {
+      if (!forward || predicate(std::string(forward->key())) != 0) {
         break;
       }
       // 否则，继续前进
       end_node = forward;
     }
   }
-  
-  // end_it 应该是最后一个满足条件的节点的下一个节点
-  SkiplistIterator end_it(end_node->forward_[0]);
 
+  // end_it 应该是最后一个满足条件的节点的下一个节点
   return std::make_optional<std::pair<SkiplistIterator, SkiplistIterator>>(
-      begin_it, end_it);
+      make_iterator(begin_node), make_iterator(end_node->next(0)));
 }
-// std::optional<std::pair<SkiplistIterator, SkiplistIterator>>
-// Skiplist::iters_monotony_predicate(
-//     std::function<int(const std::string &)> predicate) {
-  
-//   auto current = head;
-//   spdlog::trace("Predicate search: Starting coarse search.");
-//   // 1. 粗略定位：从高层向低层快速逼近目标区域的某个节点
-//   for (int i = current_level - 1; i >= 0; i--) {
-//     while (true) {
-//       auto forward = current->forward_[i];
-//       if (!forward) {
-//         break; // 到达本层末尾，下降一层
-//       }
-//       int direction = predicate(forward->key_);
-//       if (direction > 0) {
-//         // key太小，需要向右移动
-//         current = forward;
-//       } else {
-//         // key满足条件(==0)或太大(<0)，不再向右移动，下降一层
-//         break;
-//       }
-//     }
-//   }
-//   spdlog::trace("Predicate search: Coarse search completed.");
-//   // 它的下一个节点 current->forward_[0] 是第一个可能满足条件的节点
-//   current = current->forward_[0];
-
-//   // 如果下一个节点不存在，或者它的 key 不满足条件，则说明没有匹配项
-//   if (!current || predicate(current->key_) != 0) {
-//     spdlog::trace("Predicate search: Coarse search found no matching node.");
-//     return std::nullopt;
-//   }
-  
-//   spdlog::trace("Predicate search: Coarse search found a candidate node with key '{}'", current->key_);
-
-//   // 2. 精确查找范围的起始点 (begin_it)
-//   // 我们需要从 current 出发，向后查找第一个满足条件的节点
-//   auto begin_node = current;
-//   for (int i = current_level - 1; i >= 0; i--) {
-//     while (true) {
-//       auto backward = begin_node->backward_[i].lock();
-//       // 【修正一】: 停止条件是前一个节点不满足谓词 (predicate != 0)
-//       if (!backward || backward == head || predicate(backward->key_) != 0) {
-//         break;
-//       }
-//       // 否则，继续后退
-//       begin_node = backward;
-//     }
-//   }
-//   SkiplistIterator begin_it(begin_node);
-//   spdlog::trace("Predicate search: Found final begin_node with key '{}'", begin_it.get_key());
-
-//   // 3. 精确查找范围的结束点 (end_it)
-//   // 从找到的第一个满足条件的节点 begin_node 开始，向前查找最后一个满足条件的节点
-//   auto end_node = begin_node;
-//   for (int i = current_level - 1; i >= 0; i--) {
-//     while (true) {
-//       auto forward = end_node->forward_[i];
-//       if (!forward || predicate(forward->key_) != 0) {
-//         break;
-//       }
-//       // 否则，继续前进
-//       end_node = forward;
-//     }
-//   }
-  
-//   // end_it 应该是最后一个满足条件的节点的下一个节点
-//   SkiplistIterator end_it(end_node->forward_[0]);
-//   if (!end_it.is_end()) {
-//     spdlog::trace("Predicate search: Found final end_node with key '{}', end_iterator points to '{}'", end_node->key_, end_it.get_key());
-//   } else {
-//     spdlog::trace("Predicate search: Found final end_node with key '{}', end_iterator points to end()", end_node->key_);
-//   }
-
-
-//   return std::make_optional<std::pair<SkiplistIterator, SkiplistIterator>>(
-//       begin_it, end_it);
-// }
 
 void Skiplist::print_skiplist() {
   for (int i = 0; i < max_level; i++) {
     std::cout << "level " << i << ": ";
-    auto current = head->forward_[i];
+    SkiplistNode *current = head->next(i);
     while (current) {
-      std::cout << current->key_ << " ";
-      current = current->forward_[i];
+      std::cout << current->key() << " ";
+      current = current->next(i);
       if (current) {
         std::cout << "-> ";
       }
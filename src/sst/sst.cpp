@@ -7,81 +7,263 @@
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 
 namespace my_tiny_lsm {
 std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
-                               std::shared_ptr<BlockCache> block_cache) {
+                               std::shared_ptr<BlockCache> block_cache,
+                               size_t level) {
   auto sst = std::make_shared<SST>();
   sst->sst_id = sst_id;
+  sst->level = level;
   sst->file = std::move(file);
   sst->block_cache = block_cache;
+  sst->load();
+  return sst;
+}
+
+std::shared_ptr<SST> SST::open_lazy(const SSTMeta &meta,
+                                    const std::string &path,
+                                    FileReadMode read_mode,
+                                    std::shared_ptr<BlockCache> block_cache) {
+  auto sst = std::make_shared<SST>();
+  sst->sst_id = meta.sst_id;
+  sst->level = meta.level;
+  sst->file_size = meta.file_size;
+  sst->min_tranc_id = meta.min_tranc_id;
+  sst->max_tranc_id = meta.max_tranc_id;
+  sst->first_key = meta.first_key;
+  sst->last_key = meta.last_key;
+  sst->path = path;
+  sst->read_mode = read_mode;
+  sst->lazy = true;
+  sst->block_cache = block_cache;
+  return sst;
+}
 
-  size_t file_size = sst->file.size();
+void SST::ensure_loaded() {
+  if (!lazy) {
+    return;
+  }
+  std::call_once(load_flag, [this]() {
+    file = FileObj::open_read_only(path, read_mode);
+    load();
+  });
+}
+
+void SST::load() {
+  size_t actual_size = file.size();
+  if (lazy) {
+    // lazy 的 sst 已经发布给读者, sst_size() 会并发读取 file_size,
+    // 这里只校验, 不写入
+    if (actual_size != file_size) {
+      throw std::runtime_error("SST file size mismatch with manifest: " + path);
+    }
+  } else {
+    file_size = actual_size;
+  }
   // 读取文件末尾的元数据块
-  if (file_size < sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2) {
+  if (actual_size < kSstFooterV0Size) {
     throw std::runtime_error("Invalid SST file: too small");
   }
 
-  // 0. 读取最大和最小的事务id
-  auto max_tranc_id =
-      sst->file.read_to_slice(file_size - sizeof(uint64_t), sizeof(uint64_t));
-  memcpy(&sst->max_tranc_id, max_tranc_id.data(), sizeof(uint64_t));
+  // 0. 一次读出尾部可能占用的所有字节, 避免逐个字段读取文件
+  size_t tail_size = std::min(actual_size, kSstFooterV0Size +
+                                           kSstFooterPrefixExtSize +
+                                           kSstFooterExtSize);
+  auto tail = file.read_to_slice(actual_size - tail_size, tail_size);
+  auto tail_field = [&](size_t footer_offset, void *out, size_t len) {
+    // footer_offset 为字段在文件中的位置
+    memcpy(out, tail.data() + footer_offset - (actual_size - tail_size), len);
+  };
+
+  // 1. 识别尾部格式, v0 之后的扩展部分记录了版本和过滤器类型
+  size_t footer_end = actual_size;
+  uint32_t prefix_region_offset = 0;
+  uint32_t magic = 0;
+  if (actual_size >= kSstFooterV0Size + kSstFooterExtSize) {
+    tail_field(actual_size - sizeof(uint32_t), &magic, sizeof(uint32_t));
+  }
+  if (magic == kSstMagic) {
+    size_t ext_offset = actual_size - kSstFooterExtSize;
+    tail_field(ext_offset, &filter_type, sizeof(uint8_t));
+    tail_field(ext_offset + sizeof(uint8_t), &format_version, sizeof(uint8_t));
+    if (format_version > kSstFormatVersion) {
+      throw std::runtime_error("Unsupported SST format version: " +
+                               std::to_string(format_version));
+    }
+    footer_end = ext_offset;
+    if (format_version >= 2) {
+      footer_end -= kSstFooterPrefixExtSize;
+      tail_field(footer_end, &prefix_region_offset, sizeof(uint32_t));
+      tail_field(footer_end + sizeof(uint32_t), &prefix_filter_type,
+                 sizeof(uint8_t));
+    }
+  }
+  size_t footer_v0_offset = footer_end - kSstFooterV0Size;
+  if (format_version < 2) {
+    prefix_region_offset = footer_v0_offset;
+  }
+
+  // 2. 读取元数据块和布隆过滤器的偏移量, 以及最小和最大的事务id
+  tail_field(footer_v0_offset, &meta_block_offset, sizeof(uint32_t));
+  tail_field(footer_v0_offset + sizeof(uint32_t), &bloom_offset,
+             sizeof(uint32_t));
+  if (!lazy) {
+    // lazy 的 sst 使用 manifest 中的事务id, 加载时可能已有读者在访问
+    tail_field(footer_v0_offset + sizeof(uint32_t) * 2, &min_tranc_id,
+               sizeof(uint64_t));
+    tail_field(footer_end - sizeof(uint64_t), &max_tranc_id, sizeof(uint64_t));
+  }
+  if (meta_block_offset > bloom_offset || bloom_offset > prefix_region_offset ||
+      prefix_region_offset > footer_v0_offset) {
+    throw std::runtime_error("Invalid SST footer");
+  }
+
+  // 3. 读取前缀提取方式, 前缀过滤器在使用时才加载
+  if (prefix_region_offset < footer_v0_offset) {
+    uint16_t name_len = file.read_uint16(prefix_region_offset);
+    size_t name_offset = prefix_region_offset + sizeof(uint16_t);
+    auto name_bytes = file.read_to_slice(name_offset, name_len);
+    prefix_extractor_name.assign(name_bytes.begin(), name_bytes.end());
+    prefix_filter_offset = name_offset + name_len;
+    prefix_filter_size = footer_v0_offset - prefix_filter_offset;
+  }
+
+  // 4. 读取顶层索引
+  uint32_t meta_size = bloom_offset - meta_block_offset;
+  auto meta_bytes = file.read_to_slice(meta_block_offset, meta_size);
+  if (format_version >= 6) {
+    index_partitions = IndexPartition::decode_from_slice(meta_bytes);
+  } else {
+    // 旧格式的元数据块常驻内存, 布隆过滤器作为唯一的 filter 分区
+    pinned_index = std::make_shared<std::vector<BlockMeta>>(
+        BlockMeta::decode_meta_from_slice(meta_bytes, format_version >= 5));
+    if (!pinned_index->empty()) {
+      IndexPartition partition;
+      partition.num_blocks = pinned_index->size();
+      partition.blocks_end = meta_block_offset;
+      partition.filter_offset = bloom_offset;
+      partition.filter_size = prefix_region_offset - bloom_offset;
+      partition.first_key = pinned_index->front().first_key;
+      partition.last_key = pinned_index->back().last_key;
+      index_partitions.push_back(std::move(partition));
+    }
+  }
+
+  // 5. 设置首尾key, lazy 的 sst 已由 manifest 给出
+  if (!index_partitions.empty()) {
+    const auto &last_partition = index_partitions.back();
+    block_count = last_partition.first_block + last_partition.num_blocks;
+    if (!lazy) {
+      first_key = index_partitions.front().first_key;
+      last_key = last_partition.last_key;
+    }
+  }
+}
 
-  auto min_tranc_id = sst->file.read_to_slice(file_size - sizeof(uint64_t) * 2,
-                                              sizeof(uint64_t));
-  memcpy(&sst->min_tranc_id, min_tranc_id.data(), sizeof(uint64_t));
+void SST::del_sst() {
+  ensure_loaded();
+  file.del_file();
+}
 
-  // 1. 读取元数据块的偏移量, 最后8字节: 2个 uint32_t,
-  // 分别是 meta 和 bloom 的 offset
+void SST::advise(FileAccessHint hint) {
+  ensure_loaded();
+  file.advise(hint);
+}
 
-  auto bloom_offset_bytes = sst->file.read_to_slice(
-      file_size - sizeof(uint64_t) * 2 - sizeof(uint32_t), sizeof(uint32_t));
-  memcpy(&sst->bloom_offset, bloom_offset_bytes.data(), sizeof(uint32_t));
+int SST::index_partition_cache_id(size_t partition) {
+  return -2 - static_cast<int>(partition) * 2;
+}
 
-  auto meta_offset_bytes = sst->file.read_to_slice(
-      file_size - sizeof(uint64_t) * 2 - sizeof(uint32_t) * 2,
-      sizeof(uint32_t));
-  memcpy(&sst->meta_block_offset, meta_offset_bytes.data(), sizeof(uint32_t));
+int SST::filter_partition_cache_id(size_t partition) {
+  return -3 - static_cast<int>(partition) * 2;
+}
 
-  // 2. 读取 bloom filter
-  if (sst->bloom_offset + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) <
-      file_size) {
-    // 布隆过滤器偏移量 + 2*uint32_t 的大小小于文件大小
-    // 表示存在布隆过滤器
-    uint32_t bloom_size = file_size - sizeof(uint64_t) * 2 - sst->bloom_offset -
-                          sizeof(uint32_t) * 2;
-    auto bloom_bytes = sst->file.read_to_slice(sst->bloom_offset, bloom_size);
+size_t SST::find_partition(const std::string &key) const {
+  auto it = std::lower_bound(
+      index_partitions.begin(), index_partitions.end(), key,
+      [](const IndexPartition &p, const std::string &k) {
+        return p.last_key < k;
+      });
+  return it - index_partitions.begin();
+}
 
-    auto bloom = BloomFilter::decode(bloom_bytes);
-    sst->bloom_filter = std::make_shared<BloomFilter>(std::move(bloom));
+size_t SST::partition_of_block(size_t block_idx) const {
+  auto it = std::upper_bound(
+      index_partitions.begin(), index_partitions.end(), block_idx,
+      [](size_t idx, const IndexPartition &p) { return idx < p.first_block; });
+  return it - index_partitions.begin() - 1;
+}
+
+std::shared_ptr<std::vector<BlockMeta>>
+SST::load_index_partition(size_t partition, bool fill_cache) {
+  if (pinned_index != nullptr) {
+    return pinned_index;
+  }
+  int cache_id = index_partition_cache_id(partition);
+  if (block_cache != nullptr) {
+    auto cached = block_cache->get_entry(sst_id, cache_id, level);
+    if (cached != nullptr) {
+      return std::static_pointer_cast<std::vector<BlockMeta>>(cached);
+    }
   }
 
-  // 3. 读取并解码元数据块
-  uint32_t meta_size = sst->bloom_offset - sst->meta_block_offset;
-  auto meta_bytes = sst->file.read_to_slice(sst->meta_block_offset, meta_size);
-  sst->meta_entries = BlockMeta::decode_meta_from_slice(meta_bytes);
+  const auto &p = index_partitions[partition];
+  auto bytes = file.read_to_slice(p.index_offset, p.index_size);
+  auto metas = std::make_shared<std::vector<BlockMeta>>(
+      BlockMeta::decode_meta_from_slice(bytes));
+  if (metas->size() != p.num_blocks) {
+    throw std::runtime_error("Index partition block count mismatch");
+  }
+  if (block_cache != nullptr && fill_cache) {
+    // 按编码大小加上每个 BlockMeta 对象本身计费
+    size_t charge = p.index_size + metas->size() * sizeof(BlockMeta);
+    block_cache->put_entry(sst_id, cache_id, metas, charge);
+  }
+  return metas;
+}
 
-  // 4. 设置首尾key
-  if (!sst->meta_entries.empty()) {
-    sst->first_key = sst->meta_entries.front().first_key;
-    sst->last_key = sst->meta_entries.back().last_key;
+std::shared_ptr<Filter> SST::load_filter(int cache_id, FilterType type,
+                                         uint32_t offset, uint32_t size) {
+  if (block_cache != nullptr) {
+    auto cached = block_cache->get_entry(sst_id, cache_id, level);
+    if (cached != nullptr) {
+      return std::static_pointer_cast<Filter>(cached);
+    }
   }
+  auto filter = Filter::decode(type, file.read_to_slice(offset, size));
+  if (block_cache != nullptr) {
+    block_cache->put_entry(sst_id, cache_id, filter, size);
+  }
+  return filter;
+}
 
-  return sst;
+uint64_t SST::filter_hash(const std::string &key) const {
+  return format_version >= 7 ? Filter::hash_key(key)
+                             : Filter::legacy_hash_key(key);
 }
 
-void SST::del_sst() { file.del_file(); }
+std::shared_ptr<Filter> SST::load_filter_partition(size_t partition) {
+  const auto &p = index_partitions[partition];
+  if (p.filter_size == 0) {
+    return nullptr;
+  }
+  return load_filter(filter_partition_cache_id(partition), filter_type,
+                     p.filter_offset, p.filter_size);
+}
 
-std::shared_ptr<Block> SST::read_block(size_t block_idx) {
-  if (block_idx >= meta_entries.size()) {
+std::shared_ptr<Block> SST::read_block(size_t block_idx, bool fill_cache) {
+  ensure_loaded();
+  if (block_idx >= block_count) {
     throw std::out_of_range("Block index out of range");
   }
 
-  // 先从缓存中查找
+  // 先从缓存中查找, 命中时不需要访问 index 分区
   if (block_cache != nullptr) {
-    auto cache_ptr = block_cache->get(this->sst_id, block_idx);
+    auto cache_ptr = block_cache->get(this->sst_id, block_idx, level);
     if (cache_ptr != nullptr) {
       return cache_ptr;
     }
@@ -89,57 +271,116 @@ std::shared_ptr<Block> SST::read_block(size_t block_idx) {
     throw std::runtime_error("Block cache not set");
   }
 
-  const auto &meta = meta_entries[block_idx];
-  size_t block_size;
+  // 计算block的位置和大小
+  size_t partition = partition_of_block(block_idx);
+  const auto &p = index_partitions[partition];
+  auto metas = load_index_partition(partition, fill_cache);
+  size_t local_idx = block_idx - p.first_block;
+  size_t block_offset = (*metas)[local_idx].offset;
+  size_t block_end = local_idx + 1 < metas->size()
+                         ? (*metas)[local_idx + 1].offset
+                         : p.blocks_end;
+  if (block_end < block_offset) {
+    throw std::runtime_error("Invalid block offset");
+  }
+  size_t block_size = block_end - block_offset;
 
-  // 计算block大小
-  if (block_idx == meta_entries.size() - 1) {
-    block_size = meta_block_offset - meta.offset;
+  // v4 起每个 block 末尾有 1 字节的压缩类型
+  bool has_compression_type = format_version >= 4;
+  if (has_compression_type && block_size == 0) {
+    throw std::runtime_error("Invalid block size");
+  }
+  size_t payload_size = has_compression_type ? block_size - 1 : block_size;
+  auto compression = CompressionType::None;
+
+  // 缓存中保存的总是解压后的 block
+  std::shared_ptr<Block> block_res;
+  if (auto view = file.mmap_view(); view != nullptr) {
+    if (block_end > file.size()) {
+      throw std::out_of_range("Read beyond file size");
+    }
+    const uint8_t *block_ptr = view + block_offset;
+    if (has_compression_type) {
+      compression = static_cast<CompressionType>(block_ptr[payload_size]);
+    }
+    if (compression == CompressionType::None) {
+      // mmap 方式打开时, block 直接引用映射区域, 不再拷贝数据
+      block_res = Block::decode_view(block_ptr, payload_size, true,
+                                     file.mmap_owner());
+    } else {
+      block_res = Block::decode(
+          decompress_block(compression, block_ptr, payload_size), true);
+    }
   } else {
-    block_size = meta_entries[block_idx + 1].offset - meta.offset;
+    // 读取block数据
+    auto block_data = file.read_to_slice(block_offset, block_size);
+    if (has_compression_type) {
+      compression = static_cast<CompressionType>(block_data.back());
+      block_data.pop_back();
+    }
+    if (compression == CompressionType::None) {
+      block_res = Block::decode(block_data, true);
+    } else {
+      block_res = Block::decode(
+          decompress_block(compression, block_data.data(), block_data.size()),
+          true);
+    }
   }
 
-  // 读取block数据
-  auto block_data = file.read_to_slice(meta.offset, block_size);
-  auto block_res = Block::decode(block_data, true);
-
   // 更新缓存
-  if (block_cache != nullptr) {
+  if (fill_cache) {
     block_cache->put(this->sst_id, block_idx, block_res);
-  } else {
-    throw std::runtime_error("Block cache not set");
   }
   return block_res;
 }
 
+bool SST::may_contain_prefix(const std::string &prefix,
+                             const PrefixExtractor &extractor) {
+  ensure_loaded();
+  if (prefix_filter_size == 0 || prefix_extractor_name != extractor.name()) {
+    return true;
+  }
+  auto filter = load_filter(kPrefixFilterCacheId, prefix_filter_type,
+                            prefix_filter_offset, prefix_filter_size);
+  return filter->possibly_contains_hash(filter_hash(prefix));
+}
+
 size_t SST::find_block_idx(const std::string &key) {
-  // 先在布隆过滤器判断key是否存在
-  if (bloom_filter != nullptr && !bloom_filter->possibly_contains(key)) {
+  ensure_loaded();
+  // 先在 key 所在分区的过滤器判断key是否存在
+  size_t partition = find_partition(key);
+  if (partition == index_partitions.size()) {
+    // 如果没有找到完全匹配的块，返回-1
+    return -1;
+  }
+  const auto &p = index_partitions[partition];
+  if (key < p.first_key) {
+    // key 落在两个分区之间, 不可能存在
+    return -1;
+  }
+  auto filter = load_filter_partition(partition);
+  if (filter != nullptr && !filter->possibly_contains_hash(filter_hash(key))) {
     return -1;
   }
 
-  // 二分查找
+  // 在分区内二分查找, 分区的 last_key >= key, 一定能找到
+  auto metas = load_index_partition(partition);
   size_t left = 0;
-  size_t right = meta_entries.size();
+  size_t right = metas->size();
 
   while (left < right) {
     size_t mid = (left + right) / 2;
-    const auto &meta = meta_entries[mid];
+    const auto &meta = (*metas)[mid];
 
     if (key < meta.first_key) {
       right = mid;
     } else if (key > meta.last_key) {
       left = mid + 1;
     } else {
-      return mid;
+      return p.first_block + mid;
     }
   }
-
-  if (left >= meta_entries.size()) {
-    // 如果没有找到完全匹配的块，返回-1
-    return -1;
-  }
-  return left;
+  return p.first_block + left;
 }
 
 SSTableIterator SST::get(const std::string &key, uint64_t tranc_id) {
@@ -147,30 +388,48 @@ SSTableIterator SST::get(const std::string &key, uint64_t tranc_id) {
     return this->end();
   }
 
-  // 在布隆过滤器判断key是否存在
-  if (bloom_filter != nullptr && !bloom_filter->possibly_contains(key)) {
-    return this->end();
-  }
-
+  // seek 时 find_block_idx 会先查询 key 所在分区的过滤器, 不存在时返回 end
   return SSTableIterator(shared_from_this(), key, tranc_id);
 }
-size_t SST::num_blocks() const { return meta_entries.size(); }
+size_t SST::num_blocks() {
+  ensure_loaded();
+  return block_count;
+}
 
-std::string SST::get_first_key() const { return first_key; }
+const std::string &SST::get_first_key() const { return first_key; }
 
-std::string SST::get_last_key() const { return last_key; }
+const std::string &SST::get_last_key() const { return last_key; }
 
-size_t SST::sst_size() const { return file.size(); }
+size_t SST::sst_size() const { return file_size; }
 
 size_t SST::get_sst_id() const { return sst_id; }
 
-SSTableIterator SST::begin(uint64_t tranc_id) {
-  return SSTableIterator(shared_from_this(), tranc_id);
+size_t SST::get_level() const { return level; }
+
+size_t SST::memory_usage() const {
+  size_t usage = sizeof(SST) + first_key.capacity() + last_key.capacity() +
+                 prefix_extractor_name.capacity() + path.capacity();
+  for (const auto &p : index_partitions) {
+    usage += p.memory_usage();
+  }
+  if (pinned_index != nullptr) {
+    for (const auto &meta : *pinned_index) {
+      usage += sizeof(BlockMeta) + meta.first_key.capacity() +
+               meta.last_key.capacity();
+    }
+  }
+  return usage;
+}
+
+SSTableIterator SST::begin(uint64_t tranc_id, bool fill_cache) {
+  ensure_loaded();
+  return SSTableIterator(shared_from_this(), tranc_id, fill_cache);
 }
 
 SSTableIterator SST::end() {
+  ensure_loaded();
   SSTableIterator res(shared_from_this(), 0);
-  res.m_block_idx = meta_entries.size();
+  res.m_block_idx = block_count;
   res.m_block_it = nullptr;
   return res;
 }
@@ -179,12 +438,26 @@ std::pair<uint64_t, uint64_t> SST::get_tranc_id_range() const {
   return std::make_pair(min_tranc_id, max_tranc_id);
 }
 
-SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom) : block(block_size) {
+SSTMeta SST::get_meta() const {
+  SSTMeta meta;
+  meta.sst_id = sst_id;
+  meta.level = level;
+  meta.file_size = file_size;
+  meta.min_tranc_id = min_tranc_id;
+  meta.max_tranc_id = max_tranc_id;
+  meta.first_key = first_key;
+  meta.last_key = last_key;
+  return meta;
+}
+
+SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom)
+    : block(block_size,
+            TomlConfig::getInstance().getLsmBlockRestartInterval()),
+      block_size(block_size), has_bloom(has_bloom),
+      min_tranc_id(std::numeric_limits<uint64_t>::max()), max_tranc_id(0) {
   if (has_bloom) {
-    bloom_filter =
-        std::make_shared<BloomFilter>(10000, 0.1); // 默认预期10个元素，误判率10%
-  } else {
-    bloom_filter = nullptr;
+    prefix_extractor = PrefixExtractor::from_string(
+        TomlConfig::getInstance().getBloomFilterPrefixExtractor());
   }
   meta_entries.clear();
   data.clear();
@@ -197,100 +470,205 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
   if (first_key.empty()) {
     first_key = key;
   }
-  if (bloom_filter != nullptr) {
-    bloom_filter->add(key);
-  }
   max_tranc_id = std::max(max_tranc_id, tranc_id);
   min_tranc_id = std::min(min_tranc_id, tranc_id);
 
   bool force_write = key == last_key;
-
-  if (block.add_entry(key, value, tranc_id, force_write)) {
-    last_key = key;
-    return;
+  if (prefix_extractor != nullptr && prefix_extractor->in_domain(key)) {
+    auto prefix = prefix_extractor->transform(key);
+    if (prefix_hashes.empty() || prefix != last_prefix) {
+      prefix_hashes.push_back(Filter::hash_key(prefix));
+      last_prefix = std::move(prefix);
+    }
   }
 
-  finish_block();
-  block.add_entry(key, value, tranc_id, false);
-  first_key = key;
+  if (!block.add_entry(key, value, tranc_id, force_write)) {
+    finish_block();
+    block.add_entry(key, value, tranc_id, false);
+    first_key = key;
+  }
   last_key = key;
+
+  // key 按序添加, 同一个 key 的多个版本只记录一次;
+  // 在确定 key 所在的 block 之后记录, 每个 block 的哈希值是连续的一段
+  if (has_bloom && (key_hashes.empty() || !force_write)) {
+    key_hashes.push_back(Filter::hash_key(key));
+  }
+}
+size_t SSTBuilder::estimated_size() const {
+  // 还包括尚未写入 data 的当前 block
+  return data.size() + (block.is_empty() ? 0 : block.cur_size());
 }
-size_t SSTBuilder::estimated_size() const { return data.size(); }
 void SSTBuilder::finish_block() {
   auto old_block = std::move(block);
   auto encoded_block = old_block.encode();
   meta_entries.emplace_back(data.size(), old_block.get_first_key(), last_key);
+  block_hash_ends.push_back(key_hashes.size());
   data.reserve(data.size() + encoded_block.size());
   data.insert(data.end(), encoded_block.begin(), encoded_block.end());
 }
 
 std::shared_ptr<SST> SSTBuilder::build(size_t sst_id, const std::string &path,
-                                       std::shared_ptr<BlockCache> block_cache) {
+                                       std::shared_ptr<BlockCache> block_cache,
+                                       size_t level) {
   if (!block.is_empty()) {
     finish_block();
   }
   if (meta_entries.empty()) {
     throw std::runtime_error("Cannot build an empty SST");
   }
-  // 编码元数据块
-  std::vector<uint8_t> meta_block;
-  BlockMeta::encode_meta_to_slice(meta_entries, meta_block);
-
-  // 计算元数据块的偏移量
-  uint32_t meta_offset = data.size();
+  const auto &config = TomlConfig::getInstance();
 
   // 构建完整的文件内容
-  // 1. 已有的数据块
-  std::vector<uint8_t> file_content = std::move(data);
+  // 1. 按该层的压缩方式写入数据块, 每个 block 之后追加压缩类型,
+  //    压缩没有收益的 block 保持原样
+  auto compression =
+      compression_type_from_string(config.getLsmBlockCompression(level));
+  std::vector<uint8_t> file_content;
+  file_content.reserve(data.size() + meta_entries.size());
+  for (size_t i = 0; i < meta_entries.size(); ++i) {
+    size_t begin = meta_entries[i].offset;
+    size_t end = i + 1 < meta_entries.size() ? meta_entries[i + 1].offset
+                                             : data.size();
+    meta_entries[i].offset = file_content.size();
+    auto compressed =
+        compress_block(compression, data.data() + begin, end - begin);
+    if (compressed.empty()) {
+      file_content.insert(file_content.end(), data.begin() + begin,
+                          data.begin() + end);
+      file_content.push_back(static_cast<uint8_t>(CompressionType::None));
+    } else {
+      file_content.insert(file_content.end(), compressed.begin(),
+                          compressed.end());
+      file_content.push_back(static_cast<uint8_t>(compression));
+    }
+  }
+  data.clear();
 
-  // 2. 添加元数据块
-  file_content.insert(file_content.end(), meta_block.begin(), meta_block.end());
+  // 2. 按大小切分 index 分区, 每个 index 分区之后写入对应的 filter 分区
+  auto filter_type = filter_type_from_string(config.getBloomFilterType(level));
+  double bits_per_key = config.getBloomFilterBitsPerKey(level);
+  size_t partition_size = config.getLsmIndexPartitionSize();
+  std::vector<IndexPartition> partitions;
+  uint32_t data_end = file_content.size();
+  size_t partition_begin = 0;
+  size_t encoded_size = 0;
+  for (size_t i = 0; i < meta_entries.size(); ++i) {
+    encoded_size += sizeof(uint32_t) + sizeof(uint16_t) * 2 +
+                    meta_entries[i].first_key.size() +
+                    meta_entries[i].last_key.size();
+    bool last = i + 1 == meta_entries.size();
+    if (!last && (partition_size == 0 || encoded_size < partition_size)) {
+      continue;
+    }
+
+    IndexPartition partition;
+    partition.num_blocks = i + 1 - partition_begin;
+    partition.blocks_end =
+        last ? data_end : meta_entries[i + 1].offset;
+    partition.first_key = meta_entries[partition_begin].first_key;
+    partition.last_key = meta_entries[i].last_key;
+
+    std::vector<BlockMeta> partition_metas(
+        meta_entries.begin() + partition_begin, meta_entries.begin() + i + 1);
+    std::vector<uint8_t> index_block;
+    BlockMeta::encode_meta_to_slice(partition_metas, index_block);
+    partition.index_offset = file_content.size();
+    partition.index_size = index_block.size();
+    file_content.insert(file_content.end(), index_block.begin(),
+                        index_block.end());
+
+    if (has_bloom) {
+      // 按分区内实际的 key 数量构建过滤器
+      size_t hash_begin =
+          partition_begin == 0 ? 0 : block_hash_ends[partition_begin - 1];
+      std::vector<uint64_t> hashes(key_hashes.begin() + hash_begin,
+                                   key_hashes.begin() + block_hash_ends[i]);
+      auto filter =
+          Filter::create_from_hashes(filter_type, hashes, bits_per_key);
+      auto filter_block = filter->encode();
+      partition.filter_offset = file_content.size();
+      partition.filter_size = filter_block.size();
+      file_content.insert(file_content.end(), filter_block.begin(),
+                          filter_block.end());
+    }
 
-  // 3. 编码布隆过滤器
+    partitions.push_back(std::move(partition));
+    partition_begin = i + 1;
+    encoded_size = 0;
+  }
+  key_hashes.clear();
+  block_hash_ends.clear();
+
+  // 3. 写入顶层索引, 布隆过滤器已经分散到各个分区中, 其区域为空
+  std::vector<uint8_t> top_index;
+  IndexPartition::encode_to_slice(partitions, top_index);
+  uint32_t meta_offset = file_content.size();
+  file_content.insert(file_content.end(), top_index.begin(), top_index.end());
   uint32_t bloom_offset = file_content.size();
-  if (bloom_filter != nullptr) {
-    auto bf_data = bloom_filter->encode();
-    file_content.insert(file_content.end(), bf_data.begin(), bf_data.end());
+
+  // 4. 构建并编码前缀过滤器
+  uint32_t prefix_filter_offset = file_content.size();
+  FilterType prefix_filter_type = filter_type;
+  if (prefix_extractor != nullptr) {
+    auto prefix_filter =
+        Filter::create_from_hashes(filter_type, prefix_hashes, bits_per_key);
+    prefix_hashes.clear();
+    prefix_filter_type = prefix_filter->type();
+    const auto &name = prefix_extractor->name();
+    uint16_t name_len = name.size();
+    file_content.resize(file_content.size() + sizeof(uint16_t));
+    memcpy(file_content.data() + file_content.size() - sizeof(uint16_t),
+           &name_len, sizeof(uint16_t));
+    file_content.insert(file_content.end(), name.begin(), name.end());
+    auto pf_data = prefix_filter->encode();
+    file_content.insert(file_content.end(), pf_data.begin(), pf_data.end());
   }
 
-  auto extra_len = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2;
+  auto extra_len = kSstFooterV0Size;
   file_content.resize(file_content.size() + extra_len);
   // sizeof(uint32_t) * 2  表示: 元数据块的偏移量, 布隆过滤器偏移量,
   // sizeof(uint64_t) * 2  表示: 最小事务id,, 最大事务id
 
-  // 4. 添加元数据块偏移量
+  // 5. 添加元数据块偏移量
   memcpy(file_content.data() + file_content.size() - extra_len, &meta_offset,
          sizeof(uint32_t));
 
-  // 5. 添加布隆过滤器偏移量
+  // 6. 添加布隆过滤器偏移量
   memcpy(file_content.data() + file_content.size() - extra_len +
              sizeof(uint32_t),
          &bloom_offset, sizeof(uint32_t));
 
-  // 6. 添加最大和最小的事务id
+  // 7. 添加最大和最小的事务id
   memcpy(file_content.data() + file_content.size() - sizeof(uint64_t) * 2,
          &min_tranc_id, sizeof(uint64_t));
   memcpy(file_content.data() + file_content.size() - sizeof(uint64_t),
          &max_tranc_id, sizeof(uint64_t));
 
-  // 创建文件
-  FileObj file = FileObj::create_and_write(path, file_content);
-
-  // 返回SST对象
-  auto res = std::make_shared<SST>();
-
-  res->sst_id = sst_id;
-  res->file = std::move(file);
-  res->first_key = meta_entries.front().first_key;
-  res->last_key = meta_entries.back().last_key;
-  res->meta_block_offset = meta_offset;
-  res->bloom_filter = this->bloom_filter;
-  res->bloom_offset = bloom_offset;
-  res->meta_entries = std::move(meta_entries);
-  res->block_cache = block_cache;
-  res->max_tranc_id = max_tranc_id;
-  res->min_tranc_id = min_tranc_id;
+  // 8. 添加前缀过滤器的偏移量和类型, 过滤器类型, 格式版本和 magic
+  file_content.resize(file_content.size() + sizeof(uint32_t));
+  memcpy(file_content.data() + file_content.size() - sizeof(uint32_t),
+         &prefix_filter_offset, sizeof(uint32_t));
+  file_content.push_back(static_cast<uint8_t>(prefix_filter_type));
+  file_content.push_back(static_cast<uint8_t>(filter_type));
+  file_content.push_back(kSstFormatVersion);
+  file_content.resize(file_content.size() + sizeof(uint32_t));
+  memcpy(file_content.data() + file_content.size() - sizeof(uint32_t),
+         &kSstMagic, sizeof(uint32_t));
+
+  // 偏移量在超过 u32 时已经被截断, 不能写入文件
+  if (file_content.size() > kSstMaxFileSize) {
+    throw std::runtime_error("SST file too large: " +
+                             std::to_string(file_content.size()) + " bytes");
+  }
 
-  return res;
+  // 创建文件, 写入完成后按配置的读取方式重新以只读方式打开,
+  // 与启动时一样只读取顶层索引, 分区在使用时加载
+  meta_entries.clear();
+  FileObj::create_and_write(path, file_content);
+  FileObj file = FileObj::open_read_only(
+      path, file_read_mode_from_string(
+                TomlConfig::getInstance().getLsmSstReadMode()));
+  return SST::open(sst_id, std::move(file), block_cache, level);
 }
 } // namespace my_tiny_lsm
\ No newline at end of file
@@ -16,30 +16,53 @@ sst_iters_monotony_predicate(
     std::function<int(const std::string &)> predicate) {
   std::optional<SSTableIterator> final_begin = std::nullopt;
   std::optional<SSTableIterator> final_end = std::nullopt;
-  for (int block_idx = 0; block_idx < sst->meta_entries.size(); block_idx++) {
-    auto block = sst->read_block(block_idx);
-
-    BlockMeta &meta_i = sst->meta_entries[block_idx];
-    if (predicate(meta_i.first_key) < 0 || predicate(meta_i.last_key) > 0) {
+  if (predicate(sst->get_first_key()) < 0 ||
+      predicate(sst->get_last_key()) > 0 || sst->num_blocks() == 0) {
+    // 整个 sst 都在谓词范围之外, 先比较首尾 key, 避免打开未加载的 sst
+    return std::nullopt;
+  }
+  for (size_t p = 0; p < sst->index_partitions.size(); p++) {
+    const IndexPartition &partition = sst->index_partitions[p];
+    if (predicate(partition.last_key) > 0) {
+      // 整个分区都在范围左侧, 不需要加载
+      continue;
+    }
+    if (predicate(partition.first_key) < 0) {
+      // 之后的分区都在范围右侧
       break;
     }
 
-    auto result_i = block->get_monotony_predicate_iters(tranc_id, predicate);
-    if (result_i.has_value()) {
-      auto [i_begin, i_end] = result_i.value();
-      if (!final_begin.has_value()) {
+    auto metas = sst->load_index_partition(p);
+    for (size_t i = 0; i < metas->size(); i++) {
+      const BlockMeta &meta_i = (*metas)[i];
+      if (predicate(meta_i.last_key) > 0) {
+        // 整个 block 都在范围左侧, 不需要读取
+        continue;
+      }
+      if (predicate(meta_i.first_key) < 0) {
+        // 之后的 block 都在范围右侧
+        break;
+      }
+
+      size_t block_idx = partition.first_block + i;
+      auto block = sst->read_block(block_idx);
+      auto result_i = block->get_monotony_predicate_iters(tranc_id, predicate);
+      if (result_i.has_value()) {
+        auto [i_begin, i_end] = result_i.value();
+        if (!final_begin.has_value()) {
+          auto tmp_it = SSTableIterator(sst, tranc_id);
+          tmp_it.set_block_idx(block_idx);
+          tmp_it.set_block_it(i_begin);
+          final_begin = tmp_it;
+        }
         auto tmp_it = SSTableIterator(sst, tranc_id);
         tmp_it.set_block_idx(block_idx);
-        tmp_it.set_block_it(i_begin);
-        final_begin = tmp_it;
+        tmp_it.set_block_it(i_end);
+        if (tmp_it.is_end() && tmp_it.m_block_idx == sst->num_blocks()) {
+          tmp_it.set_block_it(nullptr);
+        }
+        final_end = tmp_it;
       }
-      auto tmp_it = SSTableIterator(sst, tranc_id);
-      tmp_it.set_block_idx(block_idx);
-      tmp_it.set_block_it(i_end);
-      if (tmp_it.is_end() && tmp_it.m_block_idx == sst->num_blocks()) {
-        tmp_it.set_block_it(nullptr);
-      }
-      final_end = tmp_it;
     }
   }
   if (!final_begin.has_value() || !final_end.has_value()) {
@@ -48,8 +71,10 @@ sst_iters_monotony_predicate(
   return std::make_pair(final_begin.value(), final_end.value());
 }
 
-SSTableIterator::SSTableIterator(std::shared_ptr<SST> sst, uint64_t tranc_id)
-    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id) {
+SSTableIterator::SSTableIterator(std::shared_ptr<SST> sst, uint64_t tranc_id,
+                                 bool fill_cache)
+    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id),
+      fill_cache_(fill_cache) {
   if (m_sst) {
     seek_first();
   }
@@ -75,7 +100,7 @@ void SSTableIterator::seek_first() {
   }
 
   m_block_idx = 0;
-  auto block = m_sst->read_block(m_block_idx);
+  auto block = m_sst->read_block(m_block_idx, fill_cache_);
   m_block_it = std::make_shared<BlockIterator>(block, 0, max_tranc_id_);
 }
 
@@ -135,7 +160,7 @@ BaseIterator &SSTableIterator::operator++() {
     m_block_idx++;
     if (m_block_idx < m_sst->num_blocks()) {
       // 读取下一个block
-      auto next_block = m_sst->read_block(m_block_idx);
+      auto next_block = m_sst->read_block(m_block_idx, fill_cache_);
       BlockIterator new_blk_it(next_block, 0, max_tranc_id_);
       (*m_block_it) = new_blk_it;
     } else {
@@ -163,7 +188,8 @@ bool SSTableIterator::operator==(const BaseIterator &other) const {
     return false;
   }
 
-  return *m_block_it == *other2.m_block_it;
+  // block 被淘汰后重新读取时是不同的对象, 同一个 block 只比较位置
+  return m_block_it->index() == other2.m_block_it->index();
 }
 
 bool SSTableIterator::operator!=(const BaseIterator &other) const {
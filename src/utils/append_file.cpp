@@ -0,0 +1,79 @@
+#include "../../include/utils/append_file.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace my_tiny_lsm {
+
+AppendFile::~AppendFile() { close(); }
+
+AppendFile::AppendFile(AppendFile &&other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), size_(std::exchange(other.size_, 0)) {
+}
+
+AppendFile &AppendFile::operator=(AppendFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    fd_ = std::exchange(other.fd_, -1);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+AppendFile AppendFile::open(const std::string &path, bool truncate) {
+  int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+  if (truncate) {
+    flags |= O_TRUNC;
+  }
+  int fd = ::open(path.c_str(), flags, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Failed to stat file: " + path);
+  }
+
+  AppendFile file;
+  file.fd_ = fd;
+  file.size_ = static_cast<size_t>(st.st_size);
+  return file;
+}
+
+bool AppendFile::append(const uint8_t *data, size_t size) {
+  // write 可能只写入一部分, 循环直到全部写完
+  while (size > 0) {
+    ssize_t n = ::write(fd_, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+    size_ += n;
+  }
+  return true;
+}
+
+bool AppendFile::sync() {
+  if (fd_ < 0) {
+    return false;
+  }
+  return ::fdatasync(fd_) == 0;
+}
+
+size_t AppendFile::size() const { return size_; }
+
+void AppendFile::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+} // namespace my_tiny_lsm
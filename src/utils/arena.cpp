@@ -0,0 +1,53 @@
+#include "../../include/utils/arena.h"
+
+namespace my_tiny_lsm {
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size), current_(&empty_chunk_) {}
+
+char *Arena::allocate(size_t bytes) {
+  // 每次分配的大小都按对齐要求向上取整, 块内的偏移量始终是对齐的,
+  // new char[] 返回的块首地址满足基本对齐要求
+  constexpr size_t align = alignof(void *);
+  bytes = (bytes + align - 1) & ~(align - 1);
+
+  if (bytes > block_size_ / 4) {
+    // 较大的对象单独分配一块, 避免浪费当前块剩余的空间
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocate_new_chunk(bytes, bytes)->data.get();
+  }
+
+  while (true) {
+    // 快速路径: 在当前块内占用 [offset, offset + bytes)
+    Chunk *chunk = current_.load(std::memory_order_acquire);
+    size_t offset = chunk->used.fetch_add(bytes, std::memory_order_relaxed);
+    if (offset + bytes <= chunk->size) {
+      return chunk->data.get() + offset;
+    }
+
+    // 当前块已用完, 加锁换块; 其他线程已经换过时用新块重试
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_.load(std::memory_order_relaxed) != chunk) {
+      continue;
+    }
+    Chunk *new_chunk = allocate_new_chunk(block_size_, bytes);
+    current_.store(new_chunk, std::memory_order_release);
+    return new_chunk->data.get();
+  }
+}
+
+size_t Arena::memory_usage() const {
+  return memory_usage_.load(std::memory_order_relaxed);
+}
+
+Arena::Chunk *Arena::allocate_new_chunk(size_t size, size_t used) {
+  // 调用方需持有 mutex_
+  auto chunk = std::make_unique<Chunk>();
+  chunk->data.reset(new char[size]);
+  chunk->size = size;
+  chunk->used.store(used, std::memory_order_relaxed);
+  memory_usage_.fetch_add(size, std::memory_order_relaxed);
+  chunks_.push_back(std::move(chunk));
+  return chunks_.back().get();
+}
+} // namespace my_tiny_lsm
@@ -0,0 +1,285 @@
+#include "../../include/utils/binary_fuse_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace my_tiny_lsm {
+
+namespace {
+constexpr uint32_t kArity = 3;
+constexpr uint32_t kMaxSegmentLength = 262144;
+constexpr int kMaxIterations = 100;
+
+uint64_t murmur64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+uint64_t mulhi(uint64_t a, uint64_t b) {
+  return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+}
+
+uint32_t mod3(uint32_t x) { return x > 2 ? x - 3 : x; }
+} // namespace
+
+template <typename FingerprintT>
+uint64_t BinaryFuseFilter<FingerprintT>::mix(uint64_t hash, uint64_t seed) {
+  return murmur64(hash + seed);
+}
+
+template <typename FingerprintT>
+FingerprintT BinaryFuseFilter<FingerprintT>::fingerprint(uint64_t hash) {
+  return static_cast<FingerprintT>(hash ^ (hash >> 32));
+}
+
+template <typename FingerprintT>
+uint32_t BinaryFuseFilter<FingerprintT>::position(uint64_t hash,
+                                                  uint32_t index) const {
+  // 先选出起始分段, 再在相邻的 3 个分段中各取一个位置
+  uint64_t h = mulhi(hash, segment_count_length_);
+  h += static_cast<uint64_t>(index) * segment_length_;
+  uint64_t hh = hash & ((1ULL << 36) - 1);
+  h ^= (hh >> (36 - 18 * index)) & segment_length_mask_;
+  return static_cast<uint32_t>(h);
+}
+
+template <typename FingerprintT>
+void BinaryFuseFilter<FingerprintT>::init_layout(size_t num_keys) {
+  // 分段长度和数组大小的经验公式来自论文的参考实现
+  segment_length_ =
+      num_keys <= 1
+          ? 4
+          : 1U << static_cast<int>(std::floor(
+                std::log(static_cast<double>(num_keys)) / std::log(3.33) +
+                2.25));
+  segment_length_ = std::min(segment_length_, kMaxSegmentLength);
+  segment_length_mask_ = segment_length_ - 1;
+
+  double n = static_cast<double>(num_keys);
+  double size_factor =
+      num_keys <= 1
+          ? 0
+          : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(n));
+  size_t capacity = static_cast<size_t>(std::round(n * size_factor));
+  size_t array_length = (capacity + segment_length_ - 1) / segment_length_ *
+                        segment_length_;
+  size_t segment_count = (array_length + segment_length_ - 1) / segment_length_;
+  segment_count =
+      segment_count <= kArity - 1 ? 1 : segment_count - (kArity - 1);
+  array_length = (segment_count + kArity - 1) * segment_length_;
+  segment_count_length_ = segment_count * segment_length_;
+  fingerprints_.assign(array_length, 0);
+}
+
+template <typename FingerprintT>
+BinaryFuseFilter<FingerprintT>
+BinaryFuseFilter<FingerprintT>::build(std::vector<uint64_t> hashes) {
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+  size_t size = hashes.size();
+
+  BinaryFuseFilter filter;
+  filter.init_layout(size);
+  size_t capacity = filter.fingerprints_.size();
+
+  // reverse_order 末尾的哨兵保证按分段分桶时不会越界
+  std::vector<uint64_t> reverse_order(size + 1, 0);
+  std::vector<uint8_t> reverse_h(size);
+  std::vector<uint32_t> alone(capacity);
+  std::vector<uint8_t> t2count(capacity);
+  std::vector<uint64_t> t2hash(capacity);
+
+  uint32_t block_bits = 1;
+  while ((1U << block_bits) < filter.segment_count_length_ /
+                                  filter.segment_length_) {
+    block_bits++;
+  }
+  uint32_t block = 1U << block_bits;
+  std::vector<uint32_t> start_pos(block);
+
+  uint64_t rng_state = 0x726b2b9d438b9d4dULL;
+  for (int iteration = 0;; ++iteration) {
+    if (iteration >= kMaxIterations) {
+      throw std::runtime_error("Failed to build binary fuse filter");
+    }
+    filter.seed_ = splitmix64(rng_state);
+    std::fill(reverse_order.begin(), reverse_order.end() - 1, 0);
+    reverse_order[size] = 1;
+    std::fill(t2count.begin(), t2count.end(), 0);
+    std::fill(t2hash.begin(), t2hash.end(), 0);
+
+    // 1. 按起始分段对哈希值做桶排序, 提高后续访问的局部性
+    for (uint32_t i = 0; i < block; ++i) {
+      start_pos[i] = static_cast<uint32_t>((uint64_t{i} * size) >> block_bits);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      uint64_t hash = mix(hashes[i], filter.seed_);
+      uint64_t segment_index = hash >> (64 - block_bits);
+      while (reverse_order[start_pos[segment_index]] != 0) {
+        segment_index = (segment_index + 1) & (block - 1);
+      }
+      reverse_order[start_pos[segment_index]] = hash;
+      start_pos[segment_index]++;
+    }
+
+    // 2. 统计每个位置被多少个 key 映射, 并记录这些 key 哈希值的异或
+    bool error = false;
+    for (size_t i = 0; i < size; ++i) {
+      uint64_t hash = reverse_order[i];
+      for (uint32_t j = 0; j < kArity; ++j) {
+        uint32_t pos = filter.position(hash, j);
+        t2count[pos] += 4;
+        t2count[pos] ^= j;
+        t2hash[pos] ^= hash;
+        error |= t2count[pos] < 4; // 计数溢出
+      }
+    }
+    if (error) {
+      continue;
+    }
+
+    // 3. 不断剥离只被一个 key 映射的位置
+    size_t queue_size = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+      alone[queue_size] = i;
+      queue_size += (t2count[i] >> 2) == 1 ? 1 : 0;
+    }
+    size_t stack_size = 0;
+    while (queue_size > 0) {
+      uint32_t index = alone[--queue_size];
+      if ((t2count[index] >> 2) != 1) {
+        continue;
+      }
+      uint64_t hash = t2hash[index];
+      uint32_t found = t2count[index] & 3;
+      reverse_h[stack_size] = found;
+      reverse_order[stack_size] = hash;
+      stack_size++;
+      for (uint32_t k = 1; k < kArity; ++k) {
+        uint32_t j = mod3(found + k);
+        uint32_t other = filter.position(hash, j);
+        alone[queue_size] = other;
+        queue_size += (t2count[other] >> 2) == 2 ? 1 : 0;
+        t2count[other] -= 4;
+        t2count[other] ^= j;
+        t2hash[other] ^= hash;
+      }
+    }
+    if (stack_size == size) {
+      break;
+    }
+  }
+
+  // 4. 按剥离的逆序填充指纹, 使每个 key 三处指纹的异或等于它的指纹
+  for (size_t i = size; i-- > 0;) {
+    uint64_t hash = reverse_order[i];
+    uint32_t found = reverse_h[i];
+    FingerprintT value = fingerprint(hash);
+    for (uint32_t k = 1; k < kArity; ++k) {
+      value ^= filter.fingerprints_[filter.position(hash, mod3(found + k))];
+    }
+    filter.fingerprints_[filter.position(hash, found)] = value;
+  }
+  return filter;
+}
+
+template <typename FingerprintT>
+void BinaryFuseFilter<FingerprintT>::add(const std::string &) {
+  throw std::logic_error(
+      "BinaryFuseFilter is static, build it with create_from_hashes");
+}
+
+template <typename FingerprintT>
+void BinaryFuseFilter<FingerprintT>::add_hash(uint64_t) {
+  throw std::logic_error(
+      "BinaryFuseFilter is static, build it with create_from_hashes");
+}
+
+template <typename FingerprintT>
+bool BinaryFuseFilter<FingerprintT>::possibly_contains_hash(
+    uint64_t key_hash) const {
+  if (fingerprints_.empty()) {
+    return true;
+  }
+  uint64_t hash = mix(key_hash, seed_);
+  FingerprintT value = fingerprint(hash);
+  value ^= fingerprints_[position(hash, 0)] ^ fingerprints_[position(hash, 1)] ^
+           fingerprints_[position(hash, 2)];
+  return value == 0;
+}
+
+template <typename FingerprintT>
+FilterType BinaryFuseFilter<FingerprintT>::type() const {
+  return sizeof(FingerprintT) == 1 ? FilterType::BinaryFuse8
+                                   : FilterType::BinaryFuse16;
+}
+
+// 编码格式: [seed(u64)][segment_length(u32)][segment_count_length(u32)]
+//           [num_fingerprints(u32)][fingerprints]
+template <typename FingerprintT>
+std::vector<uint8_t> BinaryFuseFilter<FingerprintT>::encode() {
+  uint32_t num_fingerprints = fingerprints_.size();
+  size_t header_size = sizeof(uint64_t) + sizeof(uint32_t) * 3;
+  std::vector<uint8_t> data(header_size +
+                            num_fingerprints * sizeof(FingerprintT));
+  uint8_t *ptr = data.data();
+  memcpy(ptr, &seed_, sizeof(uint64_t));
+  ptr += sizeof(uint64_t);
+  memcpy(ptr, &segment_length_, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  memcpy(ptr, &segment_count_length_, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  memcpy(ptr, &num_fingerprints, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  memcpy(ptr, fingerprints_.data(), num_fingerprints * sizeof(FingerprintT));
+  return data;
+}
+
+template <typename FingerprintT>
+BinaryFuseFilter<FingerprintT>
+BinaryFuseFilter<FingerprintT>::decode(const std::vector<uint8_t> &data) {
+  size_t header_size = sizeof(uint64_t) + sizeof(uint32_t) * 3;
+  if (data.size() < header_size) {
+    throw std::runtime_error("Invalid binary fuse filter: too small");
+  }
+  BinaryFuseFilter filter;
+  uint32_t num_fingerprints;
+  const uint8_t *ptr = data.data();
+  memcpy(&filter.seed_, ptr, sizeof(uint64_t));
+  ptr += sizeof(uint64_t);
+  memcpy(&filter.segment_length_, ptr, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  memcpy(&filter.segment_count_length_, ptr, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  memcpy(&num_fingerprints, ptr, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+  size_t expected_fingerprints =
+      filter.segment_count_length_ +
+      size_t{kArity - 1} * filter.segment_length_;
+  if (data.size() != header_size + num_fingerprints * sizeof(FingerprintT) ||
+      filter.segment_length_ == 0 ||
+      num_fingerprints != expected_fingerprints) {
+    throw std::runtime_error("Invalid binary fuse filter: size mismatch");
+  }
+  filter.segment_length_mask_ = filter.segment_length_ - 1;
+  filter.fingerprints_.resize(num_fingerprints);
+  memcpy(filter.fingerprints_.data(), ptr,
+         num_fingerprints * sizeof(FingerprintT));
+  return filter;
+}
+
+template class BinaryFuseFilter<uint8_t>;
+template class BinaryFuseFilter<uint16_t>;
+} // namespace my_tiny_lsm
@@ -0,0 +1,131 @@
+#include "../../include/utils/blocked_bloom_filter.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MY_TINY_LSM_BLOOM_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace my_tiny_lsm {
+
+namespace {
+// 每个字使用不同的奇数乘子, 从同一个 32 bit 哈希值中得到 8 个独立的位
+constexpr uint32_t kSalts[BlockedBloomFilter::kWordsPerBlock] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+inline void make_mask(uint32_t hash,
+                      uint32_t mask[BlockedBloomFilter::kWordsPerBlock]) {
+  for (size_t i = 0; i < BlockedBloomFilter::kWordsPerBlock; ++i) {
+    mask[i] = 1U << ((hash * kSalts[i]) >> 27);
+  }
+}
+
+// 块中是否包含 hash 对应的全部位
+bool block_contains(const uint32_t *words, uint32_t hash) {
+  uint32_t mask[BlockedBloomFilter::kWordsPerBlock];
+  make_mask(hash, mask);
+  // 不提前返回, 便于编译器向量化
+  uint32_t missing = 0;
+  for (size_t i = 0; i < BlockedBloomFilter::kWordsPerBlock; ++i) {
+    missing |= mask[i] & ~words[i];
+  }
+  return missing == 0;
+}
+
+#ifdef MY_TINY_LSM_BLOOM_AVX2
+// 单独以 avx2 编译, 默认的编译选项下也能在运行时选用 AVX2 指令
+__attribute__((target("avx2"))) bool block_contains_avx2(const uint32_t *words,
+                                                         uint32_t hash) {
+  const __m256i salts =
+      _mm256_setr_epi32(kSalts[0], kSalts[1], kSalts[2], kSalts[3], kSalts[4],
+                        kSalts[5], kSalts[6], kSalts[7]);
+  __m256i product = _mm256_mullo_epi32(_mm256_set1_epi32(hash), salts);
+  __m256i shift = _mm256_srli_epi32(product, 27);
+  __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+  __m256i bits = _mm256_load_si256(reinterpret_cast<const __m256i *>(words));
+  // testc: mask 中的位是否全部包含在 bits 中
+  return _mm256_testc_si256(bits, mask);
+}
+#endif
+
+using BlockContainsFunc = bool (*)(const uint32_t *, uint32_t);
+
+BlockContainsFunc choose_block_contains() {
+#ifdef MY_TINY_LSM_BLOOM_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return block_contains_avx2;
+  }
+#endif
+  return block_contains;
+}
+} // namespace
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expected_elements,
+                                       double false_positive_rate) {
+  // 位数与标准布隆过滤器相同, 按 256 bit 向上取整
+  double m = -static_cast<double>(expected_elements) *
+             std::log(false_positive_rate) / std::pow(std::log(2), 2);
+  size_t num_bits = static_cast<size_t>(std::ceil(m));
+  size_t bits_per_block = kWordsPerBlock * 32;
+  size_t num_blocks = (num_bits + bits_per_block - 1) / bits_per_block;
+  blocks_.resize(num_blocks == 0 ? 1 : num_blocks, FilterBlock{});
+}
+
+size_t BlockedBloomFilter::block_index(uint64_t hash) const {
+  // 用高 32 位选块, 乘法代替取模
+  return ((hash >> 32) * blocks_.size()) >> 32;
+}
+
+void BlockedBloomFilter::add(const std::string &key) {
+  add_hash(hash_key(key));
+}
+
+void BlockedBloomFilter::add_hash(uint64_t h) {
+  auto &block = blocks_[block_index(h)];
+  uint32_t mask[kWordsPerBlock];
+  make_mask(static_cast<uint32_t>(h), mask);
+  for (size_t i = 0; i < kWordsPerBlock; ++i) {
+    block.words[i] |= mask[i];
+  }
+}
+
+bool BlockedBloomFilter::possibly_contains_hash(uint64_t h) const {
+  if (blocks_.empty()) {
+    return true;
+  }
+  static const BlockContainsFunc func = choose_block_contains();
+  return func(blocks_[block_index(h)].words, static_cast<uint32_t>(h));
+}
+
+// 编码格式: [num_blocks(u32)][blocks]
+std::vector<uint8_t> BlockedBloomFilter::encode() {
+  uint32_t num_blocks = blocks_.size();
+  std::vector<uint8_t> data(sizeof(uint32_t) +
+                            num_blocks * sizeof(FilterBlock));
+  memcpy(data.data(), &num_blocks, sizeof(uint32_t));
+  memcpy(data.data() + sizeof(uint32_t), blocks_.data(),
+         num_blocks * sizeof(FilterBlock));
+  return data;
+}
+
+BlockedBloomFilter
+BlockedBloomFilter::decode(const std::vector<uint8_t> &data) {
+  if (data.size() < sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid blocked bloom filter: too small");
+  }
+  uint32_t num_blocks;
+  memcpy(&num_blocks, data.data(), sizeof(uint32_t));
+  if (data.size() != sizeof(uint32_t) + num_blocks * sizeof(FilterBlock)) {
+    throw std::runtime_error("Invalid blocked bloom filter: size mismatch");
+  }
+
+  BlockedBloomFilter bf;
+  bf.blocks_.resize(num_blocks);
+  memcpy(bf.blocks_.data(), data.data() + sizeof(uint32_t),
+         num_blocks * sizeof(FilterBlock));
+  return bf;
+}
+} // namespace my_tiny_lsm
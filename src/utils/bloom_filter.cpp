@@ -6,7 +6,7 @@
 #include <functional>
 #include <string>
 
-namespace tiny_lsm {
+namespace my_tiny_lsm {
 
 BloomFilter::BloomFilter(){};
 
@@ -30,18 +30,20 @@ BloomFilter::BloomFilter(size_t expected_elements, double false_positive_rate)
   bits_.resize(num_bits_, false);
 }
 
-void BloomFilter::add(const std::string &key) {
+void BloomFilter::add(const std::string &key) { add_hash(hash_key(key)); }
+
+void BloomFilter::add_hash(uint64_t hash) {
   // 对每个哈希函数计算哈希值，并将对应位置的位设置为true
   for (size_t i = 0; i < num_hashes_; ++i) {
-    bits_[hash(key, i)] = true;
+    bits_[bit_index(hash, i)] = true;
   }
 }
 
 //  如果key可能存在于布隆过滤器中，返回true；否则返回false
-bool BloomFilter::possibly_contains(const std::string &key) const {
+bool BloomFilter::possibly_contains_hash(uint64_t key_hash) const {
   // 对每个哈希函数计算哈希值，检查对应位置的位是否都为true
   for (size_t i = 0; i < num_hashes_; ++i) {
-    auto bit_idx = hash(key, i);
+    auto bit_idx = bit_index(key_hash, i);
     if (!bits_[bit_idx]) {
       return false;
     }
@@ -49,6 +51,24 @@ bool BloomFilter::possibly_contains(const std::string &key) const {
   return true;
 }
 
+size_t BloomFilter::hash1(const std::string &key) const {
+  return hash_key(key) & 0xffffffff;
+}
+
+size_t BloomFilter::hash2(const std::string &key) const {
+  return hash_key(key) >> 32;
+}
+
+size_t BloomFilter::hash(const std::string &key, size_t idx) const {
+  return bit_index(hash_key(key), idx);
+}
+
+size_t BloomFilter::bit_index(uint64_t hash, size_t idx) const {
+  uint64_t h1 = hash & 0xffffffff;
+  uint64_t h2 = hash >> 32;
+  return (h1 + idx * h2) % num_bits_;
+}
+
 // 清空布隆过滤器
 void BloomFilter::clear() { bits_.assign(bits_.size(), false); }
 
@@ -138,4 +158,4 @@ BloomFilter BloomFilter::decode(const std::vector<uint8_t> &data) {
 
   return bf;
 }
-} // namespace tiny_lsm
\ No newline at end of file
+} // namespace my_tiny_lsm
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "../../include/utils/compression.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace my_tiny_lsm {
+
+namespace {
+// LZ4 block 格式的约束: 最短匹配 4 字节, 最后 5 字节必须是字面量,
+// 距离末尾不足 12 字节的位置不再开始新的匹配
+constexpr size_t kMinMatch = 4;
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchFindLimit = 12;
+constexpr size_t kMaxDistance = 65535;
+constexpr int kHashLog = 12;
+// 压缩率低于 1/8 时不值得解压的开销
+constexpr size_t kMinSavingRatio = 8;
+
+uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(uint32_t));
+  return v;
+}
+
+uint32_t hash4(uint32_t v) { return (v * 2654435761U) >> (32 - kHashLog); }
+
+// 长度字段超过 15 时, 后续每个字节累加, 以不等于 255 的字节结束
+void write_length(std::vector<uint8_t> &out, size_t len) {
+  while (len >= 255) {
+    out.push_back(255);
+    len -= 255;
+  }
+  out.push_back(static_cast<uint8_t>(len));
+}
+
+void write_sequence(std::vector<uint8_t> &out, const uint8_t *literals,
+                    size_t literal_len, size_t offset, size_t match_len) {
+  size_t token_pos = out.size();
+  out.push_back(0);
+  uint8_t token = 0;
+  if (literal_len >= 15) {
+    token = 15 << 4;
+    write_length(out, literal_len - 15);
+  } else {
+    token = static_cast<uint8_t>(literal_len << 4);
+  }
+  out.insert(out.end(), literals, literals + literal_len);
+  if (match_len != 0) {
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    size_t len = match_len - kMinMatch;
+    if (len >= 15) {
+      token |= 15;
+      write_length(out, len - 15);
+    } else {
+      token |= static_cast<uint8_t>(len);
+    }
+  }
+  out[token_pos] = token;
+}
+
+void lz4_compress(const uint8_t *src, size_t size, std::vector<uint8_t> &out) {
+  size_t anchor = 0;
+  if (size > kMatchFindLimit) {
+    uint32_t table[1 << kHashLog] = {};
+    size_t match_limit = size - kLastLiterals;
+    size_t ip = 1;
+    while (ip + kMatchFindLimit <= size) {
+      uint32_t seq = read32(src + ip);
+      uint32_t h = hash4(seq);
+      size_t ref = table[h];
+      table[h] = static_cast<uint32_t>(ip);
+      if (ip - ref > kMaxDistance || read32(src + ref) != seq) {
+        // 长时间没有匹配时加大步长, 避免在不可压缩的数据上浪费时间
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+      size_t match_len = kMinMatch;
+      while (ip + match_len < match_limit &&
+             src[ref + match_len] == src[ip + match_len]) {
+        ++match_len;
+      }
+      write_sequence(out, src + anchor, ip - anchor, ip - ref, match_len);
+      ip += match_len;
+      anchor = ip;
+      if (ip + kMatchFindLimit <= size) {
+        table[hash4(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+      }
+    }
+  }
+  write_sequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+void lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                    size_t dst_size) {
+  size_t ip = 0;
+  size_t op = 0;
+  auto read_length = [&](size_t len) {
+    uint8_t b;
+    do {
+      if (ip >= size) {
+        throw std::runtime_error("Corrupted LZ4 block: truncated length");
+      }
+      b = src[ip++];
+      len += b;
+    } while (b == 255);
+    return len;
+  };
+  while (ip < size) {
+    uint8_t token = src[ip++];
+    size_t literal_len = token >> 4;
+    if (literal_len == 15) {
+      literal_len = read_length(literal_len);
+    }
+    if (literal_len > size - ip || literal_len > dst_size - op) {
+      throw std::runtime_error("Corrupted LZ4 block: literals out of range");
+    }
+    memcpy(dst + op, src + ip, literal_len);
+    ip += literal_len;
+    op += literal_len;
+    if (ip == size) {
+      break; // 最后一个序列只有字面量
+    }
+
+    if (size - ip < 2) {
+      throw std::runtime_error("Corrupted LZ4 block: truncated offset");
+    }
+    size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) {
+      throw std::runtime_error("Corrupted LZ4 block: invalid offset");
+    }
+    size_t match_len = token & 15;
+    if (match_len == 15) {
+      match_len = read_length(match_len);
+    }
+    match_len += kMinMatch;
+    if (match_len > dst_size - op) {
+      throw std::runtime_error("Corrupted LZ4 block: match out of range");
+    }
+    const uint8_t *match = dst + op - offset;
+    if (offset >= match_len) {
+      memcpy(dst + op, match, match_len);
+    } else {
+      // 匹配与输出重叠, 逐字节复制以重复前面的内容
+      for (size_t i = 0; i < match_len; ++i) {
+        dst[op + i] = match[i];
+      }
+    }
+    op += match_len;
+  }
+  if (op != dst_size) {
+    throw std::runtime_error("Corrupted LZ4 block: size mismatch");
+  }
+}
+} // namespace
+
+std::vector<uint8_t> compress_block(CompressionType type, const uint8_t *data,
+                                    size_t size) {
+  if (type == CompressionType::None) {
+    return {};
+  }
+  std::vector<uint8_t> out;
+  out.reserve(sizeof(uint32_t) + size + size / 255 + 16);
+  out.resize(sizeof(uint32_t));
+  uint32_t raw_size = static_cast<uint32_t>(size);
+  memcpy(out.data(), &raw_size, sizeof(uint32_t));
+  lz4_compress(data, size, out);
+  if (out.size() > size - size / kMinSavingRatio) {
+    return {};
+  }
+  return out;
+}
+
+std::vector<uint8_t> decompress_block(CompressionType type,
+                                      const uint8_t *data, size_t size) {
+  if (type != CompressionType::LZ4) {
+    throw std::runtime_error("Unknown block compression type: " +
+                             std::to_string(static_cast<int>(type)));
+  }
+  if (size < sizeof(uint32_t)) {
+    throw std::runtime_error("Corrupted compressed block: too small");
+  }
+  uint32_t raw_size;
+  memcpy(&raw_size, data, sizeof(uint32_t));
+  size_t payload_size = size - sizeof(uint32_t);
+  // LZ4 每个输入字节最多展开为 255 字节, 防止损坏的长度导致巨大的分配
+  if (raw_size > payload_size * 255) {
+    throw std::runtime_error("Corrupted compressed block: invalid size");
+  }
+  std::vector<uint8_t> out(raw_size);
+  lz4_decompress(data + sizeof(uint32_t), payload_size, out.data(), raw_size);
+  return out;
+}
+} // namespace my_tiny_lsm
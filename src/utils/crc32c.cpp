@@ -0,0 +1,119 @@
+#include "../../include/utils/crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MY_TINY_LSM_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+namespace my_tiny_lsm {
+
+namespace {
+// 反射形式的 Castagnoli 多项式
+constexpr uint32_t kPoly = 0x82F63B78U;
+
+// slicing-by-8: tables[k][b] 为字节 b 之后再跟 k 个 0 字节的 crc,
+// 每次处理 8 个字节
+using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+Crc32cTables make_tables() {
+  Crc32cTables tables{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; ++j) {
+      crc = (crc >> 1) ^ (kPoly & (0U - (crc & 1)));
+    }
+    tables[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (size_t k = 1; k < 8; ++k) {
+      uint32_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+uint32_t crc32c_software(uint32_t l, const uint8_t *data, size_t size) {
+  static const Crc32cTables tables = make_tables();
+  while (size >= sizeof(uint64_t)) {
+    uint32_t lo;
+    uint32_t hi;
+    memcpy(&lo, data, sizeof(uint32_t));
+    memcpy(&hi, data + sizeof(uint32_t), sizeof(uint32_t));
+    lo ^= l;
+    l = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF] ^
+        tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24] ^
+        tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF] ^
+        tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+    data += sizeof(uint64_t);
+    size -= sizeof(uint64_t);
+  }
+  while (size > 0) {
+    l = (l >> 8) ^ tables[0][(l ^ *data++) & 0xFF];
+    --size;
+  }
+  return l;
+}
+
+#ifdef MY_TINY_LSM_CRC32C_SSE42
+// 单独以 sse4.2 编译, 默认的编译选项下也能在运行时选用 crc32 指令
+__attribute__((target("sse4.2"))) uint32_t
+crc32c_sse42(uint32_t l, const uint8_t *data, size_t size) {
+  uint64_t l64 = l;
+  while (size >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(uint64_t));
+    l64 = _mm_crc32_u64(l64, word);
+    data += sizeof(uint64_t);
+    size -= sizeof(uint64_t);
+  }
+  l = static_cast<uint32_t>(l64);
+  while (size > 0) {
+    l = _mm_crc32_u8(l, *data++);
+    --size;
+  }
+  return l;
+}
+#endif
+
+using Crc32cFunc = uint32_t (*)(uint32_t, const uint8_t *, size_t);
+
+Crc32cFunc choose_crc32c() {
+#ifdef MY_TINY_LSM_CRC32C_SSE42
+  if (__builtin_cpu_supports("sse4.2")) {
+    return crc32c_sse42;
+  }
+#endif
+  return crc32c_software;
+}
+} // namespace
+
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t size) {
+  static const Crc32cFunc func = choose_crc32c();
+  return ~func(~crc, data, size);
+}
+
+uint32_t crc32c_extend_software(uint32_t crc, const uint8_t *data,
+                                size_t size) {
+  return ~crc32c_software(~crc, data, size);
+}
+
+bool crc32c_hardware_supported() {
+#ifdef MY_TINY_LSM_CRC32C_SSE42
+  return __builtin_cpu_supports("sse4.2");
+#else
+  return false;
+#endif
+}
+
+uint32_t crc32c_extend_hardware(uint32_t crc, const uint8_t *data,
+                                size_t size) {
+#ifdef MY_TINY_LSM_CRC32C_SSE42
+  return ~crc32c_sse42(~crc, data, size);
+#else
+  return crc32c_extend_software(crc, data, size);
+#endif
+}
+} // namespace my_tiny_lsm
@@ -9,18 +9,40 @@ FileObj::FileObj() : m_file(std::make_unique<StdFile>()) {}
 FileObj::~FileObj() = default;
 
 // 实现移动语义
-FileObj::FileObj(FileObj &&other) noexcept : m_file(std::move(other.m_file)) {}
+FileObj::FileObj(FileObj &&other) noexcept
+    : m_file(std::move(other.m_file)), m_reader(std::move(other.m_reader)),
+      m_mmap(std::move(other.m_mmap)) {}
 
 FileObj &FileObj::operator=(FileObj &&other) noexcept {
   if (this != &other) {
     m_file = std::move(other.m_file);
+    m_reader = std::move(other.m_reader);
+    m_mmap = std::move(other.m_mmap);
   }
   return *this;
 }
 
-size_t FileObj::size() const { return m_file->size(); }
+size_t FileObj::size() const {
+  if (m_mmap != nullptr) {
+    return m_mmap->size();
+  }
+  if (m_reader != nullptr) {
+    return m_reader->size();
+  }
+  return m_file->size();
+}
 
-void FileObj::del_file() { m_file->remove(); }
+void FileObj::del_file() {
+  if (m_mmap != nullptr) {
+    m_mmap->remove();
+    return;
+  }
+  if (m_reader != nullptr) {
+    m_reader->remove();
+    return;
+  }
+  m_file->remove();
+}
 
 bool FileObj::truncate(size_t offset) {
   if (offset > m_file->size()) {
@@ -55,26 +77,66 @@ FileObj FileObj::open(const std::string &path, bool create) {
   return std::move(file_obj);
 }
 
+FileObj FileObj::open_read_only(const std::string &path, FileReadMode mode) {
+  if (mode == FileReadMode::Stream) {
+    return open(path, false);
+  }
+
+  FileObj file_obj;
+  if (mode == FileReadMode::Mmap) {
+    file_obj.m_mmap = std::make_shared<MmapFile>();
+    if (!file_obj.m_mmap->open_read_only(path)) {
+      throw std::runtime_error("Failed to mmap file: " + path);
+    }
+    return file_obj;
+  }
+  file_obj.m_reader =
+      RandomAccessFile::open(path, mode == FileReadMode::Direct);
+  return file_obj;
+}
+
+const uint8_t *FileObj::mmap_view() const {
+  return m_mmap != nullptr ? m_mmap->view() : nullptr;
+}
+
+std::shared_ptr<const void> FileObj::mmap_owner() const { return m_mmap; }
+
+void FileObj::advise(FileAccessHint hint) {
+  if (m_mmap != nullptr) {
+    m_mmap->advise(hint);
+  }
+}
+
+std::vector<uint8_t> FileObj::read_bytes(size_t offset, size_t length) {
+  if (m_mmap != nullptr) {
+    return m_mmap->read(offset, length);
+  }
+  if (m_reader != nullptr) {
+    return m_reader->read(offset, length);
+  }
+  return m_file->read(offset, length);
+}
+
 std::vector<uint8_t> FileObj::read_to_slice(size_t offset, size_t length) {
   // 检查边界
-  if (offset + length > m_file->size()) {
+  if (offset + length > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, length);
+  auto result = read_bytes(offset, length);
 
   return result;
 }
 
 uint8_t FileObj::read_uint8(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint8_t) > m_file->size()) {
+  if (offset + sizeof(uint8_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint8_t));
+  auto result = read_bytes(offset, sizeof(uint8_t));
 
   // 将数据转换为uint8_t
   return result[0];
@@ -82,21 +144,21 @@ uint8_t FileObj::read_uint8(size_t offset) {
 
 uint16_t FileObj::read_uint16(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint16_t) > m_file->size()) {
+  if (offset + sizeof(uint16_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
-  auto result = m_file->read(offset, sizeof(uint16_t));
+  auto result = read_bytes(offset, sizeof(uint16_t));
   return *(uint16_t *)result.data();
 }
 
 uint32_t FileObj::read_uint32(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint32_t) > m_file->size()) {
+  if (offset + sizeof(uint32_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint32_t));
+  auto result = read_bytes(offset, sizeof(uint32_t));
 
   // 将数据转换为uint32_t
   return *(uint32_t *)result.data();
@@ -104,12 +166,12 @@ uint32_t FileObj::read_uint32(size_t offset) {
 
 uint64_t FileObj::read_uint64(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint64_t) > m_file->size()) {
+  if (offset + sizeof(uint64_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint64_t));
+  auto result = read_bytes(offset, sizeof(uint64_t));
 
   // 将数据转换为uint64_t
   return *(uint64_t *)result.data();
@@ -0,0 +1,121 @@
+#include "../../include/utils/filter.h"
+#include "../../include/utils/binary_fuse_filter.h"
+#include "../../include/utils/blocked_bloom_filter.h"
+#include "../../include/utils/bloom_filter.h"
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace my_tiny_lsm {
+
+uint64_t Filter::hash_key(const std::string &key) {
+  constexpr uint64_t kMul = 0xc6a4a7935bd1e995ULL;
+  constexpr int kShift = 47;
+  constexpr uint64_t kSeed = 0x4c534d46494c5452ULL;
+
+  const auto *data = reinterpret_cast<const uint8_t *>(key.data());
+  size_t len = key.size();
+  uint64_t h = kSeed ^ (static_cast<uint64_t>(len) * kMul);
+
+  const uint8_t *end = data + (len & ~static_cast<size_t>(7));
+  for (; data != end; data += sizeof(uint64_t)) {
+    uint64_t k;
+    memcpy(&k, data, sizeof(uint64_t));
+    k *= kMul;
+    k ^= k >> kShift;
+    k *= kMul;
+    h ^= k;
+    h *= kMul;
+  }
+
+  switch (len & 7) {
+  case 7:
+    h ^= static_cast<uint64_t>(data[6]) << 48;
+    [[fallthrough]];
+  case 6:
+    h ^= static_cast<uint64_t>(data[5]) << 40;
+    [[fallthrough]];
+  case 5:
+    h ^= static_cast<uint64_t>(data[4]) << 32;
+    [[fallthrough]];
+  case 4:
+    h ^= static_cast<uint64_t>(data[3]) << 24;
+    [[fallthrough]];
+  case 3:
+    h ^= static_cast<uint64_t>(data[2]) << 16;
+    [[fallthrough]];
+  case 2:
+    h ^= static_cast<uint64_t>(data[1]) << 8;
+    [[fallthrough]];
+  case 1:
+    h ^= static_cast<uint64_t>(data[0]);
+    h *= kMul;
+  }
+
+  h ^= h >> kShift;
+  h *= kMul;
+  h ^= h >> kShift;
+  return h;
+}
+
+uint64_t Filter::legacy_hash_key(const std::string &key) {
+  return std::hash<std::string_view>{}(key);
+}
+
+std::shared_ptr<Filter> Filter::create(FilterType type,
+                                       size_t expected_elements,
+                                       double false_positive_rate) {
+  switch (type) {
+  case FilterType::Bloom:
+    return std::make_shared<BloomFilter>(expected_elements,
+                                         false_positive_rate);
+  case FilterType::BlockedBloom:
+    return std::make_shared<BlockedBloomFilter>(expected_elements,
+                                                false_positive_rate);
+  default:
+    break;
+  }
+  throw std::runtime_error("Filter type can not be created empty");
+}
+
+std::shared_ptr<Filter>
+Filter::create_from_hashes(FilterType type, const std::vector<uint64_t> &hashes,
+                           double bits_per_key) {
+  if (type == FilterType::BinaryFuse8) {
+    return std::make_shared<BinaryFuse8Filter>(
+        BinaryFuse8Filter::build(hashes));
+  }
+  if (type == FilterType::BinaryFuse16) {
+    return std::make_shared<BinaryFuse16Filter>(
+        BinaryFuse16Filter::build(hashes));
+  }
+  // 最优哈希函数个数下, 每个 key 分配 b 位时的假阳性率为 e^(-b * ln2^2)
+  double false_positive_rate =
+      std::exp(-bits_per_key * std::log(2) * std::log(2));
+  size_t expected_elements = hashes.empty() ? 1 : hashes.size();
+  auto filter = create(type, expected_elements, false_positive_rate);
+  for (auto hash : hashes) {
+    filter->add_hash(hash);
+  }
+  return filter;
+}
+
+std::shared_ptr<Filter> Filter::decode(FilterType type,
+                                       const std::vector<uint8_t> &data) {
+  switch (type) {
+  case FilterType::Bloom:
+    return std::make_shared<BloomFilter>(BloomFilter::decode(data));
+  case FilterType::BlockedBloom:
+    return std::make_shared<BlockedBloomFilter>(
+        BlockedBloomFilter::decode(data));
+  case FilterType::BinaryFuse8:
+    return std::make_shared<BinaryFuse8Filter>(BinaryFuse8Filter::decode(data));
+  case FilterType::BinaryFuse16:
+    return std::make_shared<BinaryFuse16Filter>(
+        BinaryFuse16Filter::decode(data));
+  }
+  throw std::runtime_error("Unknown filter type");
+}
+} // namespace my_tiny_lsm
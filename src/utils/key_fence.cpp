@@ -0,0 +1,102 @@
+#include "../../include/utils/key_fence.h"
+#include <algorithm>
+
+namespace my_tiny_lsm {
+
+KeyFence::KeyFence(const std::vector<std::string_view> &keys) {
+  if (keys.empty()) {
+    offsets_.push_back(0);
+    return;
+  }
+  // keys 有序, 首尾两个 key 的公共前缀就是所有 key 的公共前缀
+  std::string_view first = keys.front();
+  std::string_view last = keys.back();
+  size_t common = 0;
+  while (common < first.size() && common < last.size() &&
+         first[common] == last[common]) {
+    common++;
+  }
+  common_prefix_.assign(first.substr(0, common));
+
+  prefixes_.reserve(keys.size());
+  offsets_.reserve(keys.size() + 1);
+  size_t total_size = 0;
+  for (auto key : keys) {
+    total_size += key.size();
+  }
+  key_data_.reserve(total_size);
+  for (auto key : keys) {
+    prefixes_.push_back(prefix_of(key));
+    offsets_.push_back(key_data_.size());
+    key_data_.append(key);
+  }
+  offsets_.push_back(key_data_.size());
+}
+
+uint64_t KeyFence::prefix_of(std::string_view key) const {
+  // 调用方保证 key 以 common_prefix_ 开头
+  uint64_t prefix = 0;
+  size_t begin = common_prefix_.size();
+  size_t end = std::min(key.size(), begin + sizeof(uint64_t));
+  for (size_t i = begin; i < end; ++i) {
+    prefix |= static_cast<uint64_t>(static_cast<uint8_t>(key[i]))
+              << (56 - 8 * (i - begin));
+  }
+  return prefix;
+}
+
+size_t KeyFence::search(uint64_t target, bool upper) const {
+  // 循环中没有分支, 比较结果直接参与下标计算, 避免分支预测失败
+  const uint64_t *base = prefixes_.data();
+  size_t len = prefixes_.size();
+  while (len > 1) {
+    size_t half = len / 2;
+    uint64_t probe = base[half - 1];
+    base += (upper ? probe <= target : probe < target) * half;
+    len -= half;
+  }
+  bool after = upper ? *base <= target : *base < target;
+  return (base - prefixes_.data()) + after;
+}
+
+size_t KeyFence::lower_bound(std::string_view key) const {
+  size_t n = prefixes_.size();
+  if (n == 0) {
+    return 0;
+  }
+  // 不以公共前缀开头的 key 整体小于或大于所有 key
+  int cmp = key.substr(0, common_prefix_.size()).compare(common_prefix_);
+  if (cmp < 0) {
+    return 0;
+  }
+  if (cmp > 0) {
+    return n;
+  }
+
+  // 前缀的大小关系与 key 一致: 前缀较小的 key 一定较小,
+  // 前缀相同时才需要比较完整的 key
+  uint64_t target = prefix_of(key);
+  size_t begin = search(target, false);
+  if (begin == n || prefixes_[begin] != target) {
+    return begin;
+  }
+
+  // [begin, end) 为前缀与 key 相同的部分, 在其中比较完整的 key
+  size_t end = search(target, true);
+  while (begin < end) {
+    size_t mid = begin + (end - begin) / 2;
+    if (this->key(mid) < key) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return begin;
+}
+
+size_t KeyFence::memory_usage() const {
+  return sizeof(KeyFence) + common_prefix_.capacity() +
+         prefixes_.capacity() * sizeof(uint64_t) +
+         offsets_.capacity() * sizeof(uint32_t) + key_data_.capacity();
+}
+} // namespace my_tiny_lsm
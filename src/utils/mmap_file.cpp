@@ -55,7 +55,57 @@ bool MmapFile::open(const std::string &filename, bool create) {
   }
   return true;
 }
+bool MmapFile::open_read_only(const std::string &filename) {
+  filename_ = filename;
+  read_only_ = true;
+  fd_ = ::open(filename.c_str(), O_RDONLY);
+  if (fd_ == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) == -1) {
+    close();
+    return false;
+  }
+  file_size_ = st.st_size;
+
+  if (file_size_ > 0) {
+    mapped_data_ = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapped_data_ == MAP_FAILED) {
+      mapped_data_ = nullptr;
+      close();
+      return false;
+    }
+    // sst 上的读取以点查为主, 默认关闭预读
+    advise(FileAccessHint::Random);
+  }
+  return true;
+}
+
+bool MmapFile::advise(FileAccessHint hint) {
+  if (mapped_data_ == nullptr || mapped_data_ == MAP_FAILED) {
+    return false;
+  }
+  int advice = MADV_NORMAL;
+  switch (hint) {
+  case FileAccessHint::Random:
+    advice = MADV_RANDOM;
+    break;
+  case FileAccessHint::Sequential:
+    advice = MADV_SEQUENTIAL;
+    break;
+  default:
+    break;
+  }
+  return madvise(mapped_data_, file_size_, advice) == 0;
+}
+
+bool MmapFile::remove() { return ::unlink(filename_.c_str()) == 0; }
+
 bool MmapFile::truncate(size_t size) {
+  if (read_only_) {
+    return false;
+  }
   if (mapped_data_ != nullptr && mapped_data_ != MAP_FAILED) {
     munmap(mapped_data_, file_size_);
     mapped_data_ = nullptr;
@@ -82,6 +132,9 @@ bool MmapFile::truncate(size_t size) {
   return true;
 }
 bool MmapFile::write(size_t offset, const void *data, size_t size) {
+  if (read_only_) {
+    return false;
+  }
   // 调整文件大小以包含 offset + size
   size_t new_size = offset + size;
   if (ftruncate(fd_, new_size) == -1) {
@@ -135,6 +188,9 @@ std::vector<uint8_t> MmapFile::read(size_t offset, size_t length) {
   return result;
 }
 bool MmapFile::sync() {
+  if (read_only_) {
+    return true;
+  }
   if (mapped_data_ != nullptr && mapped_data_ != MAP_FAILED) {
     return msync(mapped_data_, file_size_, MS_SYNC) == 0;
   }
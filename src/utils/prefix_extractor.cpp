@@ -0,0 +1,55 @@
+#include "../../include/utils/prefix_extractor.h"
+#include <stdexcept>
+#include <utility>
+
+namespace my_tiny_lsm {
+
+PrefixExtractor::PrefixExtractor(std::string spec, Kind kind, size_t length,
+                                 char delimiter)
+    : spec_(std::move(spec)), kind_(kind), length_(length),
+      delimiter_(delimiter) {}
+
+std::shared_ptr<PrefixExtractor>
+PrefixExtractor::from_string(const std::string &spec) {
+  if (spec.empty()) {
+    return nullptr;
+  }
+  if (spec.rfind("fixed:", 0) == 0) {
+    size_t length = std::stoul(spec.substr(6));
+    if (length == 0) {
+      throw std::invalid_argument("Invalid prefix extractor: " + spec);
+    }
+    return std::shared_ptr<PrefixExtractor>(
+        new PrefixExtractor(spec, Kind::Fixed, length, '\0'));
+  }
+  if (spec.rfind("delim:", 0) == 0 && spec.size() == 7) {
+    return std::shared_ptr<PrefixExtractor>(
+        new PrefixExtractor(spec, Kind::Delimiter, 0, spec[6]));
+  }
+  throw std::invalid_argument("Invalid prefix extractor: " + spec);
+}
+
+bool PrefixExtractor::in_domain(const std::string &key) const {
+  if (kind_ == Kind::Fixed) {
+    return key.size() >= length_;
+  }
+  return key.find(delimiter_) != std::string::npos;
+}
+
+std::string PrefixExtractor::transform(const std::string &key) const {
+  if (kind_ == Kind::Fixed) {
+    return key.substr(0, length_);
+  }
+  return key.substr(0, key.find(delimiter_) + 1);
+}
+
+std::optional<std::string>
+PrefixExtractor::prefix_for_scan(const std::string &scan_prefix) const {
+  // 扫描前缀本身已经包含完整的提取前缀时,
+  // 以它开头的 key 都会提取出同一个前缀
+  if (!in_domain(scan_prefix)) {
+    return std::nullopt;
+  }
+  return transform(scan_prefix);
+}
+} // namespace my_tiny_lsm
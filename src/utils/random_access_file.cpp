@@ -0,0 +1,115 @@
+#include "../../include/utils/random_access_file.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace my_tiny_lsm {
+
+namespace {
+// 循环 pread 直到读满 length 字节, 遇到文件末尾时返回实际读取的字节数
+ssize_t pread_full(int fd, uint8_t *buf, size_t length, size_t offset) {
+  size_t total = 0;
+  while (total < length) {
+    ssize_t n = ::pread(fd, buf + total, length - total, offset + total);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return static_cast<ssize_t>(total);
+}
+} // namespace
+
+RandomAccessFile::~RandomAccessFile() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+std::unique_ptr<RandomAccessFile>
+RandomAccessFile::open(const std::string &path, bool direct_io) {
+  std::unique_ptr<RandomAccessFile> file(new RandomAccessFile());
+  file->path_ = path;
+
+  int fd = -1;
+  if (direct_io) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    file->direct_io_ = fd >= 0;
+  }
+  if (fd < 0) {
+    // tmpfs 等文件系统不支持 O_DIRECT, 退回普通读取
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+  file->fd_ = fd;
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw std::runtime_error("Failed to stat file: " + path);
+  }
+  file->size_ = static_cast<size_t>(st.st_size);
+  return file;
+}
+
+std::vector<uint8_t> RandomAccessFile::read(size_t offset,
+                                            size_t length) const {
+  if (offset + length > size_) {
+    throw std::out_of_range("Read beyond file size");
+  }
+  if (direct_io_) {
+    return read_direct(offset, length);
+  }
+
+  std::vector<uint8_t> buf(length);
+  if (pread_full(fd_, buf.data(), length, offset) !=
+      static_cast<ssize_t>(length)) {
+    throw std::runtime_error("Failed to read from file: " + path_);
+  }
+  return buf;
+}
+
+std::vector<uint8_t> RandomAccessFile::read_direct(size_t offset,
+                                                   size_t length) const {
+  // 将读取范围扩展到对齐的边界, 读入对齐的临时缓冲区后再拷贝出需要的部分
+  size_t aligned_offset = offset & ~(kDirectIOAlignment - 1);
+  size_t aligned_end = (offset + length + kDirectIOAlignment - 1) &
+                       ~(kDirectIOAlignment - 1);
+  size_t aligned_length = aligned_end - aligned_offset;
+
+  void *raw = nullptr;
+  if (::posix_memalign(&raw, kDirectIOAlignment, aligned_length) != 0) {
+    throw std::bad_alloc();
+  }
+  std::unique_ptr<uint8_t, decltype(&std::free)> aligned_buf(
+      static_cast<uint8_t *>(raw), &std::free);
+
+  // 文件末尾可能不足一个对齐块, 只要求读到 offset + length 即可
+  ssize_t n =
+      pread_full(fd_, aligned_buf.get(), aligned_length, aligned_offset);
+  if (n < 0 || static_cast<size_t>(n) < offset + length - aligned_offset) {
+    throw std::runtime_error("Failed to read from file: " + path_);
+  }
+
+  uint8_t *begin = aligned_buf.get() + (offset - aligned_offset);
+  return std::vector<uint8_t>(begin, begin + length);
+}
+
+size_t RandomAccessFile::size() const { return size_; }
+
+bool RandomAccessFile::is_direct_io() const { return direct_io_; }
+
+bool RandomAccessFile::remove() { return std::remove(path_.c_str()) == 0; }
+} // namespace my_tiny_lsm
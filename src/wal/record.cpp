@@ -1,6 +1,7 @@
 // src/wal/record.cpp
 
 #include "../../include/wal/record.h"
+#include "../../include/utils/crc32c.h"
 #include <cstddef>
 #include <cstring>
 
@@ -10,21 +11,24 @@ Record Record::createRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::CREATE;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
+                       sizeof(uint32_t);
   return record;
 }
 Record Record::commitRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::COMMIT;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
+                       sizeof(uint32_t);
   return record;
 }
 Record Record::rollbackRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::ROLLBACK;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
+                       sizeof(uint32_t);
   return record;
 }
 Record Record::putRecord(uint64_t tranc_id, const std::string &key,
@@ -36,7 +40,7 @@ Record Record::putRecord(uint64_t tranc_id, const std::string &key,
   record.value_ = value;
   record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
                        sizeof(uint16_t) + key.size() + sizeof(uint16_t) +
-                       value.size();
+                       value.size() + sizeof(uint32_t);
   return record;
 }
 Record Record::deleteRecord(uint64_t tranc_id, const std::string &key) {
@@ -45,118 +49,134 @@ Record Record::deleteRecord(uint64_t tranc_id, const std::string &key) {
   record.tranc_id_ = tranc_id;
   record.key_ = key;
   record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
-                       sizeof(uint16_t) + key.size();
+                       sizeof(uint16_t) + key.size() + sizeof(uint32_t);
   return record;
 }
 
 std::vector<uint8_t> Record::encode() const {
-  std::vector<uint8_t> record;
+  std::vector<uint8_t> record(record_len_, 0);
+  encode_to(record.data());
+  return record;
+}
 
+size_t Record::encode_to(uint8_t *dst) const {
   size_t key_offset = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
   // 记录长度本身(16) + 事务id(64) +
   // 操作类型(8), 固有的编码部分
 
-  record.resize(record_len_, 0);
-
   // 编码 record_len
-  std::memcpy(record.data(), &record_len_, sizeof(uint16_t));
+  std::memcpy(dst, &record_len_, sizeof(uint16_t));
 
   // 编码 tranc_id
-  std::memcpy(record.data() + sizeof(uint16_t), &tranc_id_, sizeof(uint64_t));
+  std::memcpy(dst + sizeof(uint16_t), &tranc_id_, sizeof(uint64_t));
 
   // 编码 operation_type
   auto type_byte = static_cast<uint8_t>(operation_type_);
-  std::memcpy(record.data() + sizeof(uint16_t) + sizeof(uint64_t), &type_byte,
+  std::memcpy(dst + sizeof(uint16_t) + sizeof(uint64_t), &type_byte,
               sizeof(uint8_t));
 
   if (this->operation_type_ == OperationType::PUT) {
     uint16_t key_len = key_.size();
-    std::memcpy(record.data() + key_offset, &key_len, sizeof(uint16_t));
-    std::memcpy(record.data() + key_offset + sizeof(uint16_t), key_.data(),
-                key_.size());
+    std::memcpy(dst + key_offset, &key_len, sizeof(uint16_t));
+    std::memcpy(dst + key_offset + sizeof(uint16_t), key_.data(), key_.size());
 
     size_t value_offset = key_offset + sizeof(uint16_t) + key_.size();
 
     uint16_t value_len = value_.size();
-    std::memcpy(record.data() + value_offset, &value_len, sizeof(uint16_t));
-    std::memcpy(record.data() + value_offset + sizeof(uint16_t), value_.data(),
+    std::memcpy(dst + value_offset, &value_len, sizeof(uint16_t));
+    std::memcpy(dst + value_offset + sizeof(uint16_t), value_.data(),
                 value_.size());
   } else if (this->operation_type_ == OperationType::DELETE) {
     uint16_t key_len = key_.size();
-    std::memcpy(record.data() + key_offset, &key_len, sizeof(uint16_t));
-    std::memcpy(record.data() + key_offset + sizeof(uint16_t), key_.data(),
-                key_.size());
+    std::memcpy(dst + key_offset, &key_len, sizeof(uint16_t));
+    std::memcpy(dst + key_offset + sizeof(uint16_t), key_.data(), key_.size());
   }
 
-  return record;
+  // 编码 crc32c
+  size_t checksum_pos = record_len_ - sizeof(uint32_t);
+  uint32_t checksum = crc32c_value(dst, checksum_pos);
+  std::memcpy(dst + checksum_pos, &checksum, sizeof(uint32_t));
+
+  return record_len_;
 }
 
-std::vector<Record> Record::decode(const std::vector<uint8_t> &data) {
-  if (data.size() < sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t)) {
-    return {};
-  }
+std::vector<Record> Record::decode(const std::vector<uint8_t> &data,
+                                   bool with_checksum) {
+  size_t header_size = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  size_t checksum_size = with_checksum ? sizeof(uint32_t) : 0;
 
   std::vector<Record> records;
   size_t pos = 0;
 
-  while (pos < data.size()) {
+  // 崩溃时最后一条记录可能没有写完, 遇到不完整或校验失败的记录时
+  // 丢弃它及之后的内容
+  while (pos + header_size + checksum_size <= data.size()) {
+    const uint8_t *record_ptr = data.data() + pos;
+
     // 读取 record_len
     uint16_t record_len;
-    std::memcpy(&record_len, data.data() + pos, sizeof(uint16_t));
-    pos += sizeof(uint16_t);
+    std::memcpy(&record_len, record_ptr, sizeof(uint16_t));
 
     // 检查数据长度是否足够
-    if (data.size() < record_len) {
-      throw std::runtime_error("Data length does not match record length");
+    if (record_len < header_size + checksum_size ||
+        pos + record_len > data.size()) {
+      break;
     }
+    size_t body_end = record_len - checksum_size;
+    if (with_checksum) {
+      uint32_t checksum;
+      std::memcpy(&checksum, record_ptr + body_end, sizeof(uint32_t));
+      if (crc32c_value(record_ptr, body_end) != checksum) {
+        break;
+      }
+    }
+    size_t offset = sizeof(uint16_t);
 
     // 读取 tranc_id
     uint64_t tranc_id;
-    std::memcpy(&tranc_id, data.data() + pos, sizeof(uint64_t));
-    pos += sizeof(uint64_t);
+    std::memcpy(&tranc_id, record_ptr + offset, sizeof(uint64_t));
+    offset += sizeof(uint64_t);
 
     // 读取 operation_type
-    uint8_t op_type = data[pos++];
+    uint8_t op_type = record_ptr[offset++];
     OperationType operation_type = static_cast<OperationType>(op_type);
 
     Record record;
     record.tranc_id_ = tranc_id;
     record.operation_type_ = operation_type;
-    record.record_len_ = record_len;
-
+    // 重新编码时总是带有 crc32c
+    record.record_len_ = record_len + sizeof(uint32_t) - checksum_size;
+
+    // 读取长度前缀的字符串, 超出记录范围时返回 false
+    auto read_string = [&](std::string &out) {
+      if (offset + sizeof(uint16_t) > body_end) {
+        return false;
+      }
+      uint16_t len;
+      std::memcpy(&len, record_ptr + offset, sizeof(uint16_t));
+      offset += sizeof(uint16_t);
+      if (offset + len > body_end) {
+        return false;
+      }
+      out.assign(reinterpret_cast<const char *>(record_ptr + offset), len);
+      offset += len;
+      return true;
+    };
+
+    bool valid = true;
     if (operation_type == OperationType::PUT) {
-      // 读取 key_len
-      uint16_t key_len;
-      std::memcpy(&key_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-
-      // 读取 key
-      record.key_ = std::string(
-          reinterpret_cast<const char *>(data.data() + pos), key_len);
-      pos += key_len;
-
-      // 读取 value_len
-      uint16_t value_len;
-      std::memcpy(&value_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-
-      // 读取 value
-      record.value_ = std::string(
-          reinterpret_cast<const char *>(data.data() + pos), value_len);
-      pos += value_len;
+      // 读取 key 和 value
+      valid = read_string(record.key_) && read_string(record.value_);
     } else if (operation_type == OperationType::DELETE) {
-      // 读取 key_len
-      uint16_t key_len;
-      std::memcpy(&key_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-
       // 读取 key
-      record.key_ = std::string(
-          reinterpret_cast<const char *>(data.data() + pos), key_len);
-      pos += key_len;
+      valid = read_string(record.key_);
+    }
+    if (!valid) {
+      break;
     }
 
     records.push_back(record);
+    pos += record_len;
   }
   return records;
 }
@@ -2,7 +2,10 @@
 
 #include "../../include/wal/wal.h"
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -17,7 +20,8 @@ WAL::WAL(const std::string &log_dir, size_t buffer_size,
       stop_cleaner_(false), clean_interval_(clean_interval),
       file_size_limit_(file_size_limit) {
   active_log_path_ = log_dir + "/wal.0";
-  log_file_ = FileObj::open(active_log_path_, true);
+  log_file_ = AppendFile::open(active_log_path_, true);
+  write_header();
 
   cleaner_thread_ = std::thread(&WAL::cleaner, this);
 }
@@ -70,8 +74,11 @@ WAL::recover(const std::string &log_dir, uint64_t checkpoint_tranc_id) {
   // 读取所有的记录
   for (const auto &wal_path : wal_paths) {
     auto wal_file = FileObj::open(wal_path, false);
-    auto wal_records_slice = wal_file.read_to_slice(0, wal_file.size());
-    auto records = Record::decode(wal_records_slice);
+    uint8_t version = read_format_version(wal_file);
+    size_t records_offset = version == 0 ? 0 : kWalHeaderSize;
+    auto wal_records_slice = wal_file.read_to_slice(
+        records_offset, wal_file.size() - records_offset);
+    auto records = Record::decode(wal_records_slice, version >= 1);
     for (const auto &record : records) {
       if (record.getTrancId() > checkpoint_tranc_id) {
         // 如果记录的 tranc_id 大于 checkpoint_tranc_id, 才需要尝试恢复
@@ -83,6 +90,28 @@ WAL::recover(const std::string &log_dir, uint64_t checkpoint_tranc_id) {
   return tranc_records;
 }
 
+uint8_t WAL::read_format_version(FileObj &file) {
+  if (file.size() < kWalHeaderSize || file.read_uint16(0) != 0 ||
+      file.read_uint32(sizeof(uint16_t)) != kWalMagic) {
+    return 0;
+  }
+  uint8_t version = file.read_uint8(kWalHeaderSize - sizeof(uint8_t));
+  if (version > kWalFormatVersion) {
+    throw std::runtime_error("Unsupported WAL format version: " +
+                             std::to_string(version));
+  }
+  return version;
+}
+
+void WAL::write_header() {
+  uint8_t header[kWalHeaderSize] = {};
+  memcpy(header + sizeof(uint16_t), &kWalMagic, sizeof(uint32_t));
+  header[kWalHeaderSize - sizeof(uint8_t)] = kWalFormatVersion;
+  if (!log_file_.append(header, kWalHeaderSize)) {
+    throw std::runtime_error("Failed to write WAL header");
+  }
+}
+
 // commit 时 强制写入
 void WAL::flush() { std::lock_guard<std::mutex> lock(mutex_); }
 
@@ -91,35 +120,109 @@ void WAL::set_checkpoint_tranc_id(uint64_t checkpoint_tranc_id) {
   checkpoint_tranc_id_ = checkpoint_tranc_id;
 }
 
+namespace {
+size_t hist_bucket(uint64_t value) {
+  size_t bucket = 0;
+  while (value > 1 && bucket + 1 < WALStats::kBuckets) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+} // namespace
+
 void WAL::log(const std::vector<Record> &records, bool force_flush) {
   std::unique_lock<std::mutex> lock(mutex_);
 
-  // 将 records 的所有记录添加到 log_buffer_
+  // 将 records 的所有记录直接编码到 log_buffer_ 的末尾
+  size_t offset = log_buffer_.size();
+  size_t encoded_size = 0;
   for (const auto &record : records) {
-    log_buffer_.push_back(record);
+    encoded_size += record.getRecordSize();
   }
+  log_buffer_.resize(offset + encoded_size);
+  for (const auto &record : records) {
+    offset += record.encode_to(log_buffer_.data() + offset);
+  }
+  buffered_records_ += records.size();
 
-  if (log_buffer_.size() < buffer_size_ && !force_flush) {
+  if (buffered_records_ < buffer_size_ && !force_flush) {
     // 如果 log_buffer_ 的大小小于 buffer_size_ 且 force_flush 为 false,
     // 不进行写入
     return;
   }
 
-  // 否则写入 wal 文件
-  auto pre_buffer = std::move(log_buffer_);
-  for (const auto &record : pre_buffer) {
-    std::vector<uint8_t> encoded_record = record.encode();
-    log_file_.append(encoded_record);
+  // 否则加入等待队列, 由队首的 leader 负责写入
+  Writer writer;
+  writers_.push_back(&writer);
+  writer.cv.wait(lock, [this, &writer]() {
+    return writer.done || writers_.front() == &writer;
+  });
+  if (!writer.done) {
+    // 成为 leader, 本次写入会包含所有已在缓冲区中的记录
+    write_group(lock);
+  }
+  if (writer.error) {
+    std::rethrow_exception(writer.error);
   }
-  if (!log_file_.sync()) {
+}
+
+void WAL::write_group(std::unique_lock<std::mutex> &lock) {
+  // 1. 持锁取出缓冲区, 此时队列中的 writer 的记录都已在缓冲区中
+  std::swap(write_buffer_, log_buffer_);
+  log_buffer_.clear();
+  buffered_records_ = 0;
+  Writer *last_writer = writers_.back();
+
+  // 2. 释放锁后写入, 新的提交可以继续进入缓冲区和队列
+  // 只有队首的 leader 会访问 log_file_, 不会与其他写入冲突
+  lock.unlock();
+  // 整组记录只需要一次 write 和一次 sync
+  std::exception_ptr error;
+  size_t batch_size = write_buffer_.size();
+  auto sync_start = std::chrono::steady_clock::now();
+  if (!log_file_.append(write_buffer_.data(), batch_size) ||
+      !log_file_.sync()) {
     // 确保日志立即写入磁盘
-    throw std::runtime_error("Failed to sync WAL file");
+    error = std::make_exception_ptr(
+        std::runtime_error("Failed to sync WAL file"));
   }
+  auto sync_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - sync_start)
+                     .count();
+  lock.lock();
 
-  auto cur_file_size = log_file_.size();
-  if (cur_file_size > file_size_limit_) {
+  if (!error && log_file_.size() > file_size_limit_) {
     reset_file();
   }
+
+  // 3. 唤醒本组的 follower, 并把 leader 交给队列中的下一个 writer
+  size_t group_size = 0;
+  while (true) {
+    Writer *writer = writers_.front();
+    writers_.pop_front();
+    writer->done = true;
+    writer->error = error;
+    writer->cv.notify_one();
+    group_size++;
+    if (writer == last_writer) {
+      break;
+    }
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.notify_one();
+  }
+
+  stats_.groups++;
+  stats_.writers += group_size;
+  stats_.bytes += batch_size;
+  stats_.batch_size_hist[hist_bucket(group_size)]++;
+  stats_.sync_latency_hist[hist_bucket(sync_us)]++;
+}
+
+WALStats WAL::get_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
 }
 
 void WAL::cleaner() {
@@ -178,15 +281,19 @@ void WAL::cleanWALFile() {
     auto cur_file = FileObj::open(cur_path, false);
     // 遍历文件记录, 读取所有的tranc_id,
     // 判断是否都小于等于checkpoint_tranc_id_
-    size_t offset = 0;
+    size_t offset = read_format_version(cur_file) == 0 ? 0 : kWalHeaderSize;
     bool has_unfinished = false;
-    while (offset + sizeof(uint16_t) < cur_file.size()) {
+    while (offset + sizeof(uint16_t) + sizeof(uint64_t) <= cur_file.size()) {
       uint16_t record_size = cur_file.read_uint16(offset);
       uint64_t tranc_id = cur_file.read_uint64(offset + sizeof(uint16_t));
       if (tranc_id > checkpoint_tranc_id_) {
         has_unfinished = true;
         break;
       }
+      if (record_size == 0) {
+        break;
+      }
+      offset += record_size;
     }
     if (!has_unfinished) {
       del_paths.push_back(std::move(cur_file));
@@ -212,8 +319,7 @@ void WAL::reset_file() {
                      std::to_string(seq);
 
   // 创建新的文件
-  // ? 如果不注释下面这行, debug 模式下 test_wal 能通过但 release 模式下报错
-  // log_file_.~FileObj();
-  log_file_ = FileObj::create_and_write(active_log_path_, {});
+  log_file_ = AppendFile::open(active_log_path_, true);
+  write_header();
 }
 } // namespace tiny_lsm
\ No newline at end of file
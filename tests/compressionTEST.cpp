@@ -0,0 +1,147 @@
+#include "utils/compression.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+namespace {
+std::vector<uint8_t> to_bytes(const std::string &s) {
+  return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+// 与 data block 类似的内容: 有序的 key 和重复度较高的 value
+std::vector<uint8_t> make_block_like(size_t num_entries) {
+  std::string data;
+  for (size_t i = 0; i < num_entries; ++i) {
+    data += "user:" + std::to_string(100000 + i) + ":profile";
+    data += "value_" + std::to_string(i % 17) + "_padding_padding";
+  }
+  return to_bytes(data);
+}
+
+std::vector<uint8_t> round_trip(const std::vector<uint8_t> &input) {
+  auto compressed =
+      compress_block(CompressionType::LZ4, input.data(), input.size());
+  EXPECT_FALSE(compressed.empty());
+  EXPECT_LT(compressed.size(), input.size());
+  return decompress_block(CompressionType::LZ4, compressed.data(),
+                          compressed.size());
+}
+} // namespace
+
+TEST(CompressionTest, RoundTrip) {
+  for (size_t num_entries : {4, 64, 1000}) {
+    auto input = make_block_like(num_entries);
+    EXPECT_EQ(round_trip(input), input);
+  }
+}
+
+TEST(CompressionTest, RoundTripOverlappingMatch) {
+  // 偏移量小于匹配长度, 解压时匹配与输出重叠
+  std::vector<uint8_t> input(10000, 'a');
+  EXPECT_EQ(round_trip(input), input);
+
+  std::string pattern;
+  for (int i = 0; i < 3000; ++i) {
+    pattern += "abc";
+  }
+  auto input2 = to_bytes(pattern);
+  EXPECT_EQ(round_trip(input2), input2);
+}
+
+TEST(CompressionTest, RoundTripLongLiterals) {
+  // 随机字节之后跟着可压缩的内容, 字面量长度需要多个扩展字节
+  std::mt19937 gen(7);
+  std::vector<uint8_t> input(2000);
+  for (auto &byte : input) {
+    byte = static_cast<uint8_t>(gen());
+  }
+  input.insert(input.end(), 20000, 'z');
+  EXPECT_EQ(round_trip(input), input);
+}
+
+TEST(CompressionTest, IncompressibleInput) {
+  std::mt19937 gen(11);
+  std::vector<uint8_t> input(4096);
+  for (auto &byte : input) {
+    byte = static_cast<uint8_t>(gen());
+  }
+  // 没有收益时返回空数组, 由调用方保存原始数据
+  EXPECT_TRUE(
+      compress_block(CompressionType::LZ4, input.data(), input.size()).empty());
+  EXPECT_TRUE(
+      compress_block(CompressionType::None, input.data(), input.size())
+          .empty());
+}
+
+TEST(CompressionTest, TruncatedInput) {
+  auto input = make_block_like(200);
+  auto compressed =
+      compress_block(CompressionType::LZ4, input.data(), input.size());
+  ASSERT_FALSE(compressed.empty());
+  for (size_t size = 0; size < compressed.size(); ++size) {
+    EXPECT_THROW(
+        decompress_block(CompressionType::LZ4, compressed.data(), size),
+        std::runtime_error)
+        << "truncated to " << size << " bytes";
+  }
+}
+
+TEST(CompressionTest, CorruptedInput) {
+  auto input = make_block_like(200);
+  auto compressed =
+      compress_block(CompressionType::LZ4, input.data(), input.size());
+  ASSERT_FALSE(compressed.empty());
+
+  // 随机修改字节: 要么抛出异常, 要么得到长度正确的输出, 不能越界读写
+  std::mt19937 gen(3);
+  for (int round = 0; round < 2000; ++round) {
+    auto corrupted = compressed;
+    size_t pos = gen() % corrupted.size();
+    corrupted[pos] ^= static_cast<uint8_t>(1 + gen() % 255);
+    try {
+      auto out = decompress_block(CompressionType::LZ4, corrupted.data(),
+                                  corrupted.size());
+      uint32_t raw_size;
+      memcpy(&raw_size, corrupted.data(), sizeof(uint32_t));
+      EXPECT_EQ(out.size(), raw_size);
+    } catch (const std::runtime_error &) {
+    }
+  }
+}
+
+TEST(CompressionTest, InvalidHeaderAndOffset) {
+  auto input = make_block_like(200);
+  auto compressed =
+      compress_block(CompressionType::LZ4, input.data(), input.size());
+  ASSERT_FALSE(compressed.empty());
+
+  // 原始长度远大于压缩数据能展开的长度, 不能据此分配内存
+  auto huge = compressed;
+  uint32_t raw_size = UINT32_MAX;
+  memcpy(huge.data(), &raw_size, sizeof(uint32_t));
+  EXPECT_THROW(
+      decompress_block(CompressionType::LZ4, huge.data(), huge.size()),
+      std::runtime_error);
+
+  // 原始长度 8, 一个字面量 'a' 之后的匹配偏移量为 0 或指向输出之前
+  for (uint8_t offset : {0, 2}) {
+    std::vector<uint8_t> block = {8, 0, 0, 0, 0x13, 'a', offset, 0};
+    EXPECT_THROW(
+        decompress_block(CompressionType::LZ4, block.data(), block.size()),
+        std::runtime_error);
+  }
+  // 同样的序列, 偏移量为 1 时合法: 'a' 重复 7 次
+  std::vector<uint8_t> block = {8, 0, 0, 0, 0x13, 'a', 1, 0};
+  EXPECT_EQ(decompress_block(CompressionType::LZ4, block.data(), block.size()),
+            std::vector<uint8_t>(8, 'a'));
+
+  EXPECT_THROW(decompress_block(CompressionType::None, compressed.data(),
+                                compressed.size()),
+               std::runtime_error);
+}
@@ -0,0 +1,125 @@
+#include "utils/key_fence.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+namespace {
+// 对 keys 中的每个 key 及其附近的 key, 以及额外的 probes,
+// 检查 KeyFence::lower_bound 与 std::lower_bound 的结果一致
+void check_against_std(const std::vector<std::string> &keys,
+                       std::vector<std::string> probes = {}) {
+  std::vector<std::string_view> views(keys.begin(), keys.end());
+  KeyFence fence(views);
+  ASSERT_EQ(fence.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(fence.key(i), keys[i]);
+  }
+
+  probes.push_back("");
+  for (const auto &key : keys) {
+    probes.push_back(key);
+    probes.push_back(key + '\0');
+    probes.push_back(key + '\xff');
+    if (!key.empty()) {
+      probes.push_back(key.substr(0, key.size() - 1));
+      auto smaller = key;
+      smaller.back()--;
+      probes.push_back(smaller);
+      auto larger = key;
+      larger.back()++;
+      probes.push_back(larger);
+    }
+  }
+  for (const auto &probe : probes) {
+    size_t expected =
+        std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin();
+    EXPECT_EQ(fence.lower_bound(probe), expected)
+        << "probe of size " << probe.size() << ": " << probe;
+  }
+}
+} // namespace
+
+TEST(KeyFenceTest, Empty) {
+  KeyFence fence(std::vector<std::string_view>{});
+  EXPECT_EQ(fence.size(), 0);
+  EXPECT_EQ(fence.lower_bound(""), 0);
+  EXPECT_EQ(fence.lower_bound("key"), 0);
+
+  KeyFence default_fence;
+  EXPECT_EQ(default_fence.lower_bound("key"), 0);
+}
+
+TEST(KeyFenceTest, SingleKey) {
+  check_against_std({"key"}, {"a", "kex", "key", "kez", "z"});
+  check_against_std({""}, {"a"});
+}
+
+TEST(KeyFenceTest, LongCommonPrefix) {
+  // 公共前缀远长于 8 字节, 去掉前缀后的部分决定顺序
+  std::string prefix(100, 'p');
+  std::vector<std::string> keys;
+  for (int i = 0; i < 200; ++i) {
+    keys.push_back(prefix + std::to_string(1000 + i * 3));
+  }
+  check_against_std(keys, {prefix, prefix + "1001", prefix + "9"});
+
+  // 去掉前缀后仍有超过 8 字节相同, 只能比较完整的 key
+  std::vector<std::string> same_prefix;
+  for (int i = 0; i < 50; ++i) {
+    same_prefix.push_back(prefix + "01234567" + std::to_string(100 + i));
+  }
+  same_prefix.push_back(prefix + "012345679");
+  check_against_std(same_prefix);
+}
+
+TEST(KeyFenceTest, ZeroPaddedShortKeys) {
+  // 不足 8 字节的部分补 0, "a" 与 "a\0" 的前缀相同, 需要比较完整的 key
+  using namespace std::string_literals;
+  std::vector<std::string> keys = {"a"s,      "a\0"s,      "a\0\0"s,
+                                   "a\0\0a"s, "a\0\x01"s, "ab"s};
+  check_against_std(keys, {"a\0\0\0"s, "a\0\0\0\0\0\0\0\0"s});
+}
+
+TEST(KeyFenceTest, KeysOutsideCommonPrefix) {
+  std::vector<std::string> keys = {"user:100", "user:200", "user:300"};
+  // 比公共前缀短, 小于或大于公共前缀, 以及与公共前缀部分相同的 key
+  check_against_std(keys, {"", "u", "user", "user:", "usea", "usez",
+                           "user;", "user9", "a", "z", "user:\xff"});
+}
+
+TEST(KeyFenceTest, RandomKeys) {
+  // 字母表很小, 制造大量相同的前缀和补 0 的情况
+  std::mt19937 gen(42);
+  const std::string alphabet("\0\x01" "ab\xff", 5);
+  for (int round = 0; round < 50; ++round) {
+    std::string prefix(gen() % 12, 'k');
+    std::set<std::string> key_set;
+    size_t num_keys = 1 + gen() % 100;
+    while (key_set.size() < num_keys) {
+      std::string key = prefix;
+      size_t len = gen() % 14;
+      for (size_t i = 0; i < len; ++i) {
+        key += alphabet[gen() % alphabet.size()];
+      }
+      key_set.insert(key);
+    }
+    std::vector<std::string> keys(key_set.begin(), key_set.end());
+
+    std::vector<std::string> probes;
+    for (int i = 0; i < 200; ++i) {
+      std::string probe = i % 2 ? prefix : "";
+      size_t len = gen() % 16;
+      for (size_t j = 0; j < len; ++j) {
+        probe += alphabet[gen() % alphabet.size()];
+      }
+      probes.push_back(probe);
+    }
+    check_against_std(keys, probes);
+  }
+}
@@ -0,0 +1,212 @@
+#include "lsm/manifest.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace my_tiny_lsm;
+
+namespace {
+class ManifestTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    dir_ = (std::filesystem::temp_directory_path() /
+            ("manifest_test_" +
+             std::string(::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name())))
+               .string();
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = dir_ + "/MANIFEST";
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  static SSTMeta make_meta(size_t sst_id, size_t level,
+                           size_t key_size = 8) {
+    SSTMeta meta;
+    meta.sst_id = sst_id;
+    meta.level = level;
+    meta.file_size = 4096 + sst_id;
+    meta.min_tranc_id = sst_id;
+    meta.max_tranc_id = sst_id + 10;
+    meta.first_key = std::string(key_size, 'a') + std::to_string(sst_id);
+    meta.last_key = std::string(key_size, 'z') + std::to_string(sst_id);
+    return meta;
+  }
+
+  // 新增 add_id, 删除 delete_id (为 0 时不删除)
+  static VersionEdit make_edit(size_t add_id, size_t delete_id = 0) {
+    VersionEdit edit;
+    edit.added_ssts.push_back(make_meta(add_id, 1));
+    if (delete_id != 0) {
+      edit.deleted_ssts.push_back(delete_id);
+    }
+    edit.next_sst_id = add_id + 1;
+    return edit;
+  }
+
+  uint64_t file_size() const { return std::filesystem::file_size(path_); }
+
+  // 把文件中 offset 处的字节取反
+  void flip_byte(uint64_t offset) const {
+    FILE *file = std::fopen(path_.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    std::fseek(file, static_cast<long>(offset), SEEK_SET);
+    int byte = std::fgetc(file);
+    std::fseek(file, static_cast<long>(offset), SEEK_SET);
+    std::fputc(~byte & 0xFF, file);
+    std::fclose(file);
+  }
+
+  static std::vector<size_t> live_ids(const Manifest &manifest) {
+    std::vector<size_t> ids;
+    for (const auto &[sst_id, meta] : manifest.live_ssts()) {
+      ids.push_back(sst_id);
+    }
+    return ids;
+  }
+
+  std::string dir_;
+  std::string path_;
+};
+} // namespace
+
+TEST_F(ManifestTest, RecoverEdits) {
+  EXPECT_FALSE(Manifest::exists(dir_));
+  {
+    Manifest manifest(dir_);
+    EXPECT_TRUE(Manifest::exists(dir_));
+    EXPECT_TRUE(manifest.live_ssts().empty());
+    manifest.log_and_apply(make_edit(1));
+    manifest.log_and_apply(make_edit(2));
+    manifest.log_and_apply(make_edit(3, 1));
+  }
+
+  Manifest manifest(dir_);
+  EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{2, 3}));
+  EXPECT_EQ(manifest.next_sst_id(), 4);
+  const auto &meta = manifest.live_ssts().at(3);
+  auto expected = make_meta(3, 1);
+  EXPECT_EQ(meta.level, expected.level);
+  EXPECT_EQ(meta.file_size, expected.file_size);
+  EXPECT_EQ(meta.min_tranc_id, expected.min_tranc_id);
+  EXPECT_EQ(meta.max_tranc_id, expected.max_tranc_id);
+  EXPECT_EQ(meta.first_key, expected.first_key);
+  EXPECT_EQ(meta.last_key, expected.last_key);
+}
+
+TEST_F(ManifestTest, TruncatedLastRecord) {
+  uint64_t good_size = 0;
+  uint64_t full_size = 0;
+  {
+    Manifest manifest(dir_);
+    manifest.log_and_apply(make_edit(1));
+    manifest.log_and_apply(make_edit(2));
+    good_size = file_size();
+    manifest.log_and_apply(make_edit(3, 1));
+    full_size = file_size();
+  }
+
+  // 最后一条记录在任意位置被截断时, 回放到前一条记录为止
+  for (uint64_t size = good_size; size < full_size; ++size) {
+    std::filesystem::copy_file(
+        path_, path_ + ".full",
+        std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(path_, size);
+    {
+      Manifest manifest(dir_);
+      EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{1, 2}))
+          << "truncated to " << size;
+      EXPECT_EQ(manifest.next_sst_id(), 3);
+    }
+    std::filesystem::rename(path_ + ".full", path_);
+  }
+
+  // 打开时丢弃损坏的尾部并改写为快照, 之后追加的记录可以正常回放
+  std::filesystem::resize_file(path_, full_size - 1);
+  {
+    Manifest manifest(dir_);
+    manifest.log_and_apply(make_edit(4, 2));
+  }
+  Manifest manifest(dir_);
+  EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{1, 4}));
+  EXPECT_EQ(manifest.next_sst_id(), 5);
+}
+
+TEST_F(ManifestTest, BadCrcInTail) {
+  uint64_t good_size = 0;
+  uint64_t full_size = 0;
+  {
+    Manifest manifest(dir_);
+    manifest.log_and_apply(make_edit(1));
+    manifest.log_and_apply(make_edit(2));
+    good_size = file_size();
+    manifest.log_and_apply(make_edit(3, 1));
+    full_size = file_size();
+  }
+
+  // 最后一条记录的长度, payload 或校验和中任意一个字节损坏
+  for (uint64_t offset = good_size; offset < full_size; ++offset) {
+    std::filesystem::copy_file(
+        path_, path_ + ".full",
+        std::filesystem::copy_options::overwrite_existing);
+    flip_byte(offset);
+    {
+      Manifest manifest(dir_);
+      EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{1, 2}))
+          << "corrupted byte at " << offset;
+    }
+    std::filesystem::rename(path_ + ".full", path_);
+  }
+
+  Manifest manifest(dir_);
+  EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{2, 3}));
+}
+
+TEST_F(ManifestTest, RolloverThenReopen) {
+  // 每个 edit 带两个较长的 key, 少量的 edit 就能超过改写的阈值
+  const size_t key_size = 16 * 1024;
+  const size_t num_edits = kManifestRolloverSize / (2 * key_size) + 20;
+  uint64_t max_size = 0;
+  bool rolled_over = false;
+  {
+    Manifest manifest(dir_);
+    manifest.log_and_apply(make_edit(1));
+    for (size_t i = 0; i < num_edits; ++i) {
+      // 始终只有两个存活的 sst, 改写后的快照很小
+      VersionEdit edit;
+      edit.added_ssts.push_back(make_meta(i + 2, 2, key_size));
+      if (i > 0) {
+        edit.deleted_ssts.push_back(i + 1);
+      }
+      edit.next_sst_id = i + 3;
+      uint64_t before = file_size();
+      manifest.log_and_apply(edit);
+      rolled_over |= file_size() < before;
+      max_size = std::max(max_size, file_size());
+    }
+  }
+  EXPECT_TRUE(rolled_over);
+  EXPECT_LE(max_size, kManifestRolloverSize + 4 * key_size);
+
+  size_t last_id = num_edits + 1;
+  {
+    Manifest manifest(dir_);
+    EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{1, last_id}));
+    EXPECT_EQ(manifest.next_sst_id(), last_id + 1);
+    EXPECT_EQ(manifest.live_ssts().at(last_id).first_key,
+              make_meta(last_id, 2, key_size).first_key);
+    EXPECT_EQ(manifest.live_ssts().at(last_id).level, 2);
+    // 改写后继续追加, 再次打开时快照和之后的记录都能回放
+    manifest.log_and_apply(make_edit(last_id + 1, 1));
+  }
+  Manifest manifest(dir_);
+  EXPECT_EQ(live_ids(manifest), (std::vector<size_t>{last_id, last_id + 1}));
+  EXPECT_EQ(manifest.next_sst_id(), last_id + 2);
+  EXPECT_FALSE(std::filesystem::exists(path_ + ".tmp"));
+}
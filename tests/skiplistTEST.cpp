@@ -1,6 +1,7 @@
 #include "skiplist/skiplist.h" // 引入您自己的 skiplist 头文件
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <iomanip> // 用于 std::setw 和 std::setfill
@@ -263,6 +264,103 @@ TEST(MySkiplistTest, TransactionId) {
   EXPECT_EQ((skiplist.get("key1", 25).get_value()), "value2_txn20");
 }
 
+// 测试多线程并发插入
+TEST(MySkiplistTest, ConcurrentPut) {
+  Skiplist skiplist;
+  const int num_threads = 8;
+  const int per_thread = 2000;
+  const int num_readers = 2;
+
+  // 读者不加锁, 与写入同时进行 get 和遍历:
+  // 遍历结果始终有序, 能读到的 key 的 value 总是完整写入的
+  std::atomic<bool> writers_done{false};
+  std::atomic<int> readers_started{0};
+  std::atomic<int> reader_errors{0};
+  std::atomic<int> reader_rounds{0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < num_readers; ++r) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 gen(r);
+      readers_started++;
+      do {
+        std::string last_key;
+        uint64_t last_tranc_id = 0;
+        int count = 0;
+        for (auto it = skiplist.begin(); !it.is_end(); ++it) {
+          auto key = it.get_key();
+          auto tranc_id = it.get_transaction_id();
+          if (key < last_key ||
+              (key == last_key && tranc_id >= last_tranc_id)) {
+            reader_errors++;
+          }
+          last_key = key;
+          last_tranc_id = tranc_id;
+          count++;
+        }
+        if (count > num_threads * per_thread * 2) {
+          reader_errors++;
+        }
+
+        for (int i = 0; i < 100; ++i) {
+          std::ostringstream oss_key;
+          oss_key << "key" << std::setw(6) << std::setfill('0')
+                  << gen() % (num_threads * per_thread);
+          auto it = skiplist.get(oss_key.str(), 0);
+          if (it.is_valid() && it.get_key() == oss_key.str() &&
+              it.get_value() != "v1" && it.get_value() != "v2") {
+            reader_errors++;
+          }
+        }
+        reader_rounds++;
+      } while (!writers_done.load());
+    });
+  }
+  // 读者开始读取后再开始写入
+  while (readers_started.load() < num_readers) {
+    std::this_thread::yield();
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&skiplist, t]() {
+      for (int i = 0; i < per_thread; ++i) {
+        std::ostringstream oss_key;
+        oss_key << "key" << std::setw(6) << std::setfill('0')
+                << i * num_threads + t;
+        // 每个 key 写入两个版本, 检查并发下的多版本排序
+        skiplist.put(oss_key.str(), "v1", 10);
+        skiplist.put(oss_key.str(), "v2", 20);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  writers_done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(reader_errors.load(), 0);
+  EXPECT_GE(reader_rounds.load(), num_readers);
+
+  // 所有 key 按顺序出现, 每个 key 的新版本在前
+  int count = 0;
+  std::string last_key;
+  for (auto it = skiplist.begin(); !it.is_end(); ++it) {
+    EXPECT_LE(last_key, it.get_key());
+    if (count % 2 == 0) {
+      EXPECT_EQ(it.get_transaction_id(), 20);
+    } else {
+      EXPECT_EQ(it.get_transaction_id(), 10);
+      EXPECT_EQ(it.get_key(), last_key);
+    }
+    last_key = it.get_key();
+    count++;
+  }
+  EXPECT_EQ(count, num_threads * per_thread * 2);
+  EXPECT_EQ((skiplist.get("key000123", 15).get_value()), "v1");
+  EXPECT_EQ((skiplist.get("key000123", 0).get_value()), "v2");
+}
 
 // GTest的main函数
 int main(int argc, char **argv) {